@@ -0,0 +1,328 @@
+/*
+amcParser.cpp
+
+Single-pass parser for AMC motion files.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "amcParser.h"
+
+AMCParser::AMCParser(const Skeleton * pSkeleton, double scale_, int forceAllJointsBe3DOF)
+{
+  m_pSkeleton = pSkeleton;
+  m_Scale = scale_;
+
+  m_NumBones = pSkeleton->getNumBones();
+
+  m_pBoneDOF = new int[m_NumBones];
+  m_pBoneDOFOrder = new int[m_NumBones][8];
+  for(int j = 0; j < m_NumBones; j++)
+    m_pBoneDOF[j] = pSkeleton->getFileDOFOrder(j, forceAllJointsBe3DOF, m_pBoneDOFOrder[j]);
+}
+
+AMCParser::~AMCParser()
+{
+  delete [] m_pBoneDOF;
+  delete [] m_pBoneDOFOrder;
+}
+
+const char * AMCParser::ParseHeader(const char * p, const char * end, int * forceAllJointsBe3DOF)
+{
+  *forceAllJointsBe3DOF = 0;
+  while (1)
+  {
+    p = SkipWhitespace(p, end);
+    if (p == end)
+      return NULL;
+
+    const char * token = p;
+    p = SkipToken(p, end);
+    int length = (int)(p - token);
+
+    if ((length == 25) && (memcmp(token, ":FORCE-ALL-JOINTS-BE-3DOF", 25) == 0))
+      *forceAllJointsBe3DOF = 1;
+
+    if ((length == 8) && (memcmp(token, ":DEGREES", 8) == 0))
+      return p;
+  }
+}
+
+void AMCParser::FindFrames(const char * p, const char * end, std::vector<const char *> & frames, ThreadPool * pThreadPool)
+{
+  frames.clear();
+  if (p >= end)
+    return;
+
+  // the text is split into ranges of roughly equal size; each range collects 
+  // the frame number lines that start inside it
+  int numRanges = 1;
+  if (pThreadPool != NULL)
+    numRanges = 4 * pThreadPool->GetNumThreads();
+  long rangeSize = (end - p) / numRanges + 1;
+
+  std::vector<std::vector<const char *> > rangeFrames(numRanges);
+  std::function<void(int)> scanRange = [&](int range)
+  {
+    const char * rangeStart = p + range * rangeSize;
+    const char * rangeEnd = rangeStart + rangeSize;
+    if (rangeStart > end)
+      rangeStart = end;
+    if (rangeEnd > end)
+      rangeEnd = end;
+
+    // (p itself is on the :DEGREES line, and is not the start of a line)
+    const char * line = rangeStart;
+    while (line < rangeEnd)
+    {
+      if (line[-1] != '\n')
+      {
+        line = (const char *) memchr(line, '\n', rangeEnd - line);
+        if (line == NULL)
+          break;
+        line++;
+        continue;
+      }
+
+      // is this line a single integer?
+      const char * q = line;
+      while ((q < end) && ((*q == ' ') || (*q == '\t')))
+        q++;
+      const char * number = q;
+      while ((q < end) && IsDigit(*q))
+        q++;
+      int isFrameNumber = (q > number);
+      while ((q < end) && (*q != '\n'))
+      {
+        if (!IsWhitespace(*q))
+          isFrameNumber = 0;
+        q++;
+      }
+
+      if (isFrameNumber)
+        rangeFrames[range].push_back(number);
+      line = q + 1;
+    }
+  };
+
+  if (pThreadPool != NULL)
+    pThreadPool->ParallelFor(numRanges, scanRange);
+  else
+    scanRange(0);
+
+  for(int range = 0; range < numRanges; range++)
+    frames.insert(frames.end(), rangeFrames[range].begin(), rangeFrames[range].end());
+}
+
+const char * AMCParser::ParseInteger(const char * p, const char * end, int * value)
+{
+  const char * start = p;
+  int result = 0;
+  while ((p < end) && IsDigit(*p))
+  {
+    result = 10 * result + (*p - '0');
+    p++;
+  }
+
+  if ((p == start) || ((p < end) && !IsWhitespace(*p)))
+    return NULL;
+
+  *value = result;
+  return p;
+}
+
+const char * AMCParser::ParseDouble(const char * p, const char * end, double * value)
+{
+  // exact powers of ten that can be represented as a double
+  static const double powersOf10[] = 
+  { 
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11, 
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 
+  };
+
+  const char * start = p;
+
+  int negative = 0;
+  if ((p < end) && ((*p == '-') || (*p == '+')))
+  {
+    negative = (*p == '-');
+    p++;
+  }
+
+  // accumulate up to 19 significant digits into an integer mantissa
+  unsigned long long mantissa = 0;
+  int numDigits = 0;
+  int numSignificantDigits = 0;
+  int exponent = 0;
+
+  while ((p < end) && IsDigit(*p))
+  {
+    if (numSignificantDigits < 19)
+      mantissa = 10 * mantissa + (*p - '0');
+    else
+      exponent++;
+    if (mantissa > 0)
+      numSignificantDigits++;
+    numDigits++;
+    p++;
+  }
+
+  if ((p < end) && (*p == '.'))
+  {
+    p++;
+    while ((p < end) && IsDigit(*p))
+    {
+      if (numSignificantDigits < 19)
+      {
+        mantissa = 10 * mantissa + (*p - '0');
+        exponent--;
+      }
+      if (mantissa > 0)
+        numSignificantDigits++;
+      numDigits++;
+      p++;
+    }
+  }
+
+  if (numDigits == 0)
+    return NULL;
+
+  if ((p < end) && ((*p == 'e') || (*p == 'E')))
+  {
+    const char * q = p + 1;
+    int negativeExponent = 0;
+    if ((q < end) && ((*q == '-') || (*q == '+')))
+    {
+      negativeExponent = (*q == '-');
+      q++;
+    }
+    if ((q < end) && IsDigit(*q))
+    {
+      int explicitExponent = 0;
+      while ((q < end) && IsDigit(*q))
+      {
+        if (explicitExponent < 100000)
+          explicitExponent = 10 * explicitExponent + (*q - '0');
+        q++;
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+      p = q;
+    }
+  }
+
+  if ((p < end) && !IsWhitespace(*p))
+    return NULL;
+
+  if ((numSignificantDigits <= 19) && (mantissa <= (1ULL << 53)) && (exponent >= -22) && (exponent <= 22))
+  {
+    // the mantissa and the power of ten are exact, so a single multiplication (division) 
+    // gives the correctly rounded result, as strtod does
+    double result = (double)mantissa;
+    if (exponent < 0)
+      result /= powersOf10[-exponent];
+    else
+      result *= powersOf10[exponent];
+    *value = negative ? -result : result;
+  }
+  else
+  {
+    // rare case (more than 16 significant digits, or a large exponent)
+    std::string token(start, p - start);
+    *value = strtod(token.c_str(), NULL);
+  }
+
+  return p;
+}
+
+const char * AMCParser::ParseFrame(const char * p, const char * end, Posture & posture, int * frameNumber, int * boneOrder, int quiet) const
+{
+  //read frame number
+  p = SkipWhitespace(p, end);
+  p = ParseInteger(p, end, frameNumber);
+  if (p == NULL)
+  {
+    if (!quiet)
+      printf("Error: expected a frame number in the AMC file.\n");
+    return NULL;
+  }
+
+  // read bone lines, until the next frame number
+  for(int line = 0; ; line++)
+  {
+    p = SkipWhitespace(p, end);
+    if ((p == end) || IsDigit(*p))
+      break;
+
+    //read bone name
+    const char * name = p;
+    p = SkipToken(p, end);
+
+    //find the bone index corresponding to the bone name (first try the bone at this line of the previous frame)
+    int length = (int)(p - name);
+    int bone_idx = ((boneOrder != NULL) && (line < m_NumBones)) ? boneOrder[line] : -1;
+    if ((bone_idx < 0) || (strncmp(m_pSkeleton->idx2name(bone_idx), name, length) != 0) || (m_pSkeleton->idx2name(bone_idx)[length] != 0))
+    {
+      bone_idx = m_pSkeleton->name2idx(name, length);
+      if ((bone_idx < 0) || (bone_idx >= m_NumBones))
+      {
+        if (!quiet)
+          printf("Error: bone %.*s in frame %d is not in the skeleton.\n", length, name, *frameNumber);
+        return NULL;
+      }
+      if ((boneOrder != NULL) && (line < m_NumBones))
+        boneOrder[line] = bone_idx;
+    }
+
+    //init rotation angles for this bone to (0, 0, 0)
+    posture.bone_rotation[bone_idx].setValue(0.0, 0.0, 0.0);
+
+    for(int x = 0; x < m_pBoneDOF[bone_idx]; x++)
+    {
+      double tmp;
+      p = ParseDouble(SkipWhitespace(p, end), end, &tmp);
+      if (p == NULL)
+      {
+        if (!quiet)
+          printf("Error: invalid value for bone %s in frame %d.\n", m_pSkeleton->idx2name(bone_idx), *frameNumber);
+        return NULL;
+      }
+
+      switch (m_pBoneDOFOrder[bone_idx][x]) 
+      {
+      case 0:
+        printf("FATAL ERROR in bone %d not found %d\n",bone_idx,x);
+        x = m_pBoneDOF[bone_idx];
+        break;
+      case 1:
+        posture.bone_rotation[bone_idx].p[0] = tmp;
+        break;
+      case 2:
+        posture.bone_rotation[bone_idx].p[1] = tmp;
+        break;
+      case 3:
+        posture.bone_rotation[bone_idx].p[2] = tmp;
+        break;
+      case 4:
+        posture.bone_translation[bone_idx].p[0] = tmp * m_Scale;
+        break;
+      case 5:
+        posture.bone_translation[bone_idx].p[1] = tmp * m_Scale;
+        break;
+      case 6:
+        posture.bone_translation[bone_idx].p[2] = tmp * m_Scale;
+        break;
+      case 7:
+        posture.bone_length[bone_idx].p[0] = tmp;// * scale;
+        break;
+      }
+    }
+
+    if (bone_idx == Skeleton::getRootIndex())
+      posture.root_pos = posture.bone_translation[bone_idx];
+  }
+
+  return p;
+}
+
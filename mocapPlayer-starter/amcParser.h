@@ -0,0 +1,96 @@
+/*
+amcParser.h
+
+Single-pass parser for AMC motion files.
+
+The parser works directly on the file contents in memory (see mappedFile.h):
+it tokenizes the text in place, converts numbers with a hand-written 
+floating point parser (with results identical to strtod), and resolves 
+bone names through the name table of the skeleton (Skeleton::name2idx).
+The bone lines of AMC files are nearly always in the same order in every
+frame, so the parser can first try the bone that was at the same line of
+the previous frame (see ParseFrame), and only look up the name if it differs.
+
+Usage (see Motion::readAMCfile):
+  p = AMCParser::ParseHeader(p, end, &forceAllJointsBe3DOF);
+  AMCParser parser(pSkeleton, scale, forceAllJointsBe3DOF);
+  std::vector<int> boneOrder(parser.GetNumBones(), -1);
+  while (p < end)
+    p = parser.ParseFrame(p, end, posture, &frameNumber, boneOrder.data());
+
+ParseFrame does not modify the parser, so several threads can parse 
+different frames (located with FindFrames) at the same time, each with 
+its own bone order.
+*/
+
+#ifndef _AMCPARSER_H_
+#define _AMCPARSER_H_
+
+#include <vector>
+#include "skeleton.h"
+#include "posture.h"
+#include "threadPool.h"
+
+class AMCParser
+{
+public:
+  // The parser copies the DOFs of the bones as given in the ASF file (see Skeleton::getFileDOFOrder), with all
+  // rotational DOFs if forceAllJointsBe3DOF is set (by the header of the file); the skeleton is not modified.
+  // The bone names are looked up in the skeleton, which must exist as long as the parser.
+  // scale is applied to the bone translations (see Motion).
+  AMCParser(const Skeleton * pSkeleton, double scale, int forceAllJointsBe3DOF=0);
+  ~AMCParser();
+
+  // Skips the header of the file (everything up to and including ":DEGREES").
+  // Returns a pointer to the first frame, or NULL if the header is incomplete.
+  // forceAllJointsBe3DOF is set to 1 if the header contains ":FORCE-ALL-JOINTS-BE-3DOF", and 0 otherwise.
+  static const char * ParseHeader(const char * p, const char * end, int * forceAllJointsBe3DOF);
+
+  // Parses one frame (the frame number line, followed by bone lines) into posture.
+  // The posture must have as many bones as the skeleton.
+  // boneOrder (optional) holds GetNumBones() values, initialized to -1: boneOrder[k] is the bone of the k-th bone line
+  // of the previous frame parsed with it; it is tried first for the k-th line of this frame, and updated.
+  // Returns a pointer past the frame (at the next frame number, or at the end), or NULL on error.
+  // The error is printed, unless quiet is non-zero.
+  const char * ParseFrame(const char * p, const char * end, Posture & posture, int * frameNumber, int * boneOrder=NULL, int quiet=0) const;
+
+  int GetNumBones() const { return m_NumBones; }
+
+  // Locates the frames between p (the end of the header) and end: each frame starts at a line that 
+  // contains only an integer (the frame number). The pointers to the frame numbers are stored in frames.
+  // If pThreadPool is not NULL, the text is scanned in parallel.
+  static void FindFrames(const char * p, const char * end, std::vector<const char *> & frames, ThreadPool * pThreadPool=NULL);
+
+  // Parses a floating point number at p; the result is identical to strtod.
+  // Returns a pointer past the number, or NULL if there is no number at p.
+  static const char * ParseDouble(const char * p, const char * end, double * value);
+
+  // Parses a non-negative integer at p that forms a complete token (such as a frame number).
+  // Returns a pointer past the integer, or NULL if the token at p is not an integer.
+  static const char * ParseInteger(const char * p, const char * end, int * value);
+
+  static inline int IsWhitespace(char c) { return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t') || (c == '\v') || (c == '\f'); }
+  static inline int IsDigit(char c) { return (c >= '0') && (c <= '9'); }
+  static inline const char * SkipWhitespace(const char * p, const char * end)
+  {
+    while ((p < end) && IsWhitespace(*p))
+      p++;
+    return p;
+  }
+  static inline const char * SkipToken(const char * p, const char * end)
+  {
+    while ((p < end) && !IsWhitespace(*p))
+      p++;
+    return p;
+  }
+
+protected:
+  const Skeleton * m_pSkeleton;
+  double m_Scale;
+  int m_NumBones;
+  int * m_pBoneDOF; // number of DOFs of each bone, as listed in the AMC file
+  int (*m_pBoneDOFOrder)[8]; // order of the DOFs of each bone (see Bone::dofo)
+};
+
+#endif
+
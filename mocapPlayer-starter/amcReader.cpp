@@ -0,0 +1,159 @@
+/*
+amcReader.cpp
+
+Streaming reader for AMC motion files.
+*/
+
+#ifdef WIN32
+  #define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "amcReader.h"
+
+AMCReader::AMCReader(const Skeleton * pSkeleton, double scale_)
+{
+  m_pSkeleton = pSkeleton;
+  m_Scale = scale_;
+  m_pParser = NULL;
+  m_pBoneOrder = NULL;
+  m_pFile = NULL;
+  m_BufferSize = 1 << 16;
+  m_pBuffer = (char*) malloc(m_BufferSize);
+  m_Start = m_End = 0;
+  m_EndOfFile = 0;
+  m_ForceAllJointsBe3DOF = 0;
+  m_NumFrames = 0;
+}
+
+AMCReader::~AMCReader()
+{
+  Close();
+  free(m_pBuffer);
+}
+
+void AMCReader::Close()
+{
+  if (m_pFile != NULL)
+    fclose(m_pFile);
+  m_pFile = NULL;
+  delete m_pParser;
+  m_pParser = NULL;
+  delete [] m_pBoneOrder;
+  m_pBoneOrder = NULL;
+}
+
+int AMCReader::Fill()
+{
+  if (m_EndOfFile)
+    return -1;
+
+  memmove(m_pBuffer, m_pBuffer + m_Start, m_End - m_Start);
+  m_End -= m_Start;
+  m_Start = 0;
+  if (m_End == m_BufferSize)
+  {
+    m_BufferSize *= 2;
+    m_pBuffer = (char*) realloc(m_pBuffer, m_BufferSize);
+  }
+
+  size_t size = fread(m_pBuffer + m_End, 1, m_BufferSize - m_End, m_pFile);
+  m_End += size;
+  if (size == 0)
+  {
+    m_EndOfFile = 1;
+    return -1;
+  }
+  return 0;
+}
+
+int AMCReader::Open(const char * filename)
+{
+  Close();
+  m_pFile = fopen(filename, "rb");
+  if (m_pFile == NULL)
+  {
+    printf("Error: cannot open %s.\n", filename);
+    return -1;
+  }
+  m_Start = m_End = 0;
+  m_EndOfFile = 0;
+  m_NumFrames = 0;
+
+  // read until the buffer contains the whole header (the :DEGREES token, followed by whitespace)
+  const char * p;
+  while (1)
+  {
+    p = AMCParser::ParseHeader(m_pBuffer + m_Start, m_pBuffer + m_End, &m_ForceAllJointsBe3DOF);
+    if ((p != NULL) && ((p < m_pBuffer + m_End) || m_EndOfFile))
+      break;
+    if (Fill() != 0)
+    {
+      p = AMCParser::ParseHeader(m_pBuffer + m_Start, m_pBuffer + m_End, &m_ForceAllJointsBe3DOF);
+      if (p != NULL)
+        break;
+      printf("Error: no :DEGREES line in the header of '%s'.\n", filename);
+      Close();
+      return -1;
+    }
+  }
+  m_Start = p - m_pBuffer;
+
+  m_pParser = new AMCParser(m_pSkeleton, m_Scale, m_ForceAllJointsBe3DOF);
+  m_pBoneOrder = new int[m_pParser->GetNumBones()];
+  for(int j = 0; j < m_pParser->GetNumBones(); j++)
+    m_pBoneOrder[j] = -1;
+  return 0;
+}
+
+const char * AMCReader::FindFrameEnd(const char * p, const char * end)
+{
+  // skip the frame number line
+  p = (const char *) memchr(p, '\n', end - p);
+  while (p != NULL)
+  {
+    const char * q = p + 1;
+    while ((q < end) && ((*q == ' ') || (*q == '\t') || (*q == '\r') || (*q == '\n')))
+      q++;
+    if (q == end)
+      break;
+    if (AMCParser::IsDigit(*q))
+      return q;
+    p = (const char *) memchr(q, '\n', end - q);
+  }
+  return m_EndOfFile ? end : NULL;
+}
+
+int AMCReader::ReadFrame(Posture & posture, int * frameNumber)
+{
+  if (m_pParser == NULL)
+    return -1;
+
+  const char * frameEnd;
+  while (1)
+  {
+    const char * p = AMCParser::SkipWhitespace(m_pBuffer + m_Start, m_pBuffer + m_End);
+    m_Start = p - m_pBuffer;
+    if ((m_Start == m_End) && (Fill() != 0))
+      return 0;
+    if (m_Start == m_End)
+      continue;
+
+    frameEnd = FindFrameEnd(m_pBuffer + m_Start, m_pBuffer + m_End);
+    if (frameEnd != NULL)
+      break;
+    Fill();
+  }
+
+  const char * p = m_pParser->ParseFrame(m_pBuffer + m_Start, frameEnd, posture, frameNumber, m_pBoneOrder);
+  if (p != frameEnd)
+  {
+    printf("Error: failed to parse frame %d of the AMC file.\n", m_NumFrames + 1);
+    return -1;
+  }
+  m_Start = p - m_pBuffer;
+  m_NumFrames++;
+  return 1;
+}
+
@@ -0,0 +1,67 @@
+/*
+amcReader.h
+
+Streaming reader for AMC motion files.
+
+The file is read in blocks into a buffer that holds only a few frames at a
+time (the buffer grows only if a single frame does not fit), so that files
+of any length can be read with a fixed amount of memory. The frames are
+parsed with AMCParser (the results are the same as those of Motion::readAMCfile).
+
+Usage (see StreamingInterpolator):
+  AMCReader reader(pSkeleton, scale);
+  if (reader.Open(filename) != 0) ... // error
+  while ((code = reader.ReadFrame(posture, &frameNumber)) == 1)
+    ... // process posture
+  if (code < 0) ... // error
+*/
+
+#ifndef _AMCREADER_H_
+#define _AMCREADER_H_
+
+#include <stdio.h>
+#include "skeleton.h"
+#include "posture.h"
+#include "amcParser.h"
+
+class AMCReader
+{
+public:
+  // scale is applied to the bone translations (see Motion)
+  AMCReader(const Skeleton * pSkeleton, double scale);
+  ~AMCReader();
+
+  // Opens the file and reads its header; returns 0 on success, -1 on failure.
+  // If the header contains ":FORCE-ALL-JOINTS-BE-3DOF", the frames are parsed with all rotational DOFs (the skeleton is not modified).
+  int Open(const char * filename);
+  // Reads the next frame into posture (which must have as many bones as the skeleton).
+  // Returns 1 if a frame was read, 0 at the end of the file, and -1 on error.
+  int ReadFrame(Posture & posture, int * frameNumber);
+  void Close();
+
+  int GetForceAllJointsBe3DOF() { return m_ForceAllJointsBe3DOF; }
+
+protected:
+  const Skeleton * m_pSkeleton;
+  double m_Scale;
+  AMCParser * m_pParser; // created after the header has been read
+  int * m_pBoneOrder; // bone order of the last frame (see AMCParser::ParseFrame)
+
+  FILE * m_pFile;
+  char * m_pBuffer;
+  size_t m_BufferSize;
+  size_t m_Start, m_End; // unprocessed data in the buffer
+  int m_EndOfFile;
+  int m_ForceAllJointsBe3DOF;
+  int m_NumFrames; // number of frames read
+
+  // moves the unprocessed data to the start of the buffer (growing the buffer if it is full), and appends the
+  // next block of the file; returns 0 on success, -1 at the end of the file or on error
+  int Fill();
+  // end of the frame that starts at p: the start of the next line that begins with a digit (the next frame number),
+  // or end at the end of the file; NULL if the buffer does not contain the whole frame
+  const char * FindFrameEnd(const char * p, const char * end);
+};
+
+#endif
+
@@ -0,0 +1,183 @@
+/*
+amcWriter.cpp
+
+Buffered writer for AMC motion files.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "amcWriter.h"
+#include "doubleFormat.h"
+
+AMCWriter::AMCWriter(const Skeleton * pSkeleton, double scale_)
+{
+  m_Scale = scale_;
+
+  const Bone * bone = pSkeleton->getRoot();
+  int numBones = pSkeleton->getNumBones();
+
+  m_pOutputBones = new int[numBones];
+  m_pNumOutputComponents = new int[numBones];
+  m_pOutputComponents = new int[numBones][8];
+  m_pBoneNames = new char[numBones][256];
+  m_pBoneNameLengths = new int[numBones];
+
+  // "root" line: 3 translations and 3 rotations
+  m_MaxFrameSize = 16 + 5 + 6 * (DOUBLE_FORMAT_MAX_LENGTH + 1) + 1;
+
+  // the bone order is the same as in the original AMC writer: bones 0 (root) and 1 are not listed, 
+  // and only the enabled rotational DOFs are written, in the order given by the ASF file
+  m_NumOutputBones = 0;
+  for(int j = 2; j < numBones; j++) 
+  {
+    if (bone[j].dof == 0)
+      continue;
+
+    int k = m_NumOutputBones;
+    m_pOutputBones[k] = j;
+    strcpy(m_pBoneNames[k], pSkeleton->idx2name(j));
+    m_pBoneNameLengths[k] = (int)strlen(m_pBoneNames[k]);
+
+    m_pNumOutputComponents[k] = 0;
+    for(int d = 0; (d < bone[j].dof) && (d < 8); d++)
+    {
+      int component = -1;
+      if ((bone[j].dofo[d] == 1) && (bone[j].dofrx == 1))
+        component = 0;
+      else if ((bone[j].dofo[d] == 2) && (bone[j].dofry == 1))
+        component = 1;
+      else if ((bone[j].dofo[d] == 3) && (bone[j].dofrz == 1))
+        component = 2;
+
+      if (component >= 0)
+        m_pOutputComponents[k][m_pNumOutputComponents[k]++] = component;
+    }
+
+    m_MaxFrameSize += 1 + m_pBoneNameLengths[k] + m_pNumOutputComponents[k] * (DOUBLE_FORMAT_MAX_LENGTH + 1);
+    m_NumOutputBones++;
+  }
+
+  m_BufferSize = 1 << 20;
+  if (m_BufferSize < 4 * m_MaxFrameSize)
+    m_BufferSize = 4 * m_MaxFrameSize;
+  m_pBuffer = (char*) malloc(m_BufferSize);
+  m_BufferUsed = 0;
+
+  m_pFile = NULL;
+  m_Error = 0;
+}
+
+AMCWriter::~AMCWriter()
+{
+  Close();
+  free(m_pBuffer);
+  delete [] m_pOutputBones;
+  delete [] m_pNumOutputComponents;
+  delete [] m_pOutputComponents;
+  delete [] m_pBoneNames;
+  delete [] m_pBoneNameLengths;
+}
+
+int AMCWriter::Open(const char * filename, int forceAllJointsBe3DOF)
+{
+  Close();
+
+  m_pFile = fopen(filename, "wb");
+  if (m_pFile == NULL)
+    return -1;
+
+  // the data is buffered here, so that each flush is a single write to the file
+  setvbuf(m_pFile, NULL, _IONBF, 0);
+  m_BufferUsed = 0;
+  m_Error = 0;
+
+  const char * fullySpecified = ":FULLY-SPECIFIED\n";
+  const char * force = ":FORCE-ALL-JOINTS-BE-3DOF\n";
+  const char * degrees = ":DEGREES\n";
+  Append(fullySpecified, (int)strlen(fullySpecified));
+  if (forceAllJointsBe3DOF)
+    Append(force, (int)strlen(force));
+  Append(degrees, (int)strlen(degrees));
+
+  return 0;
+}
+
+int AMCWriter::Close()
+{
+  if (m_pFile == NULL)
+    return 0;
+
+  Flush();
+  if (fclose(m_pFile) != 0)
+    m_Error = 1;
+  m_pFile = NULL;
+
+  return m_Error ? -1 : 0;
+}
+
+int AMCWriter::Flush()
+{
+  if ((m_BufferUsed > 0) && (fwrite(m_pBuffer, 1, m_BufferUsed, m_pFile) != m_BufferUsed))
+    m_Error = 1;
+  m_BufferUsed = 0;
+  return m_Error ? -1 : 0;
+}
+
+inline void AMCWriter::Append(const char * text, int length)
+{
+  memcpy(&m_pBuffer[m_BufferUsed], text, length);
+  m_BufferUsed += length;
+}
+
+inline void AMCWriter::AppendDouble(double value)
+{
+  m_pBuffer[m_BufferUsed++] = ' ';
+  m_BufferUsed += FormatDouble(value, &m_pBuffer[m_BufferUsed]);
+}
+
+int AMCWriter::WriteFrame(int frameNumber, const Posture & posture)
+{
+  if (m_pFile == NULL)
+    return -1;
+
+  if (m_BufferUsed + m_MaxFrameSize > m_BufferSize)
+    Flush();
+
+  // frame number
+  char number[16];
+  int length = 0;
+  unsigned int n = (frameNumber < 0) ? -(unsigned int)frameNumber : frameNumber;
+  do
+  {
+    number[length++] = (char)('0' + n % 10);
+    n /= 10;
+  } 
+  while (n > 0);
+  if (frameNumber < 0)
+    m_pBuffer[m_BufferUsed++] = '-';
+  while (length > 0)
+    m_pBuffer[m_BufferUsed++] = number[--length];
+
+  // root
+  Append("\nroot", 5);
+  int root = Skeleton::getRootIndex();
+  for(int i = 0; i < 3; i++)
+    AppendDouble(posture.root_pos.p[i] / m_Scale);
+  for(int i = 0; i < 3; i++)
+    AppendDouble(posture.bone_rotation[root].p[i]);
+
+  // bones
+  for(int k = 0; k < m_NumOutputBones; k++)
+  {
+    m_pBuffer[m_BufferUsed++] = '\n';
+    Append(m_pBoneNames[k], m_pBoneNameLengths[k]);
+
+    const double * rotation = posture.bone_rotation[m_pOutputBones[k]].p;
+    for(int i = 0; i < m_pNumOutputComponents[k]; i++)
+      AppendDouble(rotation[m_pOutputComponents[k][i]]);
+  }
+  m_pBuffer[m_BufferUsed++] = '\n';
+
+  return m_Error ? -1 : 0;
+}
+
@@ -0,0 +1,66 @@
+/*
+amcWriter.h
+
+Buffered writer for AMC motion files.
+
+The output order of the bone DOFs is computed once from the skeleton.
+Each frame is formatted into a large buffer (numbers are written with 
+FormatDouble, see doubleFormat.h), and the buffer is written to the 
+file with a single call whenever it fills up.
+
+Usage (see Motion::writeAMCfile):
+  AMCWriter writer(pSkeleton, scale);
+  if (writer.Open(filename, forceAllJointsBe3DOF) != 0) ... // error
+  for(int f=0; f<numFrames; f++)
+    writer.WriteFrame(f+1, posture[f]);
+  if (writer.Close() != 0) ... // error
+*/
+
+#ifndef _AMCWRITER_H_
+#define _AMCWRITER_H_
+
+#include <stdio.h>
+#include "skeleton.h"
+#include "posture.h"
+
+class AMCWriter
+{
+public:
+  // The writer copies the bone DOFs of the skeleton.
+  // scale is the inverse of the factor applied to the root position (see Motion).
+  AMCWriter(const Skeleton * pSkeleton, double scale);
+  ~AMCWriter();
+
+  // Creates the file and writes the header; returns 0 on success, -1 on failure.
+  int Open(const char * filename, int forceAllJointsBe3DOF=0);
+  // Writes one frame (the frame number line, followed by the root and bone lines).
+  // The posture must have as many bones as the skeleton. Returns 0 on success, -1 on failure.
+  int WriteFrame(int frameNumber, const Posture & posture);
+  // Writes the remaining buffered data and closes the file; returns 0 on success, -1 if any write failed.
+  int Close();
+
+protected:
+  double m_Scale;
+
+  // bones that are written (after the root), and the rotation components written for each of them
+  int m_NumOutputBones;
+  int * m_pOutputBones;
+  int * m_pNumOutputComponents;
+  int (*m_pOutputComponents)[8]; // 0 = rx, 1 = ry, 2 = rz
+  char (*m_pBoneNames)[256];
+  int * m_pBoneNameLengths;
+
+  FILE * m_pFile;
+  char * m_pBuffer;
+  size_t m_BufferSize;
+  size_t m_BufferUsed;
+  size_t m_MaxFrameSize; // upper bound on the number of characters in one frame
+  int m_Error;
+
+  void Append(const char * text, int length);
+  void AppendDouble(double value);
+  int Flush();
+};
+
+#endif
+
@@ -0,0 +1,119 @@
+/*
+amcbFile.cpp
+
+Binary motion file format (.amcb).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "amcbFile.h"
+#include "motionChannels.h"
+
+static_assert(sizeof(AMCBHeader) == 64, "the AMCB header must be 64 bytes");
+
+// FNV-1a
+static unsigned int HashBytes(unsigned int hash, const void * data, size_t size)
+{
+  const unsigned char * bytes = (const unsigned char *) data;
+  for(size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+unsigned int AMCBFile::HashSkeleton(const Skeleton * pSkeleton)
+{
+  int numBones = pSkeleton->getNumBones();
+
+  unsigned int hash = 2166136261u;
+  hash = HashBytes(hash, &numBones, sizeof(int));
+  for(int j = 0; j < numBones; j++)
+  {
+    const char * name = pSkeleton->idx2name(j);
+    hash = HashBytes(hash, name, strlen(name) + 1); // including the terminating 0
+  }
+  return hash;
+}
+
+void AMCBFile::InitHeader(AMCBHeader * header, const Skeleton * pSkeleton, int numFrames, int valueType, double scale, double frameRate, int flags)
+{
+  memset(header, 0, sizeof(AMCBHeader));
+  memcpy(header->magic, "AMCB", 4);
+  header->version = AMCB_VERSION;
+  header->byteOrder = AMCB_BYTE_ORDER;
+  header->skeletonHash = HashSkeleton(pSkeleton);
+  header->numFrames = numFrames;
+  header->numBones = pSkeleton->getNumBones();
+  header->numChannels = MotionChannels::GetNumChannels(header->numBones);
+  header->channelLayout = AMCB_LAYOUT_CHANNELS;
+  header->valueType = valueType;
+  header->flags = flags;
+  header->frameRate = frameRate;
+  header->scale = scale;
+  header->dataOffset = sizeof(AMCBHeader);
+}
+
+int AMCBFile::CheckHeader(const AMCBHeader & header, size_t fileSize, const Skeleton * pSkeleton, const char * filename)
+{
+  if (memcmp(header.magic, "AMCB", 4) != 0)
+  {
+    printf("Error: %s is not an AMCB file.\n", filename);
+    return -1;
+  }
+
+  if (header.byteOrder != AMCB_BYTE_ORDER)
+  {
+    printf("Error: %s was written on a machine with a different byte order.\n", filename);
+    return -1;
+  }
+
+  if (header.version != AMCB_VERSION)
+  {
+    printf("Error: %s has unsupported version %u.\n", filename, header.version);
+    return -1;
+  }
+
+  int numBones = pSkeleton->getNumBones();
+  if ((header.numBones != numBones) || (header.skeletonHash != HashSkeleton(pSkeleton)))
+  {
+    printf("Error: %s was written for a different skeleton (%d bones, hash %08x; the skeleton has %d bones, hash %08x).\n", 
+      filename, header.numBones, header.skeletonHash, numBones, HashSkeleton(pSkeleton));
+    return -1;
+  }
+
+  if ((header.channelLayout != AMCB_LAYOUT_CHANNELS) || (header.numChannels != MotionChannels::GetNumChannels(numBones)) ||
+      ((header.valueType != AMCB_DOUBLE) && (header.valueType != AMCB_FLOAT)) || (header.numFrames < 0) || 
+      (header.dataOffset < sizeof(AMCBHeader)) || (header.dataOffset % sizeof(double) != 0) || (header.scale <= 0.0))
+  {
+    printf("Error: %s has an invalid header.\n", filename);
+    return -1;
+  }
+
+  size_t dataSize = (size_t)header.numChannels * header.numFrames * GetValueSize(header.valueType);
+  if (fileSize < header.dataOffset + dataSize)
+  {
+    printf("Error: %s is truncated (%d frames require %lu bytes, the file has %lu bytes).\n", 
+      filename, header.numFrames, (unsigned long)(header.dataOffset + dataSize), (unsigned long)fileSize);
+    return -1;
+  }
+
+  return 0;
+}
+
+int AMCBFile::IsAMCBFilename(const char * filename)
+{
+  size_t length = strlen(filename);
+  if (length < 5)
+    return 0;
+
+  const char * extension = &filename[length - 5];
+  const char * amcb = ".amcb";
+  for(int i = 0; i < 5; i++)
+    if (tolower((unsigned char)extension[i]) != amcb[i])
+      return 0;
+  return 1;
+}
+
@@ -0,0 +1,81 @@
+/*
+amcbFile.h
+
+Binary motion file format (.amcb).
+
+An AMCB file stores the same data as an AMC file (root position and 
+rotation angles of all bones, for each frame), in the channel layout of 
+MotionChannels, so that it can be memory-mapped and used without parsing
+(see Motion::Motion(char * amcb_filename, ...) and Motion::writeAMCBfile).
+
+File layout (native byte order):
+  AMCBHeader (64 bytes)
+  channel data at header.dataOffset: numChannels arrays of numFrames values 
+  (double or float, see valueType), channel after channel as in motionChannels.h
+  Root positions are stored in skeleton units (already multiplied by scale).
+
+The skeleton hash identifies the bones (number, order and names) 
+that the channels refer to; a file can only be loaded with a skeleton that has the same hash.
+*/
+
+#ifndef _AMCBFILE_H_
+#define _AMCBFILE_H_
+
+#include <stddef.h>
+#include "skeleton.h"
+
+#define AMCB_VERSION 1
+#define AMCB_BYTE_ORDER 0x01020304u
+
+// channel layouts
+#define AMCB_LAYOUT_CHANNELS 0 // channel-major (see motionChannels.h)
+
+// value types
+#define AMCB_DOUBLE 0
+#define AMCB_FLOAT 1
+
+// flags
+#define AMCB_FORCE_ALL_JOINTS_BE_3DOF 1 // as ":FORCE-ALL-JOINTS-BE-3DOF" in AMC files
+
+#define AMCB_DEFAULT_FRAME_RATE 120.0
+
+struct AMCBHeader
+{
+  char magic[4]; // "AMCB"
+  unsigned int version; // AMCB_VERSION
+  unsigned int byteOrder; // AMCB_BYTE_ORDER, as stored by the writer
+  unsigned int skeletonHash;
+  int numFrames;
+  int numBones;
+  int numChannels; // 3 + 3 * numBones
+  int channelLayout; // AMCB_LAYOUT_*
+  int valueType; // AMCB_DOUBLE or AMCB_FLOAT
+  int flags; // AMCB_FORCE_ALL_JOINTS_BE_3DOF or 0
+  double frameRate; // frames per second
+  double scale; // scale of the root positions
+  unsigned int dataOffset; // offset of the channel data from the start of the file
+  unsigned int reserved;
+};
+
+class AMCBFile
+{
+public:
+  // hash of the number of bones and the bone names, in bone index order
+  static unsigned int HashSkeleton(const Skeleton * pSkeleton);
+
+  // fills in a header for numFrames frames of the skeleton
+  static void InitHeader(AMCBHeader * header, const Skeleton * pSkeleton, int numFrames, int valueType, double scale, double frameRate, int flags);
+
+  // checks a header read from a file of fileSize bytes against the skeleton
+  // returns 0 if the file can be loaded, and -1 otherwise (an error message is printed)
+  static int CheckHeader(const AMCBHeader & header, size_t fileSize, const Skeleton * pSkeleton, const char * filename);
+
+  // size of one value of the given type, in bytes
+  static int GetValueSize(int valueType) { return (valueType == AMCB_FLOAT) ? sizeof(float) : sizeof(double); }
+
+  // returns 1 if filename ends with ".amcb" (case-insensitive), and 0 otherwise
+  static int IsAMCBFilename(const char * filename);
+};
+
+#endif
+
@@ -0,0 +1,919 @@
+#ifdef WIN32
+  #define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "interpolator.h"
+#include "motionSampler.h"
+#include "keyframeSelector.h"
+#include "motionCodec.h"
+#include "forwardKinematics.h"
+#include "threadPool.h"
+#include "motion.h"
+#include "skeleton.h"
+#include "types.h"
+#include "quaternionBatch.h"
+#include "performanceCounter.h"
+
+// uniformly distributed random number on [a,b] (deterministic sequence, so that runs are comparable)
+static double Random(double a, double b)
+{
+  return a + (b - a) * rand() / RAND_MAX;
+}
+
+// random unit quaternion
+static Quaternion<double> RandomQuaternion()
+{
+  Quaternion<double> q(Random(-1.0, 1.0), Random(-1.0, 1.0), Random(-1.0, 1.0), Random(-1.0, 1.0));
+  q.Normalize();
+  return q;
+}
+
+// random unit quaternion close to q (rotated by at most about maxAngle radians)
+static Quaternion<double> PerturbQuaternion(Quaternion<double> q, double maxAngle)
+{
+  double h = 0.5 * maxAngle;
+  Quaternion<double> p = q + Quaternion<double>(0.0, Random(-h, h), Random(-h, h), Random(-h, h)) * q;
+  p.Normalize();
+  return p;
+}
+
+// largest component difference between quaternion k of the arrays q and the quaternion r
+static double QuaternionError(double * const q[4], int k, Quaternion<double> r)
+{
+  double error = fabs(q[0][k] - r.Gets());
+  error = fmax(error, fabs(q[1][k] - r.Getx()));
+  error = fmax(error, fabs(q[2][k] - r.Gety()));
+  error = fmax(error, fabs(q[3][k] - r.Getz()));
+  return error;
+}
+
+// quaternion k of the arrays q
+static Quaternion<double> GetQuaternion(double * const q[4], int k)
+{
+  return Quaternion<double>(q[0][k], q[1][k], q[2][k], q[3][k]);
+}
+
+// slerp mode: compares SlerpBatch and DeCasteljauQuaternionBatch with Interpolator::Slerp and DeCasteljauQuaternion
+static int BenchmarkSlerp(int count, int repetitions)
+{
+  // test data: random quaternion pairs; a quarter of them nearly identical, a quarter nearly opposite
+  // (both branches of the slerp, and the shorter-arc sign flip); t in [-0.5,1.5], and the values used by the Bezier control points
+  double * data = (double*) malloc (sizeof(double) * count * (4 * 6 + 1));
+  double * q0[4], * q1[4], * q2[4], * q3[4], * result[4], * batchResult[4];
+  GetQuaternionArrays(data, count, q0);
+  GetQuaternionArrays(data + 4 * count, count, q1);
+  GetQuaternionArrays(data + 8 * count, count, q2);
+  GetQuaternionArrays(data + 12 * count, count, q3);
+  GetQuaternionArrays(data + 16 * count, count, result);
+  GetQuaternionArrays(data + 20 * count, count, batchResult);
+  double * t = data + 24 * count;
+
+  srand(1);
+  const double specialT[] = { 0.0, 1.0, 2.0, 0.5, 1.0 / 3, -1.0 / 3 };
+  Quaternion<double> * a = new Quaternion<double>[4 * count];
+  for(int k=0; k<count; k++)
+  {
+    for(int i=0; i<4; i++)
+      a[4 * k + i] = RandomQuaternion();
+    if (k % 4 == 1)
+      a[4 * k + 1] = PerturbQuaternion(a[4 * k], 0.05);
+    else if (k % 4 == 2)
+      a[4 * k + 1] = -1.0 * PerturbQuaternion(a[4 * k], 0.05);
+    t[k] = (k % 8 < 6) ? specialT[k % 8] : Random(-0.5, 1.5);
+    double ** controlPoints[4] = { q0, q1, q2, q3 };
+    for(int i=0; i<4; i++)
+    {
+      controlPoints[i][0][k] = a[4 * k + i].Gets();
+      controlPoints[i][1][k] = a[4 * k + i].Getx();
+      controlPoints[i][2][k] = a[4 * k + i].Gety();
+      controlPoints[i][3][k] = a[4 * k + i].Getz();
+    }
+  }
+
+  // accuracy
+  Interpolator interpolator;
+  SlerpBatch(count, t, 1, q0, q1, batchResult);
+  double slerpError = 0.0;
+  for(int k=0; k<count; k++)
+  {
+    Quaternion<double> p0 = a[4 * k], p1 = a[4 * k + 1];
+    slerpError = fmax(slerpError, QuaternionError(batchResult, k, interpolator.Slerp(t[k], p0, p1)));
+  }
+
+  DeCasteljauQuaternionBatch(count, t, 1, q0, q1, q2, q3, batchResult);
+  double deCasteljauError = 0.0;
+  for(int k=0; k<count; k++)
+  {
+    Quaternion<double> r = interpolator.DeCasteljauQuaternion(t[k], a[4 * k], a[4 * k + 1], a[4 * k + 2], a[4 * k + 3]);
+    deCasteljauError = fmax(deCasteljauError, QuaternionError(batchResult, k, r));
+  }
+
+  printf("Quaternions: %d, repetitions: %d\n", count, repetitions);
+  printf("Max. component error: Slerp %G, DeCasteljauQuaternion %G\n", slerpError, deCasteljauError);
+
+  // speed (the sums keep the compiler from removing the loops)
+  PerformanceCounter counter;
+  double sum = 0.0;
+  counter.StartCounter();
+  for(int repetition=0; repetition<repetitions; repetition++)
+  {
+    for(int k=0; k<count; k++)
+    {
+      Quaternion<double> p0 = a[4 * k], p1 = a[4 * k + 1];
+      Quaternion<double> r = interpolator.Slerp(t[k], p0, p1);
+      result[0][k] = r.Gets();
+      result[1][k] = r.Getx();
+      result[2][k] = r.Gety();
+      result[3][k] = r.Getz();
+    }
+    sum += result[0][repetition % count];
+  }
+  counter.StopCounter();
+  double scalarTime = counter.GetElapsedTime();
+
+  counter.StartCounter();
+  for(int repetition=0; repetition<repetitions; repetition++)
+  {
+    SlerpBatch(count, t, 1, q0, q1, batchResult);
+    sum += batchResult[0][repetition % count];
+  }
+  counter.StopCounter();
+  double batchTime = counter.GetElapsedTime();
+
+  double numSlerps = 1.0 * count * repetitions;
+  printf("Slerp:      %8.2f ns per quaternion\n", 1e9 * scalarTime / numSlerps);
+  printf("SlerpBatch: %8.2f ns per quaternion (%.2fx)\n", 1e9 * batchTime / numSlerps, scalarTime / batchTime);
+  printf("(checksum: %G)\n", sum);
+
+  delete [] a;
+  free(data);
+
+  // the batch versions must agree with the scalar ones (see quaternionBatch.h for the DeCasteljau tolerance)
+  return ((slerpError < 1e-10) && (deCasteljauError < 1e-4)) ? 0 : 1;
+}
+
+// difference of two angles in degrees, modulo 360
+static double AngleError(double angle1, double angle2)
+{
+  double error = fmod(fabs(angle1 - angle2), 360.0);
+  return fmin(error, 360.0 - error);
+}
+
+// euler mode: compares the direct Euler <-> quaternion conversions (scalar and batch) with the conversions through the rotation matrix
+static int BenchmarkEuler(int count, int repetitions)
+{
+  // test data: random angles, and some special cases (zero angles, gimbal lock)
+  double * data = (double*) malloc (sizeof(double) * count * (3 * 2 + 4 * 2));
+  double * angles[3], * outputAngles[3], * batchQ[4], * matrixQ[4];
+  for(int i=0; i<3; i++)
+  {
+    angles[i] = data + i * count;
+    outputAngles[i] = data + (3 + i) * count;
+  }
+  GetQuaternionArrays(data + 6 * count, count, batchQ);
+  GetQuaternionArrays(data + 10 * count, count, matrixQ);
+
+  srand(1);
+  for(int k=0; k<count; k++)
+  {
+    for(int i=0; i<3; i++)
+      angles[i][k] = Random(-180.0, 180.0);
+    if (k % 8 == 1)
+      angles[1][k] = (k % 16 == 1) ? 90.0 : -90.0;
+    else if (k % 8 == 2)
+      angles[k % 3][k] = 0.0;
+  }
+
+  // accuracy; reference: Euler2Rotation + Matrix2Quaternion, and Quaternion2Matrix + Rotation2Euler
+  Interpolator interpolator;
+  EulerToQuaternionBatch(count, angles, batchQ);
+  // q and -q are the same rotation; the sign differs from Matrix2Quaternion only where two components of q
+  // have the same absolute value (e.g., at gimbal lock), and Matrix2Quaternion's choice depends on round-off
+  double quaternionError = 0.0, batchQuaternionError = 0.0;
+  int numSignChanges = 0, numBatchSignChanges = 0;
+  for(int k=0; k<count; k++)
+  {
+    double a[3] = { angles[0][k], angles[1][k], angles[2][k] }, R[9];
+    interpolator.Euler2Rotation(a, R);
+    Quaternion<double> reference = Quaternion<double>::Matrix2Quaternion(R);
+    matrixQ[0][k] = reference.Gets();
+    matrixQ[1][k] = reference.Getx();
+    matrixQ[2][k] = reference.Gety();
+    matrixQ[3][k] = reference.Getz();
+
+    double b[3] = { angles[0][k], angles[1][k], angles[2][k] };
+    Quaternion<double> direct;
+    interpolator.Euler2Quaternion(b, direct);
+    double error = QuaternionError(matrixQ, k, direct), negatedError = QuaternionError(matrixQ, k, -1.0 * direct);
+    numSignChanges += (negatedError < error);
+    quaternionError = fmax(quaternionError, fmin(error, negatedError));
+    error = QuaternionError(batchQ, k, reference);
+    negatedError = QuaternionError(batchQ, k, -1.0 * reference);
+    numBatchSignChanges += (negatedError < error);
+    batchQuaternionError = fmax(batchQuaternionError, fmin(error, negatedError));
+  }
+
+  // the angles are compared as rotations (the Euler angles at gimbal lock are not unique)
+  QuaternionToEulerBatch(count, matrixQ, outputAngles);
+  double angleError = 0.0, batchAngleError = 0.0;
+  for(int k=0; k<count; k++)
+  {
+    Quaternion<double> p = GetQuaternion(matrixQ, k);
+    double R[9];
+    p.Quaternion2Matrix(R);
+    double reference[3], direct[3], batch[3] = { outputAngles[0][k], outputAngles[1][k], outputAngles[2][k] };
+    interpolator.Rotation2Euler(R, reference);
+    interpolator.Quaternion2Euler(p, direct);
+    for(int i=0; i<3; i++)
+    {
+      angleError = fmax(angleError, AngleError(direct[i], reference[i]));
+      batchAngleError = fmax(batchAngleError, AngleError(batch[i], reference[i]));
+    }
+  }
+
+  printf("Rotations: %d, repetitions: %d\n", count, repetitions);
+  printf("Max. quaternion component error: Euler2Quaternion %G, EulerToQuaternionBatch %G\n", quaternionError, batchQuaternionError);
+  printf("Opposite sign (ties): Euler2Quaternion %d, EulerToQuaternionBatch %d\n", numSignChanges, numBatchSignChanges);
+  printf("Max. angle error (degrees): Quaternion2Euler %G, QuaternionToEulerBatch %G\n", angleError, batchAngleError);
+
+  // speed (the sums keep the compiler from removing the loops)
+  PerformanceCounter counter;
+  double sum = 0.0;
+  double times[3][2]; // matrix, direct, batch; Euler -> quaternion, quaternion -> Euler
+  for(int method=0; method<3; method++)
+  {
+    counter.StartCounter();
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      if (method == 2)
+        EulerToQuaternionBatch(count, angles, batchQ);
+      else
+      {
+        for(int k=0; k<count; k++)
+        {
+          double a[3] = { angles[0][k], angles[1][k], angles[2][k] }, R[9];
+          Quaternion<double> r;
+          if (method == 0)
+          {
+            interpolator.Euler2Rotation(a, R);
+            r = Quaternion<double>::Matrix2Quaternion(R);
+          }
+          else
+            interpolator.Euler2Quaternion(a, r);
+          batchQ[0][k] = r.Gets();
+        }
+      }
+      sum += batchQ[0][repetition % count];
+    }
+    counter.StopCounter();
+    times[method][0] = counter.GetElapsedTime();
+
+    counter.StartCounter();
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      if (method == 2)
+        QuaternionToEulerBatch(count, matrixQ, outputAngles);
+      else
+      {
+        for(int k=0; k<count; k++)
+        {
+          Quaternion<double> p = GetQuaternion(matrixQ, k);
+          double a[3], R[9];
+          if (method == 0)
+          {
+            p.Quaternion2Matrix(R);
+            interpolator.Rotation2Euler(R, a);
+          }
+          else
+            interpolator.Quaternion2Euler(p, a);
+          outputAngles[0][k] = a[0];
+        }
+      }
+      sum += outputAngles[0][repetition % count];
+    }
+    counter.StopCounter();
+    times[method][1] = counter.GetElapsedTime();
+  }
+
+  double numConversions = 1.0 * count * repetitions;
+  const char * methodNames[3] = { "rotation matrix", "direct", "batch" };
+  printf("%-16s %18s %18s  (ns per rotation)\n", "", "Euler->quaternion", "quaternion->Euler");
+  for(int method=0; method<3; method++)
+    printf("%-16s %18.2f %18.2f\n", methodNames[method], 1e9 * times[method][0] / numConversions, 1e9 * times[method][1] / numConversions);
+  printf("(checksum: %G)\n", sum);
+
+  free(data);
+
+  return ((quaternionError < 1e-10) && (batchQuaternionError < 1e-10) && (angleError < 1e-8) && (batchAngleError < 1e-8)) ? 0 : 1;
+}
+
+// angle (in degrees) between the rotations given by the XYZ Euler angles (in degrees) angles1 and angles2
+static double RotationDifference(Interpolator & interpolator, const vector & angles1, const vector & angles2)
+{
+  double a1[3] = { angles1.p[0], angles1.p[1], angles1.p[2] }, a2[3] = { angles2.p[0], angles2.p[1], angles2.p[2] };
+  Quaternion<double> q1, q2;
+  interpolator.Euler2Quaternion(a1, q1);
+  interpolator.Euler2Quaternion(a2, q2);
+  double dot = fabs(q1.Gets() * q2.Gets() + q1.Getx() * q2.Getx() + q1.Gety() * q2.Gety() + q1.Getz() * q2.Getz());
+  return 2.0 * acos(fmin(dot, 1.0)) * 180.0 / M_PI;
+}
+
+// loads the skeleton and the motion (AMC or AMCB file); returns 0 on success, and -1 otherwise
+static int LoadMotion(char * skeletonFile, char * motionFile, Skeleton ** pSkeleton, Motion ** pMotion)
+{
+  *pSkeleton = NULL;
+  try
+  {
+    *pSkeleton = new Skeleton(skeletonFile, MOCAP_SCALE);
+    (*pSkeleton)->enableAllRotationalDOFs();
+    if (AMCBFile::IsAMCBFilename(motionFile))
+      *pMotion = new Motion(motionFile, *pSkeleton, MOCAP_SCALE);
+    else
+      *pMotion = new Motion(motionFile, MOCAP_SCALE, *pSkeleton);
+  }
+  catch(int)
+  {
+    printf("Error: failed to load %s / %s.\n", skeletonFile, motionFile);
+    delete *pSkeleton;
+    return -1;
+  }
+  return 0;
+}
+
+// spline mode: SQUAD vs. Bezier quaternion interpolation of a motion: speed, and the angles between the bone rotations
+// of the two interpolated motions, and between each of them and the input motion (which has all frames)
+static int BenchmarkSpline(char * skeletonFile, char * motionFile, int N, int repetitions)
+{
+  Skeleton * pSkeleton;
+  Motion * pInputMotion;
+  if (LoadMotion(skeletonFile, motionFile, &pSkeleton, &pInputMotion) != 0)
+    return -1;
+
+  const int numMethods = 2;
+  const InterpolationType methods[numMethods] = { BEZIER, SQUAD };
+  const char * methodNames[numMethods] = { "Bezier", "SQUAD" };
+  Motion * pOutputMotions[numMethods];
+  double times[numMethods];
+  for(int method=0; method<numMethods; method++)
+  {
+    Interpolator interpolator;
+    interpolator.SetInterpolationType(methods[method]);
+    interpolator.SetAngleRepresentation(QUATERNION);
+    PerformanceCounter counter;
+    times[method] = 0.0;
+    pOutputMotions[method] = NULL;
+    // best of the repetitions
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      delete pOutputMotions[method];
+      counter.StartCounter();
+      interpolator.Interpolate(pInputMotion, &pOutputMotions[method], N);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < times[method]))
+        times[method] = counter.GetElapsedTime();
+    }
+  }
+
+  // angles between the rotations of the active bones, over the interpolated frames (not the keyframes)
+  Interpolator interpolator;
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  double maxDifference[3] = { 0.0, 0.0, 0.0 }, sumDifference[3] = { 0.0, 0.0, 0.0 }; // Bezier vs. SQUAD, Bezier vs. input, SQUAD vs. input
+  int numSamples = 0;
+  for(int frame=0; frame<pInputMotion->GetNumFrames(); frame++)
+  {
+    if (frame % (N+1) == 0)
+      continue;
+    Posture * input = pInputMotion->GetPosture(frame);
+    Posture * bezier = pOutputMotions[0]->GetPosture(frame);
+    Posture * squad = pOutputMotions[1]->GetPosture(frame);
+    for (int k = 0; k < numActiveBones; k++)
+    {
+      int bone = activeBones[k];
+      double difference[3];
+      difference[0] = RotationDifference(interpolator, bezier->bone_rotation[bone], squad->bone_rotation[bone]);
+      difference[1] = RotationDifference(interpolator, bezier->bone_rotation[bone], input->bone_rotation[bone]);
+      difference[2] = RotationDifference(interpolator, squad->bone_rotation[bone], input->bone_rotation[bone]);
+      for(int i=0; i<3; i++)
+      {
+        maxDifference[i] = fmax(maxDifference[i], difference[i]);
+        sumDifference[i] += difference[i];
+      }
+      numSamples++;
+    }
+  }
+
+  printf("Frames: %d, bones: %d, N: %d\n", pInputMotion->GetNumFrames(), numActiveBones, N);
+  for(int method=0; method<numMethods; method++)
+    printf("%-8s %10.3f ms (%.2fx)\n", methodNames[method], 1000.0 * times[method], times[0] / times[method]);
+  const char * differenceNames[3] = { "SQUAD vs. Bezier", "Bezier vs. input", "SQUAD vs. input" };
+  printf("Angle between the bone rotations (degrees):\n");
+  for(int i=0; i<3; i++)
+    printf("  %-18s max %8.4f, mean %8.4f\n", differenceNames[i], maxDifference[i], (numSamples > 0) ? sumDifference[i] / numSamples : 0.0);
+
+  for(int method=0; method<numMethods; method++)
+    delete pOutputMotions[method];
+  delete pInputMotion;
+  delete pSkeleton;
+  return 0;
+}
+
+// sample mode: MotionSampler vs. Interpolator::Interpolate, for all interpolation types: the differences at the frames 
+// up to the last keyframe, and the time to compute all frames, and to resample the motion at 30 fps
+static int BenchmarkSample(char * skeletonFile, char * motionFile, int N, int repetitions)
+{
+  Skeleton * pSkeleton;
+  Motion * pInputMotion;
+  if (LoadMotion(skeletonFile, motionFile, &pSkeleton, &pInputMotion) != 0)
+    return -1;
+
+  const int numMethods = 5;
+  const InterpolationType types[numMethods] = { LINEAR, BEZIER, LINEAR, BEZIER, SQUAD };
+  const AngleRepresentation representations[numMethods] = { EULER, EULER, QUATERNION, QUATERNION, QUATERNION };
+  const char * methodNames[numMethods] = { "LE", "BE", "LQ", "BQ", "SQ" };
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  int numFrames = pInputMotion->GetNumFrames();
+  int lastKeyframe = (numFrames - 1) / (N+1) * (N+1);
+  // resampling from 120 to 30 fps
+  int numResampledFrames = (int)(lastKeyframe / 4.0) + 1;
+  double * times = new double[numResampledFrames];
+  for(int i=0; i<numResampledFrames; i++)
+    times[i] = 4.0 * i;
+  Posture * postures = new Posture[numResampledFrames];
+
+  printf("Frames: %d, bones: %d, N: %d\n", numFrames, numActiveBones, N);
+  printf("        Interpolate    sampler (setup + all frames)   sampler (30 fps)   max difference: root     rotation (degrees)\n");
+  int result = 0;
+  for(int method=0; method<numMethods; method++)
+  {
+    Interpolator interpolator;
+    interpolator.SetInterpolationType(types[method]);
+    interpolator.SetAngleRepresentation(representations[method]);
+    Motion * pOutputMotion = NULL;
+    PerformanceCounter counter;
+    double interpolateTime = 0.0, samplerTime = 0.0, resampleTime = 0.0;
+    Posture posture;
+    double maxRootDifference = 0.0, maxRotationDifference = 0.0;
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      delete pOutputMotion;
+      counter.StartCounter();
+      interpolator.Interpolate(pInputMotion, &pOutputMotion, N);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < interpolateTime))
+        interpolateTime = counter.GetElapsedTime();
+
+      // all frames up to the last keyframe, compared with the interpolated motion
+      counter.StartCounter();
+      MotionSampler sampler(pInputMotion, N, types[method], representations[method]);
+      for(int frame=0; frame<=lastKeyframe; frame++)
+      {
+        sampler.Sample(frame, posture);
+        if (repetition > 0)
+          continue;
+        Posture * interpolatedPosture = pOutputMotion->GetPosture(frame);
+        for(int i=0; i<3; i++)
+          maxRootDifference = fmax(maxRootDifference, fabs(posture.root_pos.p[i] - interpolatedPosture->root_pos.p[i]));
+        for (int k = 0; k < numActiveBones; k++)
+          maxRotationDifference = fmax(maxRotationDifference, 
+            RotationDifference(interpolator, posture.bone_rotation[activeBones[k]], interpolatedPosture->bone_rotation[activeBones[k]]));
+      }
+      counter.StopCounter();
+      if ((repetition == 1) || ((repetition > 1) && (counter.GetElapsedTime() < samplerTime)) || (repetitions == 1))
+        samplerTime = counter.GetElapsedTime(); // (the first repetition also compares the postures)
+
+      counter.StartCounter();
+      sampler.Sample(numResampledFrames, times, postures);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < resampleTime))
+        resampleTime = counter.GetElapsedTime();
+    }
+    delete pOutputMotion;
+
+    // (RotationDifference, based on acos, cannot resolve angles below about 1e-5 degrees)
+    int passed = (maxRootDifference < 1e-9) && (maxRotationDifference < 1e-4);
+    if (!passed)
+      result = 1;
+    printf("%s   %10.3f ms   %10.3f ms                   %10.3f ms          %12.3g %12.3g   %s\n", methodNames[method], 1000.0 * interpolateTime, 
+      1000.0 * samplerTime, 1000.0 * resampleTime, maxRootDifference, maxRotationDifference, passed ? "ok" : "FAILED");
+  }
+
+  delete [] postures;
+  delete [] times;
+  delete pInputMotion;
+  delete pSkeleton;
+  return result;
+}
+
+// codec mode: compression of the motion with adaptive keyframes (rotation error tolerance in degrees) and MotionCodec,
+// for all interpolation types: keyframes, size, compression ratios, encode / decode speed, and the error of the decoded motion
+static int BenchmarkCodec(char * skeletonFile, char * motionFile, double tolerance, int repetitions)
+{
+  Skeleton * pSkeleton;
+  Motion * pInputMotion;
+  if (LoadMotion(skeletonFile, motionFile, &pSkeleton, &pInputMotion) != 0)
+    return -1;
+
+  const int numMethods = 5;
+  const InterpolationType types[numMethods] = { LINEAR, BEZIER, LINEAR, BEZIER, SQUAD };
+  const AngleRepresentation representations[numMethods] = { EULER, EULER, QUATERNION, QUATERNION, QUATERNION };
+  const char * methodNames[numMethods] = { "LE", "BE", "LQ", "BQ", "SQ" };
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  int numFrames = pInputMotion->GetNumFrames();
+
+  // sizes of the uncompressed formats
+  long amcSize = 0;
+  FILE * file = fopen(motionFile, "rb");
+  if (file != NULL)
+  {
+    fseek(file, 0, SEEK_END);
+    amcSize = ftell(file);
+    fclose(file);
+  }
+  long amcbSize = (long)sizeof(AMCBHeader) + (long)MotionChannels::GetNumChannels(pInputMotion->GetNumBones()) * numFrames * sizeof(float);
+
+  // each method decodes with a freshly loaded skeleton, set up as when a file is read
+  Skeleton * pDecodeSkeletons[numMethods];
+  for(int method=0; method<numMethods; method++)
+  {
+    pDecodeSkeletons[method] = new Skeleton(skeletonFile, MOCAP_SCALE);
+    pDecodeSkeletons[method]->enableAllRotationalDOFs();
+  }
+
+  printf("Frames: %d, bones: %d, tolerance: %g degrees, input: %ld bytes, AMCB (float): %ld bytes\n", 
+    numFrames, numActiveBones, tolerance, amcSize, amcbSize);
+  printf("     keyframes      bytes   ratio (input, AMCB)   select       encode        decode (frames/s)      max error: rotation (mean)   root\n");
+  int result = 0;
+  Interpolator interpolator;
+  for(int method=0; method<numMethods; method++)
+  {
+    PerformanceCounter counter;
+    counter.StartCounter();
+    KeyframeSelector selector(types[method], representations[method], ROTATION_ERROR, tolerance);
+    int * keyframes;
+    int numKeyframes = selector.SelectKeyframes(pInputMotion, &keyframes);
+    counter.StopCounter();
+    double selectTime = counter.GetElapsedTime();
+
+    double encodeTime = 0.0, decodeTime = 0.0;
+    size_t size = 0;
+    Motion * pDecodedMotion = NULL;
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      unsigned char * data;
+      counter.StartCounter();
+      size = MotionCodec::Encode(pInputMotion, numKeyframes, keyframes, types[method], representations[method], &data);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < encodeTime))
+        encodeTime = counter.GetElapsedTime();
+
+      delete pDecodedMotion;
+      counter.StartCounter();
+      MotionCodec::Decode(data, size, pDecodeSkeletons[method], &pDecodedMotion);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < decodeTime))
+        decodeTime = counter.GetElapsedTime();
+      delete [] data;
+    }
+    delete [] keyframes;
+    if (pDecodedMotion == NULL)
+    {
+      printf("%s   decoding failed\n", methodNames[method]);
+      result = 1;
+      continue;
+    }
+
+    double maxRotationDifference = 0.0, sumRotationDifference = 0.0, maxRootDifference = 0.0;
+    for(int frame=0; frame<numFrames; frame++)
+    {
+      Posture * input = pInputMotion->GetPosture(frame);
+      Posture * decoded = pDecodedMotion->GetPosture(frame);
+      for(int i=0; i<3; i++)
+        maxRootDifference = fmax(maxRootDifference, fabs(input->root_pos.p[i] - decoded->root_pos.p[i]));
+      for (int k = 0; k < numActiveBones; k++)
+      {
+        double difference = RotationDifference(interpolator, input->bone_rotation[activeBones[k]], decoded->bone_rotation[activeBones[k]]);
+        maxRotationDifference = fmax(maxRotationDifference, difference);
+        sumRotationDifference += difference;
+      }
+    }
+    delete pDecodedMotion;
+
+    // the quantization adds up to about 0.01 (quaternions) or 0.015 (three Euler angles with wide ranges) degrees
+    int passed = (maxRotationDifference < tolerance + 0.02);
+    if (!passed)
+      result = 1;
+    printf("%s   %6d %10lu   %7.2f %7.2f   %8.2f ms   %7.3f ms   %7.3f ms (%8.0f)   %8.4f (%6.4f)   %8.5f   %s\n", methodNames[method], 
+      numKeyframes, (unsigned long)size, (double)amcSize / size, (double)amcbSize / size, 1000.0 * selectTime, 1000.0 * encodeTime, 
+      1000.0 * decodeTime, numFrames / decodeTime, maxRotationDifference, 
+      (numFrames * numActiveBones > 0) ? sumRotationDifference / (numFrames * numActiveBones) : 0.0, maxRootDifference, passed ? "ok" : "FAILED");
+  }
+
+  for(int method=0; method<numMethods; method++)
+    delete pDecodeSkeletons[method];
+  delete pInputMotion;
+  delete pSkeleton;
+  return result;
+}
+
+// fk mode: joint positions of all frames with ForwardKinematics, posture by posture vs. in blocks (serially, and on all
+// hardware threads): speed, and the differences of the positions; also checks that the transforms agree with the positions
+static int BenchmarkForwardKinematics(char * skeletonFile, char * motionFile, int repetitions)
+{
+  Skeleton * pSkeleton;
+  Motion * pMotion;
+  if (LoadMotion(skeletonFile, motionFile, &pSkeleton, &pMotion) != 0)
+    return -1;
+
+  ForwardKinematics forwardKinematics(pSkeleton);
+  int numBones = forwardKinematics.GetNumBones();
+  int numFrames = pMotion->GetNumFrames();
+  double * positions = new double[3 * numBones * numFrames];
+  double * batchPositions = new double[3 * numBones * numFrames];
+  double * transforms = new double[FK_TRANSFORM_SIZE * numBones * numFrames];
+  pMotion->UpdatePostures();
+  pMotion->UpdateChannels();
+  ThreadPool threadPool;
+
+  // 0: posture by posture, 1: blocks, 2: blocks on all threads, 3: blocks with transforms on all threads
+  double times[4];
+  PerformanceCounter counter;
+  for(int method=0; method<4; method++)
+  {
+    forwardKinematics.SetThreadPool((method >= 2) ? &threadPool : NULL);
+    for(int repetition=0; repetition<repetitions; repetition++)
+    {
+      counter.StartCounter();
+      if (method == 0)
+      {
+        for(int frame=0; frame<numFrames; frame++)
+          forwardKinematics.ComputeJointPositions(*pMotion->GetPosture(frame), &positions[3 * numBones * frame]);
+      }
+      else if (method < 3)
+        forwardKinematics.ComputeJointPositions(pMotion, 0, numFrames, batchPositions);
+      else
+        forwardKinematics.ComputeTransformsAndJointPositions(pMotion, 0, numFrames, transforms, batchPositions);
+      counter.StopCounter();
+      if ((repetition == 0) || (counter.GetElapsedTime() < times[method]))
+        times[method] = counter.GetElapsedTime();
+    }
+  }
+
+  // positions of the batch vs. the posture version, and end of each bone = t + R * (dir * length) of its transform
+  double maxDifference = 0.0, maxTransformDifference = 0.0;
+  for(int frame=0; frame<numFrames; frame++)
+    for(int bone=0; bone<numBones; bone++)
+    {
+      const double * transform = &transforms[FK_TRANSFORM_SIZE * (numBones * frame + bone)];
+      const double * boneVector = forwardKinematics.GetBoneVector(bone);
+      for(int i=0; i<3; i++)
+      {
+        int index = 3 * (numBones * frame + bone) + i;
+        maxDifference = fmax(maxDifference, fabs(batchPositions[index] - positions[index]));
+        double end = transform[4 * i + 3] + transform[4 * i] * boneVector[0] + transform[4 * i + 1] * boneVector[1] + transform[4 * i + 2] * boneVector[2];
+        maxTransformDifference = fmax(maxTransformDifference, fabs(end - positions[index]));
+      }
+    }
+
+  int passed = (maxDifference < 1e-9) && (maxTransformDifference < 1e-9);
+  printf("Frames: %d, bones: %d\n", numFrames, numBones);
+  printf("  posture by posture:          %10.3f ms\n", 1000.0 * times[0]);
+  printf("  blocks:                      %10.3f ms (%.2fx)\n", 1000.0 * times[1], times[0] / times[1]);
+  printf("  blocks, %3d threads:         %10.3f ms (%.2fx)\n", threadPool.GetNumThreads(), 1000.0 * times[2], times[0] / times[2]);
+  printf("  with transforms, %3d threads: %9.3f ms\n", threadPool.GetNumThreads(), 1000.0 * times[3]);
+  printf("Max difference: positions %.3g, transforms %.3g   %s\n", maxDifference, maxTransformDifference, passed ? "ok" : "FAILED");
+
+  delete [] transforms;
+  delete [] batchPositions;
+  delete [] positions;
+  delete pMotion;
+  delete pSkeleton;
+  return passed ? 0 : 1;
+}
+
+// load mode: parsing an AMC file serially vs. in parallel (Motion with a ThreadPool): speed, and the number of
+// values (root positions, bone rotations, translations and length changes) that differ between the two motions
+static int BenchmarkLoad(char * skeletonFile, char * motionFile, int numThreads, int repetitions)
+{
+  if (AMCBFile::IsAMCBFilename(motionFile) || MotionCodec::IsAMCZFilename(motionFile))
+  {
+    printf("Error: load mode requires an AMC file.\n");
+    return -1;
+  }
+
+  Skeleton * pSkeleton = NULL;
+  try
+  {
+    pSkeleton = new Skeleton(skeletonFile, MOCAP_SCALE);
+  }
+  catch(int)
+  {
+    printf("Error: failed to load %s.\n", skeletonFile);
+    return -1;
+  }
+
+  ThreadPool threadPool(numThreads);
+  Motion * pMotions[2] = { NULL, NULL };
+  double times[2];
+  PerformanceCounter counter;
+  for(int repetition=0; repetition<repetitions; repetition++)
+  {
+    // 0: serially, 1: in parallel
+    for(int method=0; method<2; method++)
+    {
+      delete pMotions[method];
+      pMotions[method] = NULL;
+      counter.StartCounter();
+      try
+      {
+        pMotions[method] = new Motion(motionFile, MOCAP_SCALE, pSkeleton, (method == 1) ? &threadPool : NULL);
+      }
+      catch(int)
+      {
+      }
+      counter.StopCounter();
+      if (pMotions[method] == NULL)
+      {
+        printf("Error: failed to load %s.\n", motionFile);
+        delete pMotions[0];
+        delete pSkeleton;
+        return -1;
+      }
+      if ((repetition == 0) || (counter.GetElapsedTime() < times[method]))
+        times[method] = counter.GetElapsedTime();
+    }
+  }
+
+  // the postures must be identical (the parallel parser converts the same text with the same routines)
+  int numFrames = pMotions[0]->GetNumFrames();
+  int numBones = pSkeleton->getNumBones();
+  int numDifferences = 0;
+  if (pMotions[1]->GetNumFrames() != numFrames)
+    numDifferences = -1;
+  for(int frame=0; (numDifferences >= 0) && (frame<numFrames); frame++)
+  {
+    Posture * posture[2] = { pMotions[0]->GetPosture(frame), pMotions[1]->GetPosture(frame) };
+    for(int i=0; i<3; i++)
+    {
+      numDifferences += (posture[0]->root_pos.p[i] != posture[1]->root_pos.p[i]);
+      for(int bone=0; bone<numBones; bone++)
+      {
+        numDifferences += (posture[0]->bone_rotation[bone].p[i] != posture[1]->bone_rotation[bone].p[i]);
+        numDifferences += (posture[0]->bone_translation[bone].p[i] != posture[1]->bone_translation[bone].p[i]);
+        numDifferences += (posture[0]->bone_length[bone].p[i] != posture[1]->bone_length[bone].p[i]);
+      }
+    }
+  }
+
+  int passed = (numDifferences == 0);
+  printf("Frames: %d, bones: %d\n", numFrames, numBones);
+  printf("  serial:                %10.3f ms\n", 1000.0 * times[0]);
+  printf("  parallel, %3d threads: %10.3f ms (%.2fx)\n", threadPool.GetNumThreads(), 1000.0 * times[1], times[0] / times[1]);
+  if (numDifferences < 0)
+    printf("Different number of frames: %d, %d   FAILED\n", numFrames, pMotions[1]->GetNumFrames());
+  else
+    printf("Differing values: %d   %s\n", numDifferences, passed ? "ok" : "FAILED");
+
+  delete pMotions[1];
+  delete pMotions[0];
+  delete pSkeleton;
+  return passed ? 0 : 1;
+}
+
+// empty mode: interpolation of a motion without frames, for all interpolation types and angle representations; the 
+// output motions must be empty as well
+static int BenchmarkEmpty(char * skeletonFile)
+{
+  Skeleton * pSkeleton = NULL;
+  try
+  {
+    pSkeleton = new Skeleton(skeletonFile, MOCAP_SCALE);
+  }
+  catch(int)
+  {
+    printf("Error: failed to load %s.\n", skeletonFile);
+    return -1;
+  }
+  pSkeleton->enableAllRotationalDOFs();
+  Motion * pInputMotion = new Motion(0, pSkeleton);
+
+  const int numMethods = 5;
+  const InterpolationType types[numMethods] = { LINEAR, BEZIER, LINEAR, BEZIER, SQUAD };
+  const AngleRepresentation representations[numMethods] = { EULER, EULER, QUATERNION, QUATERNION, QUATERNION };
+  const char * methodNames[numMethods] = { "Linear Euler", "Bezier Euler", "Linear quaternion", "Bezier quaternion", "SQUAD" };
+  int numFailed = 0;
+  for(int method=0; method<numMethods; method++)
+  {
+    Interpolator interpolator;
+    interpolator.SetInterpolationType(types[method]);
+    interpolator.SetAngleRepresentation(representations[method]);
+    Motion * pOutputMotion = NULL;
+    interpolator.Interpolate(pInputMotion, &pOutputMotion, 20);
+    int numFrames = pOutputMotion->GetNumFrames();
+    printf("%-18s %d output frames%s\n", methodNames[method], numFrames, (numFrames == 0) ? "" : " (FAILED)");
+    if (numFrames != 0)
+      numFailed++;
+    delete pOutputMotion;
+  }
+
+  delete pInputMotion;
+  delete pSkeleton;
+  return (numFailed == 0) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+  if ((argc >= 4) && ((strcmp(argv[1], "spline") == 0) || (strcmp(argv[1], "sample") == 0)))
+  {
+    int N = (argc >= 5) ? strtol(argv[4], NULL, 10) : 20;
+    int repetitions = (argc >= 6) ? strtol(argv[5], NULL, 10) : 5;
+    if ((N < 0) || (repetitions < 1))
+    {
+      printf("Error: invalid N or number of repetitions.\n");
+      return -1;
+    }
+    if (strcmp(argv[1], "sample") == 0)
+      return BenchmarkSample(argv[2], argv[3], N, repetitions);
+    return BenchmarkSpline(argv[2], argv[3], N, repetitions);
+  }
+
+  if ((argc >= 4) && (strcmp(argv[1], "codec") == 0))
+  {
+    double tolerance = (argc >= 5) ? strtod(argv[4], NULL) : 1.0;
+    int repetitions = (argc >= 6) ? strtol(argv[5], NULL, 10) : 5;
+    if (!(tolerance >= 0.0) || (repetitions < 1))
+    {
+      printf("Error: invalid tolerance or number of repetitions.\n");
+      return -1;
+    }
+    return BenchmarkCodec(argv[2], argv[3], tolerance, repetitions);
+  }
+
+  if ((argc >= 4) && (strcmp(argv[1], "fk") == 0))
+  {
+    int repetitions = (argc >= 5) ? strtol(argv[4], NULL, 10) : 5;
+    if (repetitions < 1)
+    {
+      printf("Error: invalid number of repetitions.\n");
+      return -1;
+    }
+    return BenchmarkForwardKinematics(argv[2], argv[3], repetitions);
+  }
+
+  if ((argc >= 3) && (strcmp(argv[1], "empty") == 0))
+    return BenchmarkEmpty(argv[2]);
+
+  if ((argc >= 4) && (strcmp(argv[1], "load") == 0))
+  {
+    int numThreads = (argc >= 5) ? strtol(argv[4], NULL, 10) : 0;
+    int repetitions = (argc >= 6) ? strtol(argv[5], NULL, 10) : 5;
+    if ((numThreads < 0) || (repetitions < 1))
+    {
+      printf("Error: invalid number of threads or repetitions.\n");
+      return -1;
+    }
+    return BenchmarkLoad(argv[2], argv[3], numThreads, repetitions);
+  }
+
+  if ((argc < 2) || ((strcmp(argv[1], "slerp") != 0) && (strcmp(argv[1], "euler") != 0)))
+  {
+    printf("Measures the accuracy and the speed of the interpolation kernels.\n");
+    printf("Usage: %s <mode> [count] [repetitions]\n", argv[0]);
+    printf("  slerp: batch SLERP / DeCasteljau (quaternionBatch.h) vs. Interpolator::Slerp / DeCasteljauQuaternion\n");
+    printf("  euler: direct and batch Euler <-> quaternion conversions vs. the conversions through the rotation matrix\n");
+    printf("  count: number of quaternions per batch (default: 1024), repetitions: number of timed batches (default: 1000)\n");
+    printf("   or: %s <spline | sample> <skeleton file> <motion file> [N] [repetitions]\n", argv[0]);
+    printf("  spline: SQUAD vs. Bezier quaternion interpolation of the motion (speed, and angles between the rotations)\n");
+    printf("  sample: MotionSampler vs. Interpolator::Interpolate, for all interpolation types (speed, and differences)\n");
+    printf("  N: number of skipped frames (default: 20), repetitions: number of timed runs (default: 5)\n");
+    printf("   or: %s codec <skeleton file> <motion file> [tolerance] [repetitions]\n", argv[0]);
+    printf("  codec: adaptive keyframes and compression (motionCodec.h), for all interpolation types (size, speed, and errors)\n");
+    printf("  tolerance: rotation error in degrees for the keyframe selection (default: 1)\n");
+    printf("   or: %s fk <skeleton file> <motion file> [repetitions]\n", argv[0]);
+    printf("  fk: joint positions with ForwardKinematics, posture by posture vs. in blocks and threads (speed, and differences)\n");
+    printf("   or: %s load <skeleton file> <AMC motion file> [number of threads] [repetitions]\n", argv[0]);
+    printf("  load: parsing the AMC file serially vs. in parallel (speed, and differing posture values; default: all hardware threads)\n");
+    printf("   or: %s empty <skeleton file>\n", argv[0]);
+    printf("  empty: interpolation of a motion without frames, for all interpolation types (the output must be empty)\n");
+    printf("The exit code is non-zero if the accuracy check fails.\n");
+    return -1;
+  }
+
+  int count = (argc >= 3) ? strtol(argv[2], NULL, 10) : 1024;
+  int repetitions = (argc >= 4) ? strtol(argv[3], NULL, 10) : 1000;
+  if ((count < 1) || (repetitions < 1))
+  {
+    printf("Error: invalid count or number of repetitions.\n");
+    return -1;
+  }
+  if (strcmp(argv[1], "euler") == 0)
+    return BenchmarkEuler(count, repetitions);
+  return BenchmarkSlerp(count, repetitions);
+}
+
@@ -12,6 +12,7 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 #include <FL/glut.H>
 
 #include "skeleton.h"
+#include "skeletonPose.h"
 #include "motion.h"
 #include "displaySkeleton.h"
 #include "transform.h"
@@ -30,6 +31,7 @@ DisplaySkeleton::DisplaySkeleton(void)
   for(int skeletonIndex = 0; skeletonIndex < MAX_SKELS; skeletonIndex++)
   {
     m_pSkeleton[skeletonIndex] = NULL;
+    m_pPose[skeletonIndex] = NULL;
     m_pMotion[skeletonIndex] = NULL;
   }
 }
@@ -62,10 +64,10 @@ void DisplaySkeleton::DrawSpotJointAxis(void)
 }
 
 //Build display lists for bones
-void DisplaySkeleton::SetDisplayList(int skeletonID, Bone *bone, GLuint *pBoneList)
+void DisplaySkeleton::SetDisplayList(int skeletonID, const Bone *bone, GLuint *pBoneList)
 {
   GLUquadricObj *qobj;
-  int numbones = m_pSkeleton[skeletonID]->numBonesInSkel(bone[0]);
+  int numbones = m_pSkeleton[skeletonID]->getNumBones();
   *pBoneList = glGenLists(numbones);
   qobj=gluNewQuadric();
 
@@ -140,7 +142,7 @@ void DisplaySkeleton::SetDisplayList(int skeletonID, Bone *bone, GLuint *pBoneLi
   M_k+1 = M_k * (rot_parent_current) * R_k+1 + T_k+1
 */
 
-void DisplaySkeleton::DrawBone(Bone *pBone,int skelNum)
+void DisplaySkeleton::DrawBone(const Bone *pBone,int skelNum)
 {
   static double z_dir[3] = {0.0, 0.0, 1.0};
   double r_axis[3], theta;
@@ -185,20 +187,22 @@ void DisplaySkeleton::DrawBone(Bone *pBone,int skelNum)
   }
 
   //translate AMC (rarely used)
+  const double * boneTranslation = m_pPose[skelNum]->GetBoneTranslation(pBone->idx);
   if(pBone->doftz) 
-    glTranslatef(0.0f, 0.0f, float(pBone->tz));
+    glTranslatef(0.0f, 0.0f, float(boneTranslation[2]));
   if(pBone->dofty) 
-    glTranslatef(0.0f, float(pBone->ty), 0.0f);
+    glTranslatef(0.0f, float(boneTranslation[1]), 0.0f);
   if(pBone->doftx) 
-    glTranslatef(float(pBone->tx), 0.0f, 0.0f);
+    glTranslatef(float(boneTranslation[0]), 0.0f, 0.0f);
 
   //rotate AMC 
+  const double * boneRotation = m_pPose[skelNum]->GetBoneRotation(pBone->idx);
   if(pBone->dofrz) 
-    glRotatef(float(pBone->rz), 0.0f, 0.0f, 1.0f);
+    glRotatef(float(boneRotation[2]), 0.0f, 0.0f, 1.0f);
   if(pBone->dofry) 
-    glRotatef(float(pBone->ry), 0.0f, 1.0f, 0.0f);
+    glRotatef(float(boneRotation[1]), 0.0f, 1.0f, 0.0f);
   if(pBone->dofrx) 
-    glRotatef(float(pBone->rx), 1.0f, 0.0f, 0.0f);
+    glRotatef(float(boneRotation[0]), 1.0f, 0.0f, 0.0f);
 
   //Store the current ModelviewMatrix (before adding the translation part)
   glPushMatrix();
@@ -266,20 +270,19 @@ void DisplaySkeleton::SetShadowingModelviewMatrix(double ground[4], double light
   glMultMatrixd((const GLdouble*)shadowMat);
 }
 
-//Traverse the hierarchy starting from the root 
-//Every node in the data structure has just one child pointer. 
-//If there are more than one children for any node, they are stored as sibling pointers
-//The algorithm draws the current node (bone), visits its child and then visits siblings
-void DisplaySkeleton::Traverse(Bone *ptr,int skelNum)
+//Traverse the hierarchy starting from the given bone 
+//The children of each bone are taken from the flattened hierarchy of the skeleton (see Skeleton::getChildren)
+//The algorithm draws the current bone, and then visits its children, each with the transformation of the current bone
+void DisplaySkeleton::Traverse(int boneIndex, int skelNum)
 {
-  if(ptr != NULL)
-  {
-    glPushMatrix();
-    DrawBone(ptr,skelNum);
-    Traverse(ptr->child,skelNum);
-    glPopMatrix();
-    Traverse(ptr->sibling,skelNum);
-  }
+  Skeleton * pSkeleton = m_pSkeleton[skelNum];
+  glPushMatrix();
+  DrawBone(&pSkeleton->getRoot()[boneIndex], skelNum);
+  int numChildren = pSkeleton->getNumChildren(boneIndex);
+  const int * children = pSkeleton->getChildren(boneIndex);
+  for(int i=0; i<numChildren; i++)
+    Traverse(children[i], skelNum);
+  glPopMatrix();
 }
 
 //Draw the skeleton
@@ -298,15 +301,15 @@ void DisplaySkeleton::Render(RenderMode renderMode_)
   {
     glPushMatrix();
     double translation[3];
-    m_pSkeleton[i]->GetTranslation(translation);
+    m_pPose[i]->GetTranslation(translation);
     double rotationAngle[3];
-    m_pSkeleton[i]->GetRotationAngle(rotationAngle);
+    m_pPose[i]->GetRotationAngle(rotationAngle);
 
     glTranslatef(float(MOCAP_SCALE * translation[0]), float(MOCAP_SCALE * translation[1]), float(MOCAP_SCALE * translation[2]));
     glRotatef(float(rotationAngle[0]), 1.0f, 0.0f, 0.0f);
     glRotatef(float(rotationAngle[1]), 0.0f, 1.0f, 0.0f);
     glRotatef(float(rotationAngle[2]), 0.0f, 0.0f, 1.0f);
-    Traverse(m_pSkeleton[i]->getRoot(),i);
+    Traverse(Skeleton::getRootIndex(),i);
 
     glPopMatrix();
   }
@@ -328,6 +331,7 @@ void DisplaySkeleton::LoadSkeleton(Skeleton *pSkeleton)
     return;
 
   m_pSkeleton[numSkeletons] = pSkeleton;
+  m_pPose[numSkeletons] = new SkeletonPose(pSkeleton);
 
   //Create the display list for the skeleton
   //All the bones are the elongated spheres centered at (0,0,0).
@@ -372,6 +376,16 @@ Skeleton * DisplaySkeleton::GetSkeleton(int skeletonIndex)
   return m_pSkeleton[skeletonIndex];
 }
 
+SkeletonPose * DisplaySkeleton::GetSkeletonPose(int skeletonIndex)
+{
+  if (skeletonIndex < 0 || skeletonIndex >= numSkeletons)
+  {
+    printf("Error in DisplaySkeleton::GetSkeletonPose: skeleton index %d is illegal.\n", skeletonIndex);
+    exit(0);
+  }
+  return m_pPose[skeletonIndex];
+}
+
 void DisplaySkeleton::Reset(void)
 {
   for(int skeletonIndex = 0; skeletonIndex < MAX_SKELS; skeletonIndex++)
@@ -382,6 +396,11 @@ void DisplaySkeleton::Reset(void)
       glDeleteLists(m_BoneList[skeletonIndex], 1);
       m_pSkeleton[skeletonIndex] = NULL;
     }
+    if (m_pPose[skeletonIndex] != NULL)
+    {
+      delete (m_pPose[skeletonIndex]);
+      m_pPose[skeletonIndex] = NULL;
+    }
     if (m_pMotion[skeletonIndex] != NULL)
     {
       delete (m_pMotion[skeletonIndex]);
@@ -13,6 +13,7 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 
 #include <FL/glu.h>
 #include "skeleton.h"
+#include "skeletonPose.h"
 #include "motion.h"
 
 class DisplaySkeleton 
@@ -32,7 +33,7 @@ public:
   DisplaySkeleton();
   ~DisplaySkeleton();
 
-  //set skeleton for display
+  //set skeleton for display (it is shown in the base posture, see GetSkeletonPose)
   void LoadSkeleton(Skeleton * pSkeleton);
   //set motion for display
   void LoadMotion(Motion * pMotion);
@@ -45,6 +46,8 @@ public:
   int GetDisplayedSpotJoint(void) {return m_SpotJoint;}
   int GetNumSkeletons(void) {return numSkeletons;}
   Skeleton * GetSkeleton(int skeletonIndex);
+  //the displayed pose of the skeleton; set it to change what is drawn
+  SkeletonPose * GetSkeletonPose(int skeletonIndex);
   Motion * GetSkeletonMotion(int skeletonIndex);
 
   void Reset(void);
@@ -52,17 +55,18 @@ public:
 protected:
   RenderMode renderMode;
   // Draw a particular bone
-  void DrawBone(Bone *ptr, int skelNum);
-  // Draw the skeleton hierarchy
-  void Traverse(Bone *ptr, int skelNum);
+  void DrawBone(const Bone *ptr, int skelNum);
+  // Draw the skeleton hierarchy, from the bone on
+  void Traverse(int boneIndex, int skelNum);
   // Model matrix for the shadow
   void SetShadowingModelviewMatrix(double ground[4], double light[4]);
   void DrawSpotJointAxis(void);
-  void SetDisplayList(int skeletonID, Bone *bone, GLuint *pBoneList);
+  void SetDisplayList(int skeletonID, const Bone *bone, GLuint *pBoneList);
 
   int m_SpotJoint;		//joint whose local coordinate framework is drawn
   int numSkeletons;
   Skeleton *m_pSkeleton[MAX_SKELS];		//pointer to current skeleton
+  SkeletonPose *m_pPose[MAX_SKELS];		//pose of each skeleton
   Motion *m_pMotion[MAX_SKELS];		//pointer to current motion	
   GLuint m_BoneList[MAX_SKELS];		//display list with bones
 
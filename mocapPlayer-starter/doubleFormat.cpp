@@ -0,0 +1,355 @@
+/*
+doubleFormat.cpp
+
+Shortest round-trip formatting of doubles, using the Grisu2 algorithm:
+  Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately 
+  with Integers", PLDI 2010.
+The digit generation follows the implementation by Milo Yip (RapidJSON).
+*/
+
+#include <string.h>
+#include <stdint.h>
+#include "doubleFormat.h"
+
+// "do-it-yourself floating point": f * 2^e
+struct DiyFp
+{
+  uint64_t f;
+  int e;
+
+  DiyFp() { f = 0; e = 0; }
+  DiyFp(uint64_t f_, int e_) { f = f_; e = e_; }
+};
+
+static const uint64_t doubleHiddenBit = 0x0010000000000000ULL;
+static const uint64_t doubleSignificandMask = 0x000FFFFFFFFFFFFFULL;
+static const uint64_t doubleExponentMask = 0x7FF0000000000000ULL;
+static const int doubleSignificandSize = 52;
+static const int doubleExponentBias = 0x3FF + doubleSignificandSize;
+static const int doubleMinExponent = -doubleExponentBias;
+
+static inline DiyFp Subtract(const DiyFp & a, const DiyFp & b)
+{
+  return DiyFp(a.f - b.f, a.e);
+}
+
+// product rounded to 64 bits
+static inline DiyFp Multiply(const DiyFp & a, const DiyFp & b)
+{
+  const uint64_t M32 = 0xFFFFFFFFULL;
+  uint64_t a1 = a.f >> 32;
+  uint64_t a0 = a.f & M32;
+  uint64_t b1 = b.f >> 32;
+  uint64_t b0 = b.f & M32;
+  uint64_t a1b1 = a1 * b1;
+  uint64_t a0b1 = a0 * b1;
+  uint64_t a1b0 = a1 * b0;
+  uint64_t a0b0 = a0 * b0;
+  uint64_t tmp = (a0b0 >> 32) + (a1b0 & M32) + (a0b1 & M32);
+  tmp += 1U << 31; // round
+  return DiyFp(a1b1 + (a1b0 >> 32) + (a0b1 >> 32) + (tmp >> 32), a.e + b.e + 64);
+}
+
+static inline DiyFp Normalize(DiyFp x)
+{
+  while (!(x.f & (1ULL << 63)))
+  {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+// the boundaries m- and m+ of the interval of numbers that round to the double value f * 2^e, 
+// with the same (normalized) exponent
+static inline void NormalizedBoundaries(const DiyFp & value, DiyFp * minus, DiyFp * plus)
+{
+  DiyFp p((value.f << 1) + 1, value.e - 1);
+  while (!(p.f & (doubleHiddenBit << 1)))
+  {
+    p.f <<= 1;
+    p.e--;
+  }
+  p.f <<= 64 - doubleSignificandSize - 2;
+  p.e -= 64 - doubleSignificandSize - 2;
+
+  DiyFp m = (value.f == doubleHiddenBit) ? DiyFp((value.f << 2) - 1, value.e - 2) : DiyFp((value.f << 1) - 1, value.e - 1);
+  m.f <<= m.e - p.e;
+  m.e = p.e;
+
+  *plus = p;
+  *minus = m;
+}
+
+// cached powers 10^-348, 10^-340, ..., 10^340, normalized to 64 bits
+static const uint64_t cachedPowersF[] =
+{
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+  0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+  0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+  0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+  0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+  0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+  0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+  0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+  0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+  0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+  0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+  0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+  0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+  0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+  0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+  0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+  0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+  0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+  0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+  0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+  0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+  0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int cachedPowersE[] =
+{
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066
+};
+
+// returns a cached power c = 10^-K such that the product of c with a number with binary exponent e
+// has a binary exponent in [-60, -32]
+static inline DiyFp GetCachedPower(int e, int * K)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347; // dk is positive, so the ceiling can be computed with a cast
+  int k = (int)dk;
+  if (dk - k > 0.0)
+    k++;
+
+  unsigned int index = (unsigned int)((k >> 3) + 1);
+  *K = -(-348 + (int)(index << 3));
+  return DiyFp(cachedPowersF[index], cachedPowersE[index]);
+}
+
+static inline void GrisuRound(char * buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wp_w)
+{
+  while ((rest < wp_w) && (delta - rest >= tenKappa) &&
+         ((rest + tenKappa < wp_w) || (wp_w - rest > rest + tenKappa - wp_w)))
+  {
+    buffer[length - 1]--;
+    rest += tenKappa;
+  }
+}
+
+static inline int CountDecimalDigits(uint32_t n)
+{
+  if (n < 10) return 1;
+  if (n < 100) return 2;
+  if (n < 1000) return 3;
+  if (n < 10000) return 4;
+  if (n < 100000) return 5;
+  if (n < 1000000) return 6;
+  if (n < 10000000) return 7;
+  if (n < 100000000) return 8;
+  return 9;
+}
+
+static inline void DigitGen(const DiyFp & W, const DiyFp & Mp, uint64_t delta, char * buffer, int * length, int * K)
+{
+  static const uint64_t powersOf10[] = 
+  { 
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 
+    1000000000000000000ULL, 10000000000000000000ULL 
+  };
+  static const uint32_t powersOf10_32[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+  const DiyFp one(1ULL << -Mp.e, Mp.e);
+  const DiyFp wp_w = Subtract(Mp, W);
+  uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = CountDecimalDigits(p1);
+  *length = 0;
+
+  while (kappa > 0)
+  {
+    uint32_t d = p1 / powersOf10_32[kappa - 1];
+    p1 %= powersOf10_32[kappa - 1];
+    if (d || *length)
+      buffer[(*length)++] = (char)('0' + d);
+    kappa--;
+    uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+    if (tmp <= delta)
+    {
+      *K += kappa;
+      GrisuRound(buffer, *length, delta, tmp, powersOf10[kappa] << -one.e, wp_w.f);
+      return;
+    }
+  }
+
+  // kappa = 0
+  while (1)
+  {
+    p2 *= 10;
+    delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d || *length)
+      buffer[(*length)++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta)
+    {
+      *K += kappa;
+      int index = -kappa;
+      GrisuRound(buffer, *length, delta, p2, one.f, wp_w.f * ((index < 20) ? powersOf10[index] : 0));
+      return;
+    }
+  }
+}
+
+// generates the decimal digits of a positive value: value = buffer[0..length-1] * 10^K
+static inline void Grisu2(double value, char * buffer, int * length, int * K)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(double));
+
+  int biasedExponent = (int)((bits & doubleExponentMask) >> doubleSignificandSize);
+  uint64_t significand = bits & doubleSignificandMask;
+  DiyFp v;
+  if (biasedExponent != 0)
+    v = DiyFp(significand + doubleHiddenBit, biasedExponent - doubleExponentBias);
+  else
+    v = DiyFp(significand, doubleMinExponent + 1);
+
+  DiyFp w_m, w_p;
+  NormalizedBoundaries(v, &w_m, &w_p);
+
+  const DiyFp c_mk = GetCachedPower(w_p.e, K);
+  const DiyFp W = Multiply(Normalize(v), c_mk);
+  DiyFp Wp = Multiply(w_p, c_mk);
+  DiyFp Wm = Multiply(w_m, c_mk);
+  Wm.f++;
+  Wp.f--;
+  DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+static inline char * WriteExponent(int K, char * buffer)
+{
+  if (K < 0)
+  {
+    *buffer++ = '-';
+    K = -K;
+  }
+
+  if (K >= 100)
+  {
+    *buffer++ = (char)('0' + K / 100);
+    K %= 100;
+    *buffer++ = (char)('0' + K / 10);
+    *buffer++ = (char)('0' + K % 10);
+  }
+  else if (K >= 10)
+  {
+    *buffer++ = (char)('0' + K / 10);
+    *buffer++ = (char)('0' + K % 10);
+  }
+  else
+    *buffer++ = (char)('0' + K);
+
+  return buffer;
+}
+
+// formats the digits buffer[0..length-1] * 10^k 
+static inline char * Prettify(char * buffer, int length, int k)
+{
+  const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+  if ((0 <= k) && (kk <= 21))
+  {
+    // 1234e7 -> 12340000000
+    for(int i = length; i < kk; i++)
+      buffer[i] = '0';
+    return &buffer[kk];
+  }
+  else if ((0 < kk) && (kk <= 21))
+  {
+    // 1234e-2 -> 12.34
+    memmove(&buffer[kk + 1], &buffer[kk], length - kk);
+    buffer[kk] = '.';
+    return &buffer[length + 1];
+  }
+  else if ((-6 < kk) && (kk <= 0))
+  {
+    // 1234e-6 -> 0.001234
+    const int offset = 2 - kk;
+    memmove(&buffer[offset], &buffer[0], length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    for(int i = 2; i < offset; i++)
+      buffer[i] = '0';
+    return &buffer[length + offset];
+  }
+  else if (length == 1)
+  {
+    // 1e30
+    buffer[1] = 'e';
+    return WriteExponent(kk - 1, &buffer[2]);
+  }
+  else
+  {
+    // 1234e30 -> 1.234e33
+    memmove(&buffer[2], &buffer[1], length - 1);
+    buffer[1] = '.';
+    buffer[length + 1] = 'e';
+    return WriteExponent(kk - 1, &buffer[length + 2]);
+  }
+}
+
+int FormatDouble(double value, char * buffer)
+{
+  char * start = buffer;
+
+  if (value != value)
+  {
+    memcpy(buffer, "nan", 3);
+    return 3;
+  }
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(double));
+  if (bits >> 63)
+  {
+    *buffer++ = '-';
+    value = -value;
+  }
+
+  if (value == 0.0)
+  {
+    *buffer++ = '0';
+    return (int)(buffer - start);
+  }
+
+  if (value > 1.7976931348623157e308)
+  {
+    memcpy(buffer, "inf", 3);
+    return (int)(buffer + 3 - start);
+  }
+
+  int length, K;
+  Grisu2(value, buffer, &length, &K);
+  char * end = Prettify(buffer, length, K);
+  return (int)(end - start);
+}
+
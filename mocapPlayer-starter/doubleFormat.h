@@ -0,0 +1,22 @@
+/*
+doubleFormat.h
+
+Fast conversion of doubles to text.
+
+FormatDouble writes the shortest (in all but rare cases) decimal representation 
+that reads back (e.g., with strtod) to exactly the same double. 
+Numbers are written in plain decimal notation (123.456, 0.001234), 
+and in scientific notation (1.5e-7, 1e30) when very small or very large.
+*/
+
+#ifndef _DOUBLEFORMAT_H_
+#define _DOUBLEFORMAT_H_
+
+// maximal number of characters written by FormatDouble
+#define DOUBLE_FORMAT_MAX_LENGTH 32
+
+// writes value into buffer (not 0-terminated); returns the number of characters written
+int FormatDouble(double value, char * buffer);
+
+#endif
+
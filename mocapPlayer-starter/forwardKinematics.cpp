@@ -0,0 +1,292 @@
+/*
+forwardKinematics.cpp
+
+World-space joint positions and transforms of postures and motions, computed on the CPU.
+*/
+
+#include <math.h>
+#include "forwardKinematics.h"
+#include "motion.h"
+#include "quaternionBatch.h"
+#include "threadPool.h"
+#include "types.h"
+
+ForwardKinematics::ForwardKinematics(const Skeleton * pSkeleton)
+{
+  const Bone * bone = pSkeleton->getRoot();
+  m_NumBones = pSkeleton->getNumBones();
+  m_pOrder = new int[m_NumBones];
+  m_pParent = new int[m_NumBones];
+  m_pLocalRotation = new double[m_NumBones][9];
+  m_pBoneVector = new double[m_NumBones][3];
+  m_pDOFMask = new int[m_NumBones];
+  m_HasBoneTranslations = 0;
+  m_pThreadPool = NULL;
+
+  for(int j=0; j<m_NumBones; j++)
+  {
+    // rot_parent_current is passed to glMultMatrixd, i.e., it is stored column by column
+    for(int r=0; r<3; r++)
+      for(int c=0; c<3; c++)
+        m_pLocalRotation[j][3 * r + c] = bone[j].rot_parent_current[c][r];
+    for(int i=0; i<3; i++)
+      m_pBoneVector[j][i] = bone[j].dir[i] * bone[j].length;
+    m_pDOFMask[j] = (bone[j].dofrx ? DOF_RX : 0) | (bone[j].dofry ? DOF_RY : 0) | (bone[j].dofrz ? DOF_RZ : 0) |
+      (bone[j].doftx ? DOF_TX : 0) | (bone[j].dofty ? DOF_TY : 0) | (bone[j].doftz ? DOF_TZ : 0);
+    m_pParent[j] = pSkeleton->getParent(j);
+    if ((j != Skeleton::getRootIndex()) && (m_pDOFMask[j] & (DOF_TX | DOF_TY | DOF_TZ)))
+      m_HasBoneTranslations = 1;
+  }
+
+  // topological order of the hierarchy (see Skeleton::getTopologicalOrder)
+  const int * order = pSkeleton->getTopologicalOrder();
+  for(int i=0; i<m_NumBones; i++)
+    m_pOrder[i] = order[i];
+}
+
+ForwardKinematics::~ForwardKinematics()
+{
+  delete [] m_pOrder;
+  delete [] m_pParent;
+  delete [] m_pLocalRotation;
+  delete [] m_pBoneVector;
+  delete [] m_pDOFMask;
+}
+
+// c = a * b (row-major 3x3 matrices)
+static inline void MultiplyMatrices(const double a[9], const double b[9], double c[9])
+{
+  for(int r=0; r<3; r++)
+    for(int col=0; col<3; col++)
+      c[3 * r + col] = a[3 * r] * b[col] + a[3 * r + 1] * b[3 + col] + a[3 * r + 2] * b[6 + col];
+}
+
+// y = a * x
+static inline void MultiplyMatrixVector(const double a[9], const double x[3], double y[3])
+{
+  for(int r=0; r<3; r++)
+    y[r] = a[3 * r] * x[0] + a[3 * r + 1] * x[1] + a[3 * r + 2] * x[2];
+}
+
+void ForwardKinematics::ComputeJointPositions(const Posture & posture, double * positions)
+{
+  // world rotation of each bone (after its joint rotation)
+  double rotation[MAX_BONES_IN_ASF_FILE][9];
+  static const double identity[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+  int root = Skeleton::getRootIndex();
+
+  for(int i=0; i<m_NumBones; i++)
+  {
+    int j = m_pOrder[i];
+    int parent = m_pParent[j];
+    const double * parentRotation = (parent < 0) ? identity : rotation[parent];
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    if (parent >= 0)
+    {
+      for(int k=0; k<3; k++)
+        origin[k] = positions[3 * parent + k];
+    }
+
+    // frame of the joint: M_parent * rot_parent_current
+    double jointRotation[9];
+    MultiplyMatrices(parentRotation, m_pLocalRotation[j], jointRotation);
+
+    // translation (the root position for the root)
+    int mask = m_pDOFMask[j];
+    const vector & translationVector = (j == root) ? posture.root_pos : posture.bone_translation[j];
+    double translation[3] = { (mask & DOF_TX) ? translationVector.p[0] : 0.0, (mask & DOF_TY) ? translationVector.p[1] : 0.0,
+      (mask & DOF_TZ) ? translationVector.p[2] : 0.0 };
+
+    // joint rotation Rz * Ry * Rx (XYZ Euler angles, in degrees)
+    const vector & angles = posture.bone_rotation[j];
+    double a[3];
+    a[0] = (mask & DOF_RX) ? angles.p[0] * (M_PI / 180.0) : 0.0;
+    a[1] = (mask & DOF_RY) ? angles.p[1] * (M_PI / 180.0) : 0.0;
+    a[2] = (mask & DOF_RZ) ? angles.p[2] * (M_PI / 180.0) : 0.0;
+    double cx = cos(a[0]), sx = sin(a[0]), cy = cos(a[1]), sy = sin(a[1]), cz = cos(a[2]), sz = sin(a[2]);
+    double R[9] = { cy * cz, sx * sy * cz - cx * sz, sx * sz + cx * sy * cz,
+                    cy * sz, cx * cz + sx * sy * sz, cx * sy * sz - sx * cz,
+                    -sy, sx * cy, cx * cy };
+    MultiplyMatrices(jointRotation, R, rotation[j]);
+
+    // end of the bone: origin + jointRotation * (translation + R * boneVector)
+    double local[3], world[3];
+    MultiplyMatrixVector(R, m_pBoneVector[j], local);
+    for(int k=0; k<3; k++)
+      local[k] += translation[k];
+    MultiplyMatrixVector(jointRotation, local, world);
+    for(int k=0; k<3; k++)
+      positions[3 * j + k] = origin[k] + world[k];
+  }
+}
+
+void ForwardKinematics::ComputeJointPositions(Motion * pMotion, int startFrame, int numFrames, double * positions)
+{
+  ComputeTransformsAndJointPositions(pMotion, startFrame, numFrames, NULL, positions);
+}
+
+void ForwardKinematics::ComputeTransforms(Motion * pMotion, int startFrame, int numFrames, double * transforms)
+{
+  ComputeTransformsAndJointPositions(pMotion, startFrame, numFrames, transforms, NULL);
+}
+
+void ForwardKinematics::ComputeTransformsAndJointPositions(Motion * pMotion, int startFrame, int numFrames, double * transforms, double * positions)
+{
+  // bring the layouts up to date before the threads read them
+  MotionChannels * pChannels = pMotion->GetChannels();
+  if (m_HasBoneTranslations)
+    pMotion->UpdatePostures();
+
+  // tasks of several blocks, each with its own workspace
+  const int blocksPerTask = 8;
+  int framesPerTask = blocksPerTask * blockSize;
+  int numTasks = (numFrames + framesPerTask - 1) / framesPerTask;
+  auto task = [&](int taskIndex)
+  {
+    double * workspace = new double[GetBlockWorkspaceSize()];
+    int end = (taskIndex + 1) * framesPerTask;
+    end = (end < numFrames) ? end : numFrames;
+    for(int begin = taskIndex * framesPerTask; begin < end; begin += blockSize)
+    {
+      int count = (end - begin < blockSize) ? end - begin : blockSize;
+      ComputeBlock(pMotion, pChannels, startFrame + begin, count, workspace, 
+        (transforms != NULL) ? transforms + FK_TRANSFORM_SIZE * m_NumBones * begin : NULL, 
+        (positions != NULL) ? positions + 3 * m_NumBones * begin : NULL);
+    }
+    delete [] workspace;
+  };
+
+  if ((m_pThreadPool != NULL) && (numTasks > 1))
+    m_pThreadPool->ParallelFor(numTasks, task);
+  else
+  {
+    for(int taskIndex=0; taskIndex<numTasks; taskIndex++)
+      task(taskIndex);
+  }
+}
+
+void ForwardKinematics::ComputeBlock(Motion * pMotion, MotionChannels * pChannels, int startFrame, int numFrames, double * workspace, 
+  double * transforms, double * positions)
+{
+  // workspace (structure-of-arrays, blockSize values per array): world rotation (9 arrays) and end (3 arrays) of each bone,
+  // then the joint rotation R, the frame of the joint J = M_parent * rot_parent_current, the translation, the start of the bone,
+  // and zeros (for the DOFs that a bone does not have)
+  const int n = blockSize;
+  double * rotationData = workspace;
+  double * endData = rotationData + 9 * n * m_NumBones;
+  double * R[9], * J[9], * translation[3], * start[3];
+  double * temporary = endData + 3 * n * m_NumBones;
+  for(int i=0; i<9; i++)
+  {
+    R[i] = temporary + i * n;
+    J[i] = temporary + (9 + i) * n;
+  }
+  for(int i=0; i<3; i++)
+  {
+    translation[i] = temporary + (18 + i) * n;
+    start[i] = temporary + (21 + i) * n;
+  }
+  double * zeros = temporary + 24 * n;
+  for(int f=0; f<numFrames; f++)
+    zeros[f] = 0.0;
+
+  int root = Skeleton::getRootIndex();
+  for(int i=0; i<m_NumBones; i++)
+  {
+    int j = m_pOrder[i];
+    int parent = m_pParent[j];
+    int mask = m_pDOFMask[j];
+    const double * L = m_pLocalRotation[j];
+    double * W = rotationData + 9 * n * j; // W[row * 3 * n + column * n + f]
+    double * E = endData + 3 * n * j;
+
+    // joint rotations Rz * Ry * Rx
+    const double * angles[3];
+    for(int axis=0; axis<3; axis++)
+      angles[axis] = (mask & (DOF_RX << axis)) ? pChannels->GetBoneChannel(j, axis) + startFrame : zeros;
+    EulerToRotationMatrixBatch(numFrames, angles, R);
+
+    // J = M_parent * rot_parent_current
+    if (parent < 0)
+    {
+      for(int e=0; e<9; e++)
+        for(int f=0; f<numFrames; f++)
+          J[e][f] = L[e];
+    }
+    else
+    {
+      const double * P = rotationData + 9 * n * parent;
+      for(int r=0; r<3; r++)
+        for(int c=0; c<3; c++)
+        {
+          const double * p0 = P + (3 * r) * n, * p1 = P + (3 * r + 1) * n, * p2 = P + (3 * r + 2) * n;
+          double l0 = L[c], l1 = L[3 + c], l2 = L[6 + c];
+          double * out = J[3 * r + c];
+          for(int f=0; f<numFrames; f++)
+            out[f] = p0[f] * l0 + p1[f] * l1 + p2[f] * l2;
+        }
+    }
+
+    // translation (the root position for the root)
+    for(int axis=0; axis<3; axis++)
+    {
+      if (!(mask & (DOF_TX << axis)))
+      {
+        for(int f=0; f<numFrames; f++)
+          translation[axis][f] = 0.0;
+      }
+      else if (j == root)
+      {
+        const double * channel = pChannels->GetRootChannel(axis) + startFrame;
+        for(int f=0; f<numFrames; f++)
+          translation[axis][f] = channel[f];
+      }
+      else
+      {
+        for(int f=0; f<numFrames; f++)
+          translation[axis][f] = pMotion->GetPosture(startFrame + f)->bone_translation[j].p[axis];
+      }
+    }
+
+    // start of the bone = end of the parent + J * translation; W = J * R; end = start + W * (dir * length)
+    const double * boneVector = m_pBoneVector[j];
+    for(int r=0; r<3; r++)
+    {
+      const double * parentEnd = (parent < 0) ? zeros : endData + 3 * n * parent + r * n;
+      for(int f=0; f<numFrames; f++)
+        start[r][f] = parentEnd[f] + J[3 * r][f] * translation[0][f] + J[3 * r + 1][f] * translation[1][f] + J[3 * r + 2][f] * translation[2][f];
+      for(int c=0; c<3; c++)
+      {
+        const double * j0 = J[3 * r], * j1 = J[3 * r + 1], * j2 = J[3 * r + 2];
+        double * out = W + (3 * r + c) * n;
+        for(int f=0; f<numFrames; f++)
+          out[f] = j0[f] * R[c][f] + j1[f] * R[3 + c][f] + j2[f] * R[6 + c][f];
+      }
+      double * end = E + r * n;
+      const double * w0 = W + (3 * r) * n, * w1 = W + (3 * r + 1) * n, * w2 = W + (3 * r + 2) * n;
+      for(int f=0; f<numFrames; f++)
+        end[f] = start[r][f] + w0[f] * boneVector[0] + w1[f] * boneVector[1] + w2[f] * boneVector[2];
+    }
+
+    // output (frame by frame)
+    if (transforms != NULL)
+    {
+      for(int f=0; f<numFrames; f++)
+      {
+        double * transform = transforms + FK_TRANSFORM_SIZE * (m_NumBones * f + j);
+        for(int r=0; r<3; r++)
+        {
+          for(int c=0; c<3; c++)
+            transform[4 * r + c] = W[(3 * r + c) * n + f];
+          transform[4 * r + 3] = start[r][f];
+        }
+      }
+    }
+    if (positions != NULL)
+    {
+      for(int f=0; f<numFrames; f++)
+        for(int r=0; r<3; r++)
+          positions[3 * (m_NumBones * f + j) + r] = E[r * n + f];
+    }
+  }
+}
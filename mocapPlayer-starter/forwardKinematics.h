@@ -0,0 +1,78 @@
+/*
+forwardKinematics.h
+
+World-space joint positions of a posture, computed on the CPU (without OpenGL),
+with the same transformations as DisplaySkeleton::DrawBone:
+  M_bone = M_parent * rot_parent_current * T(tx, ty, tz) * Rz(rz) * Ry(ry) * Rx(rx)
+  end of the bone = M_bone * (dir * length), which is the origin of the child bones
+The root is translated by the root position of the posture.
+(The player additionally offsets each skeleton by SkeletonPose::GetTranslation / GetRotationAngle; this is not included.)
+
+The motion versions compute a range of frames at once: the frames are processed in blocks, with the bone
+rotations of a block converted in SIMD batches (see EulerToRotationMatrixBatch in quaternionBatch.h) directly
+from the channel layout of the motion, and the blocks are distributed over the threads of a thread pool (if set).
+*/
+
+#ifndef _FORWARDKINEMATICS_H_
+#define _FORWARDKINEMATICS_H_
+
+#include "skeleton.h"
+#include "posture.h"
+
+class Motion;
+class MotionChannels;
+class ThreadPool;
+
+// number of values of a bone transform: a 3x4 row-major matrix [R | t]
+#define FK_TRANSFORM_SIZE 12
+
+class ForwardKinematics
+{
+public:
+  // copies the hierarchy, the local rotations (rot_parent_current), bone directions, lengths and DOFs of the skeleton
+  ForwardKinematics(const Skeleton * pSkeleton);
+  ~ForwardKinematics();
+
+  int GetNumBones() { return m_NumBones; }
+
+  // positions[3 * bone + i] = coordinate i of the end of the bone (for the root: the root position), in world coordinates
+  void ComputeJointPositions(const Posture & posture, double * positions);
+
+  // compute the frames startFrame, ..., startFrame + numFrames - 1 of the motion in parallel with the threads of the pool 
+  // (NULL = serially; the default)
+  void SetThreadPool(ThreadPool * pThreadPool) { m_pThreadPool = pThreadPool; }
+
+  // joint positions of the frames startFrame, ..., startFrame + numFrames - 1 of the motion: 
+  // positions[3 * (numBones * (frame - startFrame) + bone) + i], as in ComputeJointPositions(posture)
+  void ComputeJointPositions(Motion * pMotion, int startFrame, int numFrames, double * positions);
+  // world transforms of the bones for the same frames: transform = transforms + FK_TRANSFORM_SIZE * (numBones * (frame - startFrame) + bone),
+  // [R | t] = M_bone (see above): R = world rotation of the bone after its joint rotation, t = world position of the start
+  // of the bone (the end of its parent); the end of the bone is t + R * GetBoneVector(bone)
+  void ComputeTransforms(Motion * pMotion, int startFrame, int numFrames, double * transforms);
+  // both of the above (either array may be NULL)
+  // If the motion is used by several threads, its channel (and, for bones with translational DOFs, posture) layout 
+  // must be up to date (see Motion::UpdateChannels).
+  void ComputeTransformsAndJointPositions(Motion * pMotion, int startFrame, int numFrames, double * transforms, double * positions);
+
+  // dir * length of the bone, in the coordinate system of the bone
+  const double * GetBoneVector(int bone) { return m_pBoneVector[bone]; }
+
+protected:
+  int m_NumBones;
+  int * m_pOrder; // bones in an order in which each bone comes after its parent
+  int * m_pParent; // parent of each bone (-1 for the root)
+  double (*m_pLocalRotation)[9]; // rot_parent_current of each bone, as a row-major 3x3 matrix
+  double (*m_pBoneVector)[3]; // dir * length of each bone
+  int * m_pDOFMask; // rotational (DOF_RX, DOF_RY, DOF_RZ) and translational (DOF_TX, DOF_TY, DOF_TZ) DOFs
+  int m_HasBoneTranslations; // whether a bone other than the root has translational DOFs (these are read from the postures)
+  ThreadPool * m_pThreadPool;
+
+  // computes a block of at most blockSize frames; workspace holds GetBlockWorkspaceSize() values
+  static const int blockSize = 32;
+  int GetBlockWorkspaceSize() { return (12 * m_NumBones + 25) * blockSize; }
+  void ComputeBlock(Motion * pMotion, MotionChannels * pChannels, int startFrame, int numFrames, double * workspace, 
+    double * transforms, double * positions);
+};
+
+#endif
+
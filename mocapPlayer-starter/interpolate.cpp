@@ -8,23 +8,719 @@
 #include <math.h>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <map>
+#include <vector>
 #include "interpolator.h"
 #include "motion.h"
+#include "amcReader.h"
+#include "amcWriter.h"
+#include "streamingInterpolator.h"
+#include "keyframeSelector.h"
+#include "motionCodec.h"
+#include "motionMetrics.h"
+#include "interpolationSweep.h"
+#include "forwardKinematics.h"
+#include "threadPool.h"
+#include "performanceCounter.h"
+
+// converts the interpolation type argument; returns 0 on success, -1 on an unknown type
+static int ParseInterpolationType(const char * interpolationTypeString, InterpolationType * interpolationType)
+{
+  if (interpolationTypeString[0] == 'l')
+    *interpolationType = LINEAR;
+  else if (interpolationTypeString[0] == 'b')
+    *interpolationType = BEZIER;
+  else if (interpolationTypeString[0] == 's')
+    *interpolationType = SQUAD;
+  else
+    return -1;
+  return 0;
+}
+
+static const char * GetInterpolationTypeName(InterpolationType interpolationType)
+{
+  if (interpolationType == LINEAR)
+    return "LINEAR";
+  else if (interpolationType == BEZIER)
+    return "BEZIER";
+  else
+    return "SQUAD";
+}
+
+// converts the angle representation argument; returns 0 on success, -1 on an unknown representation
+static int ParseAngleRepresentation(const char * angleRepresentationString, AngleRepresentation * angleRepresentation)
+{
+  if (angleRepresentationString[0] == 'e')
+    *angleRepresentation = EULER;
+  else if (angleRepresentationString[0] == 'q')
+    *angleRepresentation = QUATERNION;
+  else
+    return -1;
+  return 0;
+}
+
+// loads an AMC, AMCB or AMCZ motion file (by extension); returns NULL on failure
+// if pThreadPool is given, the frames of an AMC file are parsed in parallel; if quiet is 1, only errors are printed
+static Motion * LoadMotion(char * filename, const Skeleton * pSkeleton, ThreadPool * pThreadPool=NULL, int quiet=0)
+{
+  if (MotionCodec::IsAMCZFilename(filename))
+  {
+    Motion * pMotion = NULL;
+    MotionCodec::ReadFile(filename, pSkeleton, &pMotion);
+    return pMotion;
+  }
+
+  try
+  {
+    if (AMCBFile::IsAMCBFilename(filename))
+      return new Motion(filename, pSkeleton, MOCAP_SCALE, quiet);
+    else
+      return new Motion(filename, MOCAP_SCALE, pSkeleton, pThreadPool, quiet);
+  }
+  catch(int)
+  {
+    return NULL;
+  }
+}
+
+// loads the skeleton, with all rotational DOFs enabled (the motions are written with all of them, see WriteMotion);
+// returns NULL on failure (an error message is printed); if quiet is 1, only errors are printed
+static Skeleton * LoadSkeleton(const char * skeletonFile, int quiet=0)
+{
+  Skeleton * pSkeleton = NULL;
+  try
+  {
+    pSkeleton = new Skeleton((char*)skeletonFile, MOCAP_SCALE, quiet);
+  }
+  catch(int exceptionCode)
+  {
+    printf("Error: failed to load skeleton from %s. Code: %d\n", skeletonFile, exceptionCode);
+    return NULL;
+  }
+  // before the skeleton is shared (the loaders and the interpolators do not modify it)
+  pSkeleton->enableAllRotationalDOFs();
+  return pSkeleton;
+}
+
+// loads the skeleton (see LoadSkeleton) and the motion (see LoadMotion); returns 0 on success, and 1 on failure
+// (an error message is printed, and neither is allocated)
+static int LoadSkeletonAndMotion(char * skeletonFile, char * motionFile, Skeleton ** pSkeleton, Motion ** pMotion, ThreadPool * pThreadPool=NULL)
+{
+  *pMotion = NULL;
+  *pSkeleton = LoadSkeleton(skeletonFile);
+  if (*pSkeleton == NULL)
+    return 1;
+
+  *pMotion = LoadMotion(motionFile, *pSkeleton, pThreadPool);
+  if (*pMotion == NULL)
+  {
+    printf("Error: failed to load motion from %s.\n", motionFile);
+    delete *pSkeleton;
+    *pSkeleton = NULL;
+    return 1;
+  }
+  return 0;
+}
+
+// writes an AMC or AMCB motion file (by extension); returns 0 on success; if quiet is 1, only errors are printed
+static int WriteMotion(Motion * pMotion, char * filename, int quiet=0)
+{
+  if (MotionCodec::IsAMCZFilename(filename))
+  {
+    printf("Error: AMCZ files are written by the adaptive mode only.\n");
+    return -1;
+  }
+
+  int forceAllJointsBe3DOF = 1;
+  if (AMCBFile::IsAMCBFilename(filename))
+    return pMotion->writeAMCBfile(filename, MOCAP_SCALE, forceAllJointsBe3DOF, AMCB_DOUBLE, AMCB_DEFAULT_FRAME_RATE, quiet);
+  else
+    return pMotion->writeAMCfile(filename, MOCAP_SCALE, forceAllJointsBe3DOF, quiet);
+}
+
+/*
+  Batch mode: one job per line of the manifest file; each line has the same 
+  arguments as a single run of this program:
+    <skeleton file> <motion file> <interpolation type> <angle representation> <N> <output motion file>
+  Empty lines and lines starting with '#' are ignored.
+
+  Each skeleton file is parsed once (with all rotational DOFs enabled), and shared by the jobs that use it. 
+  The jobs run in parallel, quietly: only the timing summary (with the failed jobs) is printed at the end, 
+  and the error messages of the loaders and the writers.
+*/
+
+struct BatchJob
+{
+  // input
+  std::string skeletonFile, motionFile, outputFile;
+  char interpolationTypeString[8], angleRepresentationString[8];
+  InterpolationType interpolationType;
+  AngleRepresentation angleRepresentation;
+  int N;
+  int skeletonIndex; // into the skeleton cache
+
+  // results
+  const char * error; // NULL if the job succeeded
+  int numFrames;
+  double loadTime, interpolationTime, writeTime;
+};
+
+static int ReadManifest(const char * manifestFile, std::vector<BatchJob> & jobs)
+{
+  FILE * file = fopen(manifestFile, "r");
+  if (file == NULL)
+  {
+    printf("Error: cannot open manifest %s.\n", manifestFile);
+    return -1;
+  }
+
+  char line[4096 * 3];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    lineNumber++;
+
+    char * p = line;
+    while ((*p == ' ') || (*p == '\t'))
+      p++;
+    if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == 0))
+      continue;
+
+    char skeletonFile[4096], motionFile[4096], outputFile[4096];
+    BatchJob job;
+    if ((sscanf(p, "%4095s %4095s %7s %7s %d %4095s", skeletonFile, motionFile, 
+           job.interpolationTypeString, job.angleRepresentationString, &job.N, outputFile) != 6) ||
+        (ParseInterpolationType(job.interpolationTypeString, &job.interpolationType) != 0) ||
+        (ParseAngleRepresentation(job.angleRepresentationString, &job.angleRepresentation) != 0) ||
+        ((job.interpolationType == SQUAD) && (job.angleRepresentation != QUATERNION)) ||
+        (job.N < 0))
+    {
+      printf("Error: invalid job in %s, line %d: %s", manifestFile, lineNumber, line);
+      fclose(file);
+      return -1;
+    }
+
+    job.skeletonFile = skeletonFile;
+    job.motionFile = motionFile;
+    job.outputFile = outputFile;
+    job.skeletonIndex = -1;
+    job.error = NULL;
+    job.numFrames = 0;
+    job.loadTime = job.interpolationTime = job.writeTime = 0.0;
+    jobs.push_back(job);
+  }
+
+  fclose(file);
+  return 0;
+}
+
+static void RunBatchJob(BatchJob & job, const Skeleton * pSkeleton)
+{
+  PerformanceCounter counter;
+
+  counter.StartCounter();
+  Motion * pInputMotion = LoadMotion((char*)job.motionFile.c_str(), pSkeleton, NULL, 1);
+  counter.StopCounter();
+  job.loadTime = counter.GetElapsedTime();
+  if (pInputMotion == NULL)
+  {
+    job.error = "failed to load motion";
+    return;
+  }
+  job.numFrames = pInputMotion->GetNumFrames();
+
+  Interpolator interpolator;
+  interpolator.SetInterpolationType(job.interpolationType);
+  interpolator.SetAngleRepresentation(job.angleRepresentation);
+
+  // the input motion is not needed afterwards, so it is interpolated in place
+  counter.StartCounter();
+  int code = interpolator.Interpolate(pInputMotion, pInputMotion, job.N);
+  counter.StopCounter();
+  job.interpolationTime = counter.GetElapsedTime();
+
+  if (code != 0)
+    job.error = "interpolation failed";
+  else
+  {
+    counter.StartCounter();
+    if (WriteMotion(pInputMotion, (char*)job.outputFile.c_str(), 1) != 0)
+      job.error = "failed to write output";
+    counter.StopCounter();
+    job.writeTime = counter.GetElapsedTime();
+  }
+
+  delete pInputMotion;
+}
+
+static int RunBatch(const char * manifestFile, int numThreads)
+{
+  std::vector<BatchJob> jobs;
+  if (ReadManifest(manifestFile, jobs) != 0)
+    return 1;
+  int numJobs = (int)jobs.size();
+
+  PerformanceCounter totalCounter;
+  totalCounter.StartCounter();
+
+  // parse each skeleton once (serially: the ASF parser is not reentrant)
+  std::map<std::string, int> skeletonIndices;
+  std::vector<Skeleton*> skeletons;
+  PerformanceCounter counter;
+  counter.StartCounter();
+  for(int i = 0; i < numJobs; i++)
+  {
+    std::map<std::string, int>::iterator iter = skeletonIndices.find(jobs[i].skeletonFile);
+    if (iter != skeletonIndices.end())
+    {
+      jobs[i].skeletonIndex = iter->second;
+      continue;
+    }
+
+    Skeleton * pSkeleton = LoadSkeleton(jobs[i].skeletonFile.c_str(), 1); // NULL on failure
+    jobs[i].skeletonIndex = (int)skeletons.size();
+    skeletonIndices[jobs[i].skeletonFile] = jobs[i].skeletonIndex;
+    skeletons.push_back(pSkeleton);
+  }
+  counter.StopCounter();
+  double skeletonTime = counter.GetElapsedTime();
+
+  ThreadPool threadPool(numThreads);
+  threadPool.ParallelForWorkStealing(numJobs, [&](int i)
+  {
+    Skeleton * pSkeleton = skeletons[jobs[i].skeletonIndex];
+    if (pSkeleton == NULL)
+      jobs[i].error = "failed to load skeleton";
+    else
+      RunBatchJob(jobs[i], pSkeleton);
+  });
+
+  totalCounter.StopCounter();
+
+  // summary
+  printf("\n%-4s %-6s %4s %7s %9s %9s %9s %9s  %s\n", 
+    "job", "method", "N", "frames", "load[s]", "interp[s]", "write[s]", "total[s]", "motion");
+  int numFailedJobs = 0;
+  long totalFrames = 0;
+  double totalLoadTime = 0.0, totalInterpolationTime = 0.0, totalWriteTime = 0.0;
+  for(int i = 0; i < numJobs; i++)
+  {
+    BatchJob & job = jobs[i];
+    char method[3] = { job.interpolationTypeString[0], job.angleRepresentationString[0], 0 };
+    double jobTime = job.loadTime + job.interpolationTime + job.writeTime;
+    printf("%-4d %-6s %4d %7d %9.4f %9.4f %9.4f %9.4f  %s", i + 1, method, job.N, job.numFrames, 
+      job.loadTime, job.interpolationTime, job.writeTime, jobTime, job.motionFile.c_str());
+    if (job.error != NULL)
+      printf(" (Error: %s)", job.error);
+    printf("\n");
+
+    if (job.error != NULL)
+      numFailedJobs++;
+    totalFrames += job.numFrames;
+    totalLoadTime += job.loadTime;
+    totalInterpolationTime += job.interpolationTime;
+    totalWriteTime += job.writeTime;
+  }
+
+  double wallTime = totalCounter.GetElapsedTime();
+  printf("\n%d jobs (%d failed) on %d threads, %d skeleton files parsed in %.4f s.\n", 
+    numJobs, numFailedJobs, threadPool.GetNumThreads(), (int)skeletons.size(), skeletonTime);
+  printf("Job time: load %.4f s, interpolation %.4f s, write %.4f s, total %.4f s.\n", 
+    totalLoadTime, totalInterpolationTime, totalWriteTime, totalLoadTime + totalInterpolationTime + totalWriteTime);
+  printf("Wall time: %.4f s (%.0f frames/s).\n", wallTime, (wallTime > 0.0) ? totalFrames / wallTime : 0.0);
+
+  for(size_t i = 0; i < skeletons.size(); i++)
+    delete skeletons[i];
+
+  return (numFailedJobs == 0) ? 0 : 1;
+}
+
+/*
+  Streaming mode: same arguments as a single run, for AMC files only. The input motion is read frame by frame, 
+  and the interpolated frames are written as soon as they are known (see streamingInterpolator.h), so that the
+  memory use does not depend on the length of the motion. The output is the same as that of a single run.
+*/
+static int RunStreaming(char ** argv, int numThreads)
+{
+  char * skeletonFile = argv[0];
+  char * motionFile = argv[1];
+  char * outputFile = argv[5];
+  InterpolationType interpolationType;
+  AngleRepresentation angleRepresentation;
+  int N = strtol(argv[4], NULL, 10);
+  if ((ParseInterpolationType(argv[2], &interpolationType) != 0) || (ParseAngleRepresentation(argv[3], &angleRepresentation) != 0) ||
+      ((interpolationType == SQUAD) && (angleRepresentation != QUATERNION)) || (N < 0))
+  {
+    printf("Error: invalid interpolation type, angle representation or N.\n");
+    return 1;
+  }
+  if (AMCBFile::IsAMCBFilename(motionFile) || AMCBFile::IsAMCBFilename(outputFile) ||
+      MotionCodec::IsAMCZFilename(motionFile) || MotionCodec::IsAMCZFilename(outputFile))
+  {
+    printf("Error: streaming mode supports AMC files only.\n");
+    return 1;
+  }
+
+  Skeleton * pSkeleton = LoadSkeleton(skeletonFile);
+  if (pSkeleton == NULL)
+    return 1;
+
+  AMCReader reader(pSkeleton, MOCAP_SCALE);
+  if (reader.Open(motionFile) != 0)
+  {
+    delete pSkeleton;
+    return 1;
+  }
+
+  int forceAllJointsBe3DOF = 1;
+  AMCWriter writer(pSkeleton, MOCAP_SCALE);
+  if (writer.Open(outputFile, forceAllJointsBe3DOF) != 0)
+  {
+    printf("Error: failed to write %s.\n", outputFile);
+    delete pSkeleton;
+    return 1;
+  }
+
+  Interpolator interpolator;
+  interpolator.SetInterpolationType(interpolationType);
+  interpolator.SetAngleRepresentation(angleRepresentation);
+  ThreadPool * pThreadPool = NULL;
+  if (numThreads != 1)
+  {
+    pThreadPool = new ThreadPool(numThreads);
+    interpolator.SetThreadPool(pThreadPool);
+  }
+
+  PerformanceCounter counter;
+  counter.StartCounter();
+  int outputFrame = 0;
+  StreamingInterpolator stream(pSkeleton, &interpolator, N, [&](const Posture & posture) { return writer.WriteFrame(++outputFrame, posture); });
+  Posture posture(pSkeleton->getNumBones());
+  int frameNumber, code;
+  while ((code = reader.ReadFrame(posture, &frameNumber)) == 1)
+  {
+    if (stream.AddFrame(posture) != 0)
+      break;
+  }
+  int failed = (code != 0) || (stream.Finish() != 0);
+  if (writer.Close() != 0)
+    failed = 1;
+  counter.StopCounter();
+
+  if (failed)
+    printf("Error: streaming interpolation of %s to %s failed.\n", motionFile, outputFile);
+  else
+    printf("%d frames interpolated and written to %s in %.4f s.\n", stream.GetNumOutputFrames(), outputFile, counter.GetElapsedTime());
+
+  delete pThreadPool;
+  delete pSkeleton;
+  return failed ? 1 : 0;
+}
+
+/*
+  Adaptive mode: instead of every (N+1)th frame, the keyframes are selected such that the motion interpolated 
+  from them stays within an error tolerance (see keyframeSelector.h):
+    <skeleton file> <motion file> <interpolation type> <angle representation> <error metric> <tolerance> <output motion file> [keyframe file]
+  Error metric: 'd': joint rotation error in degrees, 'p': joint position error in skeleton units.
+  The keyframe file receives the selected frame indices (0-based), one per line.
+  If the output file name ends with .amcz, the keyframes are written compressed (see motionCodec.h), and
+  the other frames are reconstructed when the file is loaded.
+*/
+static int RunAdaptive(char ** argv, const char * keyframeFile)
+{
+  char * skeletonFile = argv[0];
+  char * motionFile = argv[1];
+  char * outputFile = argv[6];
+  InterpolationType interpolationType;
+  AngleRepresentation angleRepresentation;
+  KeyframeErrorMetric metric = (argv[4][0] == 'p') ? POSITION_ERROR : ROTATION_ERROR;
+  double tolerance = strtod(argv[5], NULL);
+  if ((ParseInterpolationType(argv[2], &interpolationType) != 0) || (ParseAngleRepresentation(argv[3], &angleRepresentation) != 0) ||
+      ((interpolationType == SQUAD) && (angleRepresentation != QUATERNION)) || ((argv[4][0] != 'd') && (argv[4][0] != 'p')) || !(tolerance >= 0.0))
+  {
+    printf("Error: invalid interpolation type, angle representation, error metric or tolerance.\n");
+    return 1;
+  }
+
+  Skeleton * pSkeleton;
+  Motion * pInputMotion;
+  if (LoadSkeletonAndMotion(skeletonFile, motionFile, &pSkeleton, &pInputMotion) != 0)
+    return 1;
+
+  PerformanceCounter counter;
+  counter.StartCounter();
+  KeyframeSelector selector(interpolationType, angleRepresentation, metric, tolerance);
+  int * keyframes = NULL;
+  int numKeyframes = selector.SelectKeyframes(pInputMotion, &keyframes);
+  counter.StopCounter();
+  int numFrames = pInputMotion->GetNumFrames();
+  printf("%d of %d frames selected as keyframes (%.2f%%) in %.4f s (%d segment evaluations).\n", numKeyframes, numFrames,
+    (numFrames > 0) ? 100.0 * numKeyframes / numFrames : 0.0, counter.GetElapsedTime(), selector.GetNumSegmentEvaluations());
+  printf("Max error: %g %s (tolerance: %g).\n", selector.GetMaxError(), (metric == ROTATION_ERROR) ? "degrees" : "units", tolerance);
+
+  int failed = 0;
+  if (keyframeFile != NULL)
+  {
+    FILE * file = fopen(keyframeFile, "w");
+    if (file == NULL)
+    {
+      printf("Error: failed to write %s.\n", keyframeFile);
+      failed = 1;
+    }
+    else
+    {
+      for(int i=0; i<numKeyframes; i++)
+        fprintf(file, "%d\n", keyframes[i]);
+      fclose(file);
+    }
+  }
+
+  Motion * pOutputMotion = NULL;
+  if (MotionCodec::IsAMCZFilename(outputFile))
+  {
+    if (MotionCodec::WriteFile(outputFile, pInputMotion, numKeyframes, keyframes, interpolationType, angleRepresentation) != 0)
+      failed = 1;
+  }
+  else
+  {
+    selector.Reconstruct(pInputMotion, numKeyframes, keyframes, &pOutputMotion);
+    if (WriteMotion(pOutputMotion, outputFile) != 0)
+    {
+      printf("Error: failed to write %s.\n", outputFile);
+      failed = 1;
+    }
+  }
+
+  delete [] keyframes;
+  delete pOutputMotion;
+  delete pInputMotion;
+  delete pSkeleton;
+  return failed;
+}
+
+/*
+  Metrics mode: compares a motion with a reference motion (for example, the input and the interpolated motion):
+    <skeleton file> <reference motion file> <motion file> <output prefix> [number of threads]
+  Prints the total statistics, and writes them with the per-joint statistics to <output prefix>.json,
+  the per-joint statistics to <output prefix>_joints.csv, and the per-frame errors to <output prefix>_frames.csv
+  (see motionMetrics.h).
+*/
+static int RunMetrics(char ** argv, int numThreads)
+{
+  char * skeletonFile = argv[0];
+  ThreadPool threadPool(numThreads);
+  Skeleton * pSkeleton;
+  Motion * pMotions[2] = { NULL, NULL };
+  if (LoadSkeletonAndMotion(skeletonFile, argv[1], &pSkeleton, &pMotions[0], &threadPool) != 0)
+    return 1;
+  pMotions[1] = LoadMotion(argv[2], pSkeleton, &threadPool);
+  if (pMotions[1] == NULL)
+  {
+    printf("Error: failed to load motion from %s.\n", argv[2]);
+    delete pMotions[0];
+    delete pSkeleton;
+    return 1;
+  }
+
+  MotionMetrics metrics(pSkeleton);
+  metrics.SetThreadPool(&threadPool);
+  PerformanceCounter counter;
+  counter.StartCounter();
+  int failed = (metrics.Compute(pMotions[0], pMotions[1]) != 0);
+  counter.StopCounter();
+
+  if (!failed)
+  {
+    printf("%d frames, %d joints compared in %.4f s on %d threads.\n", metrics.GetNumFrames(), metrics.GetNumJoints(), 
+      counter.GetElapsedTime(), threadPool.GetNumThreads());
+    printf("%-13s %12s %12s %12s %12s  %s\n", "metric", "mean", "rms", "max", "p95 (frame)", "max at");
+    for(int metric=0; metric<NUM_METRICS; metric++)
+    {
+      const MetricStatistics & statistics = metrics.GetStatistics((MotionMetric)metric);
+      printf("%-13s %12.6g %12.6g %12.6g %12.6g  frame %d, %s\n", MotionMetrics::GetMetricName((MotionMetric)metric), statistics.mean, 
+        statistics.rms, statistics.max, statistics.percentile95, statistics.maxFrame, 
+        (statistics.maxJoint >= 0) ? pSkeleton->idx2name(statistics.maxJoint) : "-");
+    }
+
+    std::string prefix = argv[3];
+    if ((metrics.WriteJSON((prefix + ".json").c_str()) != 0) || (metrics.WriteJointsCSV((prefix + "_joints.csv").c_str()) != 0) || 
+        (metrics.WriteFramesCSV((prefix + "_frames.csv").c_str()) != 0))
+      failed = 1;
+  }
+
+  delete pMotions[1];
+  delete pMotions[0];
+  delete pSkeleton;
+  return failed;
+}
+
+/*
+  Sweep mode: interpolates the motion with every interpolation method, for each N of a range, and compares 
+  each result with the input motion (see interpolationSweep.h):
+    <skeleton file> <motion file> <first N> <last N> <N step> <results file> [number of threads]
+  The motion is loaded once. Prints the timing and the main errors of each run, and writes all statistics 
+  to the results file (CSV).
+*/
+static int RunSweep(char ** argv, int numThreads)
+{
+  char * skeletonFile = argv[0];
+  char * motionFile = argv[1];
+  int firstN = strtol(argv[2], NULL, 10);
+  int lastN = strtol(argv[3], NULL, 10);
+  int stepN = strtol(argv[4], NULL, 10);
+  char * resultsFile = argv[5];
+
+  ThreadPool * pThreadPool = (numThreads != 1) ? new ThreadPool(numThreads) : NULL;
+  Skeleton * pSkeleton;
+  Motion * pInputMotion;
+  if (LoadSkeletonAndMotion(skeletonFile, motionFile, &pSkeleton, &pInputMotion, pThreadPool) != 0)
+  {
+    delete pThreadPool;
+    return 1;
+  }
+
+  int failed = 0;
+  {
+    InterpolationSweep sweep(pInputMotion);
+    sweep.SetThreadPool(pThreadPool);
+    PerformanceCounter counter;
+    counter.StartCounter();
+    int numRuns = sweep.Run(firstN, lastN, stepN);
+    counter.StopCounter();
+    failed = (numRuns < 0);
+
+    if (!failed)
+    {
+      printf("%d runs on %d frames in %.4f s (%d threads).\n", numRuns, pInputMotion->GetNumFrames(), counter.GetElapsedTime(), 
+        (pThreadPool != NULL) ? pThreadPool->GetNumThreads() : 1);
+      printf("%-18s %4s %9s %10s %12s %12s %13s %13s\n", "method", "N", "keyframes", "time (ms)", "angle mean", "angle max", 
+        "position mean", "position max");
+      for(int i=0; i<sweep.GetNumResults(); i++)
+      {
+        const SweepResult & result = sweep.GetResult(i);
+        printf("%-18s %4d %9d %10.3f %12.6g %12.6g %13.6g %13.6g\n", InterpolationSweep::GetMethodName(result), result.N, 
+          result.numKeyframes, 1000.0 * result.time, result.errors[METRIC_ANGLE].mean, result.errors[METRIC_ANGLE].max, 
+          result.errors[METRIC_POSITION].mean, result.errors[METRIC_POSITION].max);
+      }
+      if (sweep.WriteCSV(resultsFile) != 0)
+        failed = 1;
+    }
+  }
+
+  delete pThreadPool;
+  delete pInputMotion;
+  delete pSkeleton;
+  return failed;
+}
+
+/*
+  Positions mode: world positions of the joints (the ends of the bones, see forwardKinematics.h) of all frames:
+    <skeleton file> <motion file> <output file> [number of threads]
+  The output file is a CSV file with one line per frame: the frame, and x, y, z of each bone (in bone index order).
+*/
+static int RunPositions(char ** argv, int numThreads)
+{
+  char * skeletonFile = argv[0];
+  char * motionFile = argv[1];
+  char * outputFile = argv[2];
+  ThreadPool threadPool(numThreads);
+  Skeleton * pSkeleton;
+  Motion * pMotion;
+  if (LoadSkeletonAndMotion(skeletonFile, motionFile, &pSkeleton, &pMotion, &threadPool) != 0)
+    return 1;
+
+  ForwardKinematics forwardKinematics(pSkeleton);
+  forwardKinematics.SetThreadPool(&threadPool);
+  int numBones = forwardKinematics.GetNumBones();
+  int numFrames = pMotion->GetNumFrames();
+  std::vector<double> positions(3 * (size_t)numBones * numFrames);
+  PerformanceCounter counter;
+  counter.StartCounter();
+  forwardKinematics.ComputeJointPositions(pMotion, 0, numFrames, positions.data());
+  counter.StopCounter();
+  printf("Joint positions of %d frames, %d bones computed in %.4f s on %d threads.\n", numFrames, numBones, 
+    counter.GetElapsedTime(), threadPool.GetNumThreads());
+
+  int failed = 0;
+  FILE * file = fopen(outputFile, "w");
+  if (file == NULL)
+    failed = 1;
+  else
+  {
+    fprintf(file, "frame");
+    for(int bone=0; bone<numBones; bone++)
+      fprintf(file, ",%s_x,%s_y,%s_z", pSkeleton->idx2name(bone), pSkeleton->idx2name(bone), pSkeleton->idx2name(bone));
+    fprintf(file, "\n");
+    for(int frame=0; frame<numFrames; frame++)
+    {
+      fprintf(file, "%d", frame);
+      for(int i=0; i<3 * numBones; i++)
+        fprintf(file, ",%.9g", positions[3 * (size_t)numBones * frame + i]);
+      fprintf(file, "\n");
+    }
+    failed = ferror(file);
+    fclose(file);
+  }
+  if (failed)
+    printf("Error: failed to write %s.\n", outputFile);
+
+  delete pMotion;
+  delete pSkeleton;
+  return failed;
+}
 
 int main(int argc, char **argv) 
 {
-  if ( argc != 7 )
+  if ((argc >= 3) && (argc <= 4) && (strcmp(argv[1], "-batch") == 0))
+    return RunBatch(argv[2], (argc == 4) ? strtol(argv[3], NULL, 10) : 0);
+
+  if ((argc >= 8) && (argc <= 9) && (strcmp(argv[1], "-stream") == 0))
+    return RunStreaming(&argv[2], (argc == 9) ? strtol(argv[8], NULL, 10) : 1);
+
+  if ((argc >= 9) && (argc <= 10) && (strcmp(argv[1], "-adaptive") == 0))
+    return RunAdaptive(&argv[2], (argc == 10) ? argv[9] : NULL);
+
+  if ((argc >= 6) && (argc <= 7) && (strcmp(argv[1], "-metrics") == 0))
+    return RunMetrics(&argv[2], (argc == 7) ? strtol(argv[6], NULL, 10) : 0);
+
+  if ((argc >= 5) && (argc <= 6) && (strcmp(argv[1], "-positions") == 0))
+    return RunPositions(&argv[2], (argc == 6) ? strtol(argv[5], NULL, 10) : 0);
+
+  if ((argc >= 8) && (argc <= 9) && (strcmp(argv[1], "-sweep") == 0))
+    return RunSweep(&argv[2], (argc == 9) ? strtol(argv[8], NULL, 10) : 1);
+
+  if ((argc != 7) && (argc != 8))
   {
     printf("Interpolates motion capture data.");
-    printf("Usage: %s <input skeleton file> <input motion capture file> <interpolation type> <angle representation for interpolation> <N> <output motion capture file>\n", argv[0]);
+    printf("Usage: %s <input skeleton file> <input motion capture file> <interpolation type> <angle representation for interpolation> <N> <output motion capture file> [number of threads]\n", argv[0]);
     printf("  interpolation method:\n");
     printf("    l: linear\n");
     printf("    b: Bezier\n");
+    printf("    s: SQUAD (spherical quadrangle; quaternions only)\n");
     printf("  angle representation for interpolation:\n");
     printf("    e: Euler angles\n");
     printf("    q: quaternions\n");
     printf("  N: number of skipped frames\n");
+    printf("  number of threads: parse the AMC frames and interpolate the keyframe segments in parallel (0 = one per hardware thread; default: 1)\n");
+    printf("Motion files whose name ends with .amcb are read/written in the binary AMCB format, other files in the AMC format.\n");
+    printf("Files whose name ends with .amcz (compressed keyframes, written by the adaptive mode) can be read by all modes.\n");
     printf("Example: %s skeleton.asf motion.amc l e 5 outputMotion.amc\n", argv[0]);  
+    printf("Batch usage: %s -batch <manifest file> [number of threads]\n", argv[0]);
+    printf("  Each line of the manifest lists the six arguments above for one job.\n");
+    printf("  Jobs run in parallel (by default, on all hardware threads).\n");
+    printf("Streaming usage: %s -stream <the arguments of a single run>\n", argv[0]);
+    printf("  Reads and writes the motion frame by frame, with memory independent of its length (AMC files only).\n");
+    printf("Adaptive usage: %s -adaptive <input skeleton file> <input motion capture file> <interpolation type> <angle representation for interpolation> <error metric> <tolerance> <output motion capture file> [keyframe file]\n", argv[0]);
+    printf("  Selects the keyframes such that the interpolated motion is within the tolerance of the input.\n");
+    printf("  error metric: d: joint rotations (degrees), p: joint positions; the keyframe file receives the selected frames.\n");
+    printf("  With an .amcz output file, only the keyframes are written, quantized (lossy compression).\n");
+    printf("Metrics usage: %s -metrics <input skeleton file> <reference motion file> <motion file> <output prefix> [number of threads]\n", argv[0]);
+    printf("  Angle, joint position, velocity and acceleration errors of the motion; writes <prefix>.json, <prefix>_joints.csv and <prefix>_frames.csv.\n");
+    printf("Positions usage: %s -positions <input skeleton file> <motion file> <output file> [number of threads]\n", argv[0]);
+    printf("  Writes the world positions of the joints of all frames (CSV, one line per frame).\n");
+    printf("Sweep usage: %s -sweep <input skeleton file> <input motion capture file> <first N> <last N> <N step> <results file> [number of threads]\n", argv[0]);
+    printf("  Interpolates the motion with every method for each N, and writes the time and the errors of each run to the results file (CSV).\n");
     return -1;
   }
 
@@ -34,84 +730,93 @@ int main(int argc, char **argv)
   char * angleRepresentationString = argv[4];
   char * NString = argv[5];
   char * outputMotionCaptureFile = argv[6];
+  int numThreads = (argc == 8) ? strtol(argv[7], NULL, 10) : 1;
 
   int N = strtol(NString, NULL, 10);
   if (N < 0)
   {
     printf("Error: invalid N value (%d).\n", N);
-    exit(1);
+    return 1;
   }
   printf("N=%d\n", N);
 
-  Skeleton * pSkeleton = NULL;	// skeleton as read from an ASF file (input)
-  Motion * pInputMotion = NULL; // motion as read from an AMC file (input)
-
-  printf("Loading skeleton from %s...\n", inputSkeletonFile);
-  try
+  // the thread pool also parses the frames of an AMC file in parallel
+  ThreadPool * pThreadPool = NULL;
+  if (numThreads != 1)
   {
-    pSkeleton = new Skeleton(inputSkeletonFile, MOCAP_SCALE);
-  }
-  catch(int exceptionCode)
-  {
-    printf("Error: failed to load skeleton from %s. Code: %d\n", inputSkeletonFile, exceptionCode);
-    exit(1);
+    pThreadPool = new ThreadPool(numThreads);
+    printf("Using %d threads.\n", pThreadPool->GetNumThreads());
   }
 
-  printf("Loading input motion from %s...\n", inputMotionCaptureFile);
-  try
-  {
-    pInputMotion = new Motion(inputMotionCaptureFile, MOCAP_SCALE, pSkeleton);
-  }
-  catch(int exceptionCode)
+  Skeleton * pSkeleton = NULL;	// skeleton as read from an ASF file (input)
+  Motion * pInputMotion = NULL; // motion as read from an AMC file (input)
+  printf("Loading skeleton from %s and input motion from %s...\n", inputSkeletonFile, inputMotionCaptureFile);
+  if (LoadSkeletonAndMotion(inputSkeletonFile, inputMotionCaptureFile, &pSkeleton, &pInputMotion, pThreadPool) != 0)
   {
-    printf("Error: failed to load motion from %s. Code: %d\n", inputMotionCaptureFile, exceptionCode);
-    exit(1);
+    delete pThreadPool;
+    return 1;
   }
 
-  pSkeleton->enableAllRotationalDOFs();
-
   InterpolationType interpolationType;
-  if (interpolationTypeString[0] == 'l')
-    interpolationType = LINEAR;
-  else if (interpolationTypeString[0] == 'b')
-    interpolationType = BEZIER;
-  else
+  if (ParseInterpolationType(interpolationTypeString, &interpolationType) != 0)
   {
     printf("Error: unknown interpolation type: %s\n", interpolationTypeString);
-    exit(1);
+    delete pInputMotion;
+    delete pThreadPool;
+    delete pSkeleton;
+    return 1;
   }
-  printf("Interpolation type is: %s\n", (interpolationType == LINEAR) ? "LINEAR" : "BEZIER");
+  printf("Interpolation type is: %s\n", GetInterpolationTypeName(interpolationType));
 
   AngleRepresentation angleRepresentation;
-  if (angleRepresentationString[0] == 'e')
-    angleRepresentation = EULER;
-  else if (angleRepresentationString[0] == 'q')
-    angleRepresentation = QUATERNION;
-  else
+  if (ParseAngleRepresentation(angleRepresentationString, &angleRepresentation) != 0)
   {
     printf("Error: unknown angle representation: %s\n", angleRepresentationString);
-    exit(1);
+    delete pInputMotion;
+    delete pThreadPool;
+    delete pSkeleton;
+    return 1;
   }
   printf("Angle representation for interpolation is: %s\n", (angleRepresentation == EULER) ? "EULER" : "QUATERNION");
+  if ((interpolationType == SQUAD) && (angleRepresentation != QUATERNION))
+  {
+    printf("Error: SQUAD interpolation requires quaternions.\n");
+    delete pInputMotion;
+    delete pThreadPool;
+    delete pSkeleton;
+    return 1;
+  }
 
   Interpolator interpolator;
   interpolator.SetInterpolationType(interpolationType);
   interpolator.SetAngleRepresentation(angleRepresentation);
 
+  interpolator.SetThreadPool(pThreadPool);
+
+  // the input motion is interpolated in place (it becomes the output motion)
   printf("Interpolating...\n");
-  Motion * pOutputMotion; // interpolated motion (output)
-  interpolator.Interpolate(pInputMotion, &pOutputMotion, N);
-  if (pOutputMotion == NULL)
+  int failed = 0;
+  if (interpolator.Interpolate(pInputMotion, pInputMotion, N) != 0)
   {
     printf("Error: interpolation failed. No output generated.\n");
-    exit(1);
+    failed = 1;
   }
-  printf("Interpolation completed.\n");
+  else
+  {
+    printf("Interpolation completed.\n");
 
-  printf("Writing output motion capture file to %s...\n", outputMotionCaptureFile);
-  int forceAllJointsBe3DOF = 1;
-  pOutputMotion->writeAMCfile(outputMotionCaptureFile, 0.06, forceAllJointsBe3DOF);
+    printf("Writing output motion capture file to %s...\n", outputMotionCaptureFile);
+    if (WriteMotion(pInputMotion, outputMotionCaptureFile) != 0)
+    {
+      printf("Error: failed to write %s.\n", outputMotionCaptureFile);
+      failed = 1;
+    }
+  }
 
-  return 0;
+  delete pThreadPool;
+  delete pInputMotion;
+  delete pSkeleton;
+
+  return failed;
 }
 
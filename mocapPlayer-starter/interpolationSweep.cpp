@@ -0,0 +1,147 @@
+/*
+interpolationSweep.cpp
+
+Parameter sweep over the interpolation methods and keyframe strides of one motion.
+*/
+
+#include <stdio.h>
+#include "interpolationSweep.h"
+#include "performanceCounter.h"
+
+InterpolationSweep::InterpolationSweep(Motion * pInputMotion) : m_Metrics(pInputMotion->GetSkeleton())
+{
+  m_pInputMotion = pInputMotion;
+  m_pOutputMotion = new Motion(pInputMotion->GetNumFrames(), pInputMotion->GetSkeleton());
+  m_Repetitions = 1;
+  m_pResults = NULL;
+  m_NumResults = m_ResultsCapacity = 0;
+}
+
+InterpolationSweep::~InterpolationSweep()
+{
+  delete [] m_pResults;
+  delete m_pOutputMotion;
+}
+
+void InterpolationSweep::SetThreadPool(ThreadPool * pThreadPool)
+{
+  m_Interpolator.SetThreadPool(pThreadPool);
+  m_Metrics.SetThreadPool(pThreadPool);
+}
+
+int InterpolationSweep::Run(int firstN, int lastN, int stepN)
+{
+  if ((firstN < 0) || (lastN < firstN) || (stepN < 1))
+  {
+    printf("Error in InterpolationSweep::Run: invalid range of N (%d to %d, step %d).\n", firstN, lastN, stepN);
+    return -1;
+  }
+
+  const InterpolationType interpolationTypes[] = { LINEAR, LINEAR, BEZIER, BEZIER, SQUAD };
+  const AngleRepresentation angleRepresentations[] = { EULER, QUATERNION, EULER, QUATERNION, QUATERNION };
+  int numRuns = 0;
+  for(int method=0; method<5; method++)
+  {
+    for(int N=firstN; N<=lastN; N+=stepN)
+    {
+      if (Run(interpolationTypes[method], angleRepresentations[method], N) != 0)
+        return -1;
+      numRuns++;
+    }
+  }
+  return numRuns;
+}
+
+int InterpolationSweep::Run(InterpolationType interpolationType, AngleRepresentation angleRepresentation, int N)
+{
+  if ((N < 0) || ((interpolationType == SQUAD) && (angleRepresentation != QUATERNION)))
+  {
+    printf("Error in InterpolationSweep::Run: invalid N (%d) or interpolation method.\n", N);
+    return -1;
+  }
+
+  m_Interpolator.SetInterpolationType(interpolationType);
+  m_Interpolator.SetAngleRepresentation(angleRepresentation);
+
+  SweepResult result;
+  result.interpolationType = interpolationType;
+  result.angleRepresentation = angleRepresentation;
+  result.N = N;
+  int numFrames = m_pInputMotion->GetNumFrames();
+  result.numKeyframes = (numFrames > 0) ? (numFrames - 1) / (N + 1) + 1 : 0;
+  result.time = 0.0;
+  for(int repetition=0; repetition<m_Repetitions; repetition++)
+  {
+    PerformanceCounter counter;
+    counter.StartCounter();
+    if (m_Interpolator.Interpolate(m_pInputMotion, m_pOutputMotion, N) != 0)
+      return -1;
+    counter.StopCounter();
+    if ((repetition == 0) || (counter.GetElapsedTime() < result.time))
+      result.time = counter.GetElapsedTime();
+  }
+
+  if (m_Metrics.Compute(m_pInputMotion, m_pOutputMotion) != 0)
+    return -1;
+  for(int metric=0; metric<NUM_METRICS; metric++)
+    result.errors[metric] = m_Metrics.GetStatistics((MotionMetric)metric);
+
+  if (m_NumResults == m_ResultsCapacity)
+  {
+    int capacity = (m_ResultsCapacity > 0) ? 2 * m_ResultsCapacity : 64;
+    SweepResult * pResults = new SweepResult[capacity];
+    for(int i=0; i<m_NumResults; i++)
+      pResults[i] = m_pResults[i];
+    delete [] m_pResults;
+    m_pResults = pResults;
+    m_ResultsCapacity = capacity;
+  }
+  m_pResults[m_NumResults++] = result;
+  return 0;
+}
+
+const char * InterpolationSweep::GetMethodName(const SweepResult & result)
+{
+  if (result.interpolationType == SQUAD)
+    return "squad-quaternion";
+  if (result.interpolationType == LINEAR)
+    return (result.angleRepresentation == EULER) ? "linear-euler" : "linear-quaternion";
+  return (result.angleRepresentation == EULER) ? "bezier-euler" : "bezier-quaternion";
+}
+
+int InterpolationSweep::WriteCSV(const char * filename)
+{
+  FILE * file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+
+  fprintf(file, "method,N,keyframes,time");
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    const char * name = MotionMetrics::GetMetricName((MotionMetric)metric);
+    fprintf(file, ",%s_mean,%s_rms,%s_max,%s_p95", name, name, name, name);
+  }
+  fprintf(file, "\n");
+
+  for(int i=0; i<m_NumResults; i++)
+  {
+    const SweepResult & result = m_pResults[i];
+    fprintf(file, "%s,%d,%d,%.9g", GetMethodName(result), result.N, result.numKeyframes, result.time);
+    for(int metric=0; metric<NUM_METRICS; metric++)
+      fprintf(file, ",%.9g,%.9g,%.9g,%.9g", result.errors[metric].mean, result.errors[metric].rms,
+        result.errors[metric].max, result.errors[metric].percentile95);
+    fprintf(file, "\n");
+  }
+
+  int failed = ferror(file);
+  fclose(file);
+  if (failed)
+  {
+    printf("Error: failed to write %s.\n", filename);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+/*
+interpolationSweep.h
+
+Parameter sweep over the interpolation methods and keyframe strides of one motion.
+
+For each combination of interpolation type and angle representation (linear / Bezier with Euler
+angles and quaternions, and SQUAD), and each N of a range, the input motion is interpolated from
+every (N+1)th frame, the interpolation is timed, and the interpolated motion is compared with the
+input motion (see motionMetrics.h). The input motion is parsed once by the caller; all runs write
+into the same output motion, and the metric buffers are reused.
+
+Usage:
+  InterpolationSweep sweep(pInputMotion);
+  sweep.SetThreadPool(&threadPool); // optional
+  sweep.Run(1, 20, 1);
+  for(int i=0; i<sweep.GetNumResults(); i++)
+    printf("%s %d: %f s\n", InterpolationSweep::GetMethodName(sweep.GetResult(i)), sweep.GetResult(i).N, sweep.GetResult(i).time);
+  sweep.WriteCSV("sweep.csv");
+*/
+
+#ifndef _INTERPOLATIONSWEEP_H_
+#define _INTERPOLATIONSWEEP_H_
+
+#include "interpolator.h"
+#include "motionMetrics.h"
+
+struct SweepResult
+{
+  InterpolationType interpolationType;
+  AngleRepresentation angleRepresentation;
+  int N;
+  int numKeyframes; // frames 0, N+1, 2(N+1), ... of the input motion
+  double time; // interpolation time in seconds (the minimum over the repetitions)
+  MetricStatistics errors[NUM_METRICS]; // errors of the interpolated motion (total statistics)
+};
+
+class InterpolationSweep
+{
+public:
+  // the input motion (and its skeleton, with all rotational DOFs enabled) must outlive the sweep
+  InterpolationSweep(Motion * pInputMotion);
+  ~InterpolationSweep();
+
+  // interpolate and compare the frames in parallel with the threads of the pool (NULL = serial; the default)
+  void SetThreadPool(ThreadPool * pThreadPool);
+  // number of times each interpolation is timed (default: 1); the errors are computed once
+  void SetRepetitions(int repetitions) { m_Repetitions = (repetitions > 0) ? repetitions : 1; }
+
+  // runs all methods for N = firstN, firstN + stepN, ..., lastN, method by method (the results are appended)
+  // returns the number of runs, and -1 on an invalid range or a failed run (an error message is printed)
+  int Run(int firstN, int lastN, int stepN = 1);
+  // a single run; returns 0 on success, and -1 otherwise
+  int Run(InterpolationType interpolationType, AngleRepresentation angleRepresentation, int N);
+
+  int GetNumResults() { return m_NumResults; }
+  const SweepResult & GetResult(int index) { return m_pResults[index]; }
+  void ClearResults() { m_NumResults = 0; }
+
+  // "linear-euler", "bezier-quaternion", "squad-quaternion", ...
+  static const char * GetMethodName(const SweepResult & result);
+
+  // CSV, one line per run: method, N, keyframes, time, and mean, rms, max, p95 of each metric
+  // returns 0 on success, and -1 otherwise
+  int WriteCSV(const char * filename);
+
+protected:
+  Motion * m_pInputMotion;
+  Motion * m_pOutputMotion; // reused by all runs
+  Interpolator m_Interpolator;
+  MotionMetrics m_Metrics;
+  int m_Repetitions;
+
+  SweepResult * m_pResults;
+  int m_NumResults, m_ResultsCapacity;
+};
+
+#endif
+
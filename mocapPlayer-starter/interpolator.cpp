@@ -5,9 +5,8 @@
 #include "motion.h"
 #include "interpolator.h"
 #include "types.h"
-#include <fstream>
-#include <time.h>
-using namespace std;
+#include "threadPool.h"
+#include "quaternionBatch.h"
 
 Interpolator::Interpolator()
 {
@@ -16,10 +15,23 @@ Interpolator::Interpolator()
 
   //set default angle representation to use for interpolation
   m_AngleRepresentation = EULER;
+
+  //interpolate serially by default
+  m_pThreadPool = NULL;
+
+  m_pKeyframeQuaternions = NULL;
+  m_pControlPoints = NULL;
+  m_pControlQuaternions = NULL;
+  m_pSlerpArcs = NULL;
+  m_KeyframeQuaternionsCapacity = m_ControlPointsCapacity = m_ControlQuaternionsCapacity = m_SlerpArcsCapacity = 0;
 }
 
 Interpolator::~Interpolator()
 {
+  delete [] m_pKeyframeQuaternions;
+  delete [] m_pControlPoints;
+  delete [] m_pControlQuaternions;
+  delete [] m_pSlerpArcs;
 }
 
 //Create interpolated motion
@@ -29,14 +41,36 @@ void Interpolator::Interpolate(Motion * pInputMotion, Motion ** pOutputMotion, i
   *pOutputMotion = new Motion(pInputMotion->GetNumFrames(), pInputMotion->GetSkeleton()); 
 
   //Perform the interpolation
+  InterpolateMotion(pInputMotion, *pOutputMotion, N);
+}
+
+int Interpolator::Interpolate(Motion * pInputMotion, Motion * pOutputMotion, int N)
+{
+  if ((pOutputMotion->GetNumFrames() != pInputMotion->GetNumFrames()) || (pOutputMotion->GetSkeleton() != pInputMotion->GetSkeleton()))
+  {
+    printf("Error in Interpolator::Interpolate: the output motion has %d frames (the input motion: %d), or a different skeleton.\n",
+      pOutputMotion->GetNumFrames(), pInputMotion->GetNumFrames());
+    return -1;
+  }
+
+  //The output motion is not set to the default postures first: the keyframes are copied, and the interpolated frames
+  //receive the root position, the rotations of the active bones, and zero bone translations (see ClearBoneTranslations)
+  InterpolateMotion(pInputMotion, pOutputMotion, N);
+  return 0;
+}
+
+void Interpolator::InterpolateMotion(Motion * pInputMotion, Motion * pOutputMotion, int N)
+{
   if ((m_InterpolationType == LINEAR) && (m_AngleRepresentation == EULER))
-    LinearInterpolationEuler(pInputMotion, *pOutputMotion, N);
+    LinearInterpolationEuler(pInputMotion, pOutputMotion, N);
   else if ((m_InterpolationType == LINEAR) && (m_AngleRepresentation == QUATERNION))
-    LinearInterpolationQuaternion(pInputMotion, *pOutputMotion, N);
+    LinearInterpolationQuaternion(pInputMotion, pOutputMotion, N);
   else if ((m_InterpolationType == BEZIER) && (m_AngleRepresentation == EULER))
-    BezierInterpolationEuler(pInputMotion, *pOutputMotion, N);
+    BezierInterpolationEuler(pInputMotion, pOutputMotion, N);
   else if ((m_InterpolationType == BEZIER) && (m_AngleRepresentation == QUATERNION))
-    BezierInterpolationQuaternion(pInputMotion, *pOutputMotion, N);
+    BezierInterpolationQuaternion(pInputMotion, pOutputMotion, N);
+  else if ((m_InterpolationType == SQUAD) && (m_AngleRepresentation == QUATERNION))
+    SquadInterpolationQuaternion(pInputMotion, pOutputMotion, N);
   else
   {
     printf("Error: unknown interpolation / angle representation type.\n");
@@ -44,63 +78,337 @@ void Interpolator::Interpolate(Motion * pInputMotion, Motion ** pOutputMotion, i
   }
 }
 
+int Interpolator::GetNumSegments(int inputLength, int N)
+{
+  // segment i interpolates between keyframes i*(N+1) and (i+1)*(N+1), which must be < inputLength
+  if (inputLength < 1)
+    return 0;
+  return (inputLength - 1) / (N + 1);
+}
+
+void Interpolator::PrepareSegments(Motion * pInputMotion, Motion * pOutputMotion)
+{
+  // the segments access the postures directly (and possibly from several threads)
+  pInputMotion->UpdatePostures();
+  pOutputMotion->UpdatePostures();
+}
+
+void Interpolator::ForEachSegment(int numSegments, const std::function<void(int)> & segment)
+{
+  if (m_pThreadPool != NULL)
+    m_pThreadPool->ParallelFor(numSegments, segment);
+  else
+  {
+    for(int i = 0; i < numSegments; i++)
+      segment(i);
+  }
+}
+
+void Interpolator::FinishSegments(Motion * pInputMotion, Motion * pOutputMotion, int lastKeyframe)
+{
+  // copy the last keyframe, and the frames after it (not enough frames left for another segment)
+  for(int frame=lastKeyframe; frame<pInputMotion->GetNumFrames(); frame++)
+    *pOutputMotion->GetPosture(frame) = *(pInputMotion->GetPosture(frame));
+  pOutputMotion->PosturesModified();
+}
+
+// grows buffer to at least size elements (the contents are not preserved)
+template<class T> static void ReserveBuffer(T * & buffer, int & capacity, int size)
+{
+  if (size <= capacity)
+    return;
+  delete [] buffer;
+  buffer = new T[size];
+  capacity = size;
+}
+
+// quaternion k of a set of count quaternions in structure-of-arrays layout (see quaternionBatch.h)
+static inline Quaternion<double> GetQuaternion(const double * data, int count, int k)
+{
+  return Quaternion<double>(data[k], data[count + k], data[2 * count + k], data[3 * count + k]);
+}
+
+static inline void SetQuaternion(double * data, int count, int k, const Quaternion<double> & q)
+{
+  data[k] = q.Gets();
+  data[count + k] = q.Getx();
+  data[2 * count + k] = q.Gety();
+  data[3 * count + k] = q.Getz();
+}
+
+// sets the Euler angles of the rotational DOFs that the bone does not have to 0
+// (the conversion from quaternions may leave round-off noise in them)
+static inline void ApplyRotationalDOFMask(int mask, double angles[3])
+{
+  if (!(mask & DOF_RX))
+    angles[0] = 0.0;
+  if (!(mask & DOF_RY))
+    angles[1] = 0.0;
+  if (!(mask & DOF_RZ))
+    angles[2] = 0.0;
+}
+
+void Interpolator::GetActiveBoneRotations(const Skeleton * pSkeleton, const Posture & posture, double * const angles[3])
+{
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  for (int k = 0; k < numActiveBones; k++)
+    for(int i=0; i<3; i++)
+      angles[i][k] = posture.bone_rotation[activeBones[k]].p[i];
+}
+
+void Interpolator::SetActiveBoneRotations(const Skeleton * pSkeleton, const double * const angles[3], Posture & posture)
+{
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  for (int k = 0; k < numActiveBones; k++)
+  {
+    int bone = activeBones[k];
+    for(int i=0; i<3; i++)
+      posture.bone_rotation[bone].p[i] = angles[i][k];
+    ApplyRotationalDOFMask(pSkeleton->getRotationalDOFMask(bone), posture.bone_rotation[bone].p);
+  }
+}
+
+void Interpolator::ClearBoneTranslations(const Skeleton * pSkeleton, Posture & posture)
+{
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  const Bone * bones = pSkeleton->getRoot();
+  for (int k = 0; k < numActiveBones; k++)
+  {
+    int bone = activeBones[k];
+    if (bones[bone].doftx || bones[bone].dofty || bones[bone].doftz)
+      posture.bone_translation[bone].setValue(0.0, 0.0, 0.0);
+    if (bones[bone].doftl)
+      posture.bone_length[bone].setValue(0.0, 0.0, 0.0);
+  }
+}
+
+void Interpolator::ComputeKeyframeQuaternions(Motion * pInputMotion, int N, int numKeyframes)
+{
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  ReserveBuffer(m_pKeyframeQuaternions, m_KeyframeQuaternionsCapacity, numKeyframes * numActiveBones * 4);
+
+  ForEachSegment(numKeyframes, [&](int keyframe)
+  {
+    double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+    GetActiveBoneRotations(pSkeleton, *pInputMotion->GetPosture(keyframe * (N+1)), angles);
+
+    double * q[4];
+    GetQuaternionArrays(&m_pKeyframeQuaternions[keyframe * numActiveBones * 4], numActiveBones, q);
+    EulerToQuaternionBatch(numActiveBones, angles, q);
+  });
+}
+
+// log(q) = (0, angle * axis) of the unit quaternion q = (cos(angle), sin(angle) * axis)
+static Quaternion<double> QuaternionLog(const Quaternion<double> & q)
+{
+  double sinAngle = sqrt(q.Getx() * q.Getx() + q.Gety() * q.Gety() + q.Getz() * q.Getz());
+  double scale = (sinAngle > 1e-12) ? atan2(sinAngle, q.Gets()) / sinAngle : 1.0;
+  return Quaternion<double>(0.0, scale * q.Getx(), scale * q.Gety(), scale * q.Getz());
+}
+
+// exp(v) = (cos(angle), sin(angle) * axis) for the pure quaternion v = (0, angle * axis)
+static Quaternion<double> QuaternionExp(const Quaternion<double> & v)
+{
+  double angle = sqrt(v.Getx() * v.Getx() + v.Gety() * v.Gety() + v.Getz() * v.Getz());
+  double scale = (angle > 1e-12) ? sin(angle) / angle : 1.0;
+  return Quaternion<double>(cos(angle), scale * v.Getx(), scale * v.Gety(), scale * v.Getz());
+}
+
+void Interpolator::ComputeSquadControlPoints(const double * keyframeQuaternions, int numKeyframes, int numActiveBones, double * controlQuaternions)
+{
+  // per keyframe: the keyframe quaternions, with their signs chosen such that consecutive keyframes are on the same 
+  // hemisphere, and the SQUAD control points s (structure-of-arrays layout)
+  int blockSize = 2 * 4 * numActiveBones;
+
+  for(int keyframe=0; keyframe<numKeyframes; keyframe++)
+  {
+    double * q = &controlQuaternions[keyframe * blockSize];
+    memcpy(q, &keyframeQuaternions[keyframe * numActiveBones * 4], sizeof(double) * numActiveBones * 4);
+    if (keyframe == 0)
+      continue;
+    const double * previous = q - blockSize;
+    for (int k = 0; k < numActiveBones; k++)
+    {
+      double dot = 0.0;
+      for(int i=0; i<4; i++)
+        dot += previous[i * numActiveBones + k] * q[i * numActiveBones + k];
+      if (dot < 0.0)
+      {
+        for(int i=0; i<4; i++)
+          q[i * numActiveBones + k] = -q[i * numActiveBones + k];
+      }
+    }
+  }
+
+  // s_i = q_i exp(-(log(q_i^-1 q_i+1) + log(q_i^-1 q_i-1)) / 4); s = q at the first and the last keyframe
+  ForEachSegment(numKeyframes, [&](int keyframe)
+  {
+    const double * q = &controlQuaternions[keyframe * blockSize];
+    double * controlPoints = &controlQuaternions[keyframe * blockSize + 4 * numActiveBones];
+    for (int k = 0; k < numActiveBones; k++)
+    {
+      Quaternion<double> current = GetQuaternion(q, numActiveBones, k);
+      current.Normalize();
+      if ((keyframe == 0) || (keyframe == numKeyframes - 1))
+      {
+        SetQuaternion(controlPoints, numActiveBones, k, current);
+        continue;
+      }
+      Quaternion<double> previous = GetQuaternion(q - blockSize, numActiveBones, k);
+      Quaternion<double> next = GetQuaternion(q + blockSize, numActiveBones, k);
+      previous.Normalize();
+      next.Normalize();
+      Quaternion<double> inverse = current.conj();
+      Quaternion<double> tangent = QuaternionLog(inverse * next) + QuaternionLog(inverse * previous);
+      SetQuaternion(controlPoints, numActiveBones, k, current * QuaternionExp(-0.25 * tangent));
+    }
+  });
+}
+
+void Interpolator::ComputeEulerControlPoints(vector p0, vector p1, vector p2, vector p3, int hasPrevious, int hasNext, vector & an, vector & bn)
+{
+  vector middle, an_hat1, an_hat2;
+  if (!hasPrevious && !hasNext)
+  {
+    // single segment: no neighbouring keyframes
+    an = p1*(1.0-1.0/3)+p2*(1.0/3);
+  }
+  else if (!hasPrevious)
+  {
+    middle = p2*2.0-p3;
+    an = p1*(1.0-1.0/3)+middle*(1.0/3);
+  }
+  else
+  {
+    middle = p1*2.0-p0;
+    an_hat1 = middle*0.5+p2*0.5;
+    an = p1*(1.0-1.0/3)+an_hat1*(1.0/3);
+  }
+
+  if (!hasNext)
+  {
+    middle = p1*2.0-p0;
+    bn = p2*(1.0-1.0/3)+middle*(1.0/3);
+  }
+  else
+  {
+    middle = p2*2.0-p1;
+    an_hat2 = middle*0.5+p3*0.5;
+    bn = p2*(1.0+1.0/3)-an_hat2*(1.0/3);
+  }
+}
+
+void Interpolator::ComputeQuaternionControlPoints(Quaternion<double> q0, Quaternion<double> q1, Quaternion<double> q2, Quaternion<double> q3, 
+  int hasPrevious, int hasNext, Quaternion<double> controlPoints[4])
+{
+  // note: Slerp normalizes its arguments, and may negate its second argument
+  Quaternion<double> middle, an_hat1, an_hat2, an_, an, bn;
+  if (!hasPrevious && !hasNext)
+    an = Slerp(1.0/3,q1,q2);
+  else if (!hasPrevious)
+  {
+    middle = Slerp(2.0,q3,q2);
+    an = Slerp(1.0/3,q1,middle);
+  }
+  else
+  {
+    middle = Slerp(2.0,q0,q1);
+    an_hat1 = Slerp(0.5,middle,q2);
+    an = Slerp(1.0/3,q1,an_hat1);
+  }
+
+  if (!hasNext)
+  {
+    middle = Slerp(2.0,q0,q1);
+    bn = Slerp(1.0/3,q2,middle);
+  }
+  else
+  {
+    middle = Slerp(2.0,q1,q2);
+    an_hat2 = Slerp(0.5,middle,q3);
+    an_ = Slerp(1.0/3,q2,middle);
+    bn = Slerp(-1.0/3,q2,an_hat2);
+  }
+
+  controlPoints[0] = q1;
+  controlPoints[1] = an;
+  controlPoints[2] = bn;
+  controlPoints[3] = q2;
+}
+
+void Interpolator::ComputeBezierForwardDifferences(const vector & p0, const vector & p1, const vector & p2, const vector & p3, double h, vector differences[4])
+{
+  double h2 = h * h, h3 = h2 * h;
+  for(int i=0; i<3; i++)
+  {
+    // power basis: B(t) = a t^3 + b t^2 + c t + d
+    double a = p3.p[i] - p0.p[i] + 3.0 * (p1.p[i] - p2.p[i]);
+    double b = 3.0 * (p0.p[i] - 2.0 * p1.p[i] + p2.p[i]);
+    double c = 3.0 * (p1.p[i] - p0.p[i]);
+    differences[0].p[i] = p0.p[i];
+    differences[1].p[i] = a * h3 + b * h2 + c * h;
+    differences[2].p[i] = 6.0 * a * h3 + 2.0 * b * h2;
+    differences[3].p[i] = 6.0 * a * h3;
+  }
+}
+
+void Interpolator::StepForwardDifferences(vector differences[4], vector & value)
+{
+  for(int i=0; i<3; i++)
+  {
+    differences[0].p[i] += differences[1].p[i];
+    differences[1].p[i] += differences[2].p[i];
+    differences[2].p[i] += differences[3].p[i];
+    value.p[i] = differences[0].p[i];
+  }
+}
+
 void Interpolator::LinearInterpolationEuler(Motion * pInputMotion, Motion * pOutputMotion, int N)
 {
-//    ofstream graph1("graph1_le.txt");
-//    ofstream graph3("graph3_le.txt");
-      ofstream times("LinearEuler_time.txt");
-    clock_t  start=clock();
   int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
-
-  int startKeyframe = 0;
-  while (startKeyframe + N + 1 < inputLength)
+  // only the bones with degrees of freedom are interpolated (the others keep the default rotation 0)
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  int numSegments = GetNumSegments(inputLength, N);
+  PrepareSegments(pInputMotion, pOutputMotion);
+
+  ForEachSegment(numSegments, [&](int segment)
   {
+    int startKeyframe = segment * (N+1);
     int endKeyframe = startKeyframe + N + 1;
 
     Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
     Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
 
-    // copy start and end keyframe
-    pOutputMotion->SetPosture(startKeyframe, *startPosture);
-    pOutputMotion->SetPosture(endKeyframe, *endPosture);
+    // copy start keyframe (the end keyframe is copied by the next segment)
+    *pOutputMotion->GetPosture(startKeyframe) = *startPosture;
 
     // interpolate in between
     for(int frame=1; frame<=N; frame++)
     {
-      Posture interpolatedPosture;
       double t = 1.0 * frame / (N+1);
+      Posture & interpolatedPosture = *pOutputMotion->GetPosture(startKeyframe + frame);
+      ClearBoneTranslations(pSkeleton, interpolatedPosture);
 
       // interpolate root position
       interpolatedPosture.root_pos = startPosture->root_pos * (1-t) + endPosture->root_pos * t;
 
       // interpolate bone rotations
-      for (int bone = 0; bone < MAX_BONES_IN_ASF_FILE; bone++)
+      for (int k = 0; k < numActiveBones; k++)
+      {
+        int bone = activeBones[k];
         interpolatedPosture.bone_rotation[bone] = startPosture->bone_rotation[bone] * (1-t) + endPosture->bone_rotation[bone] * t;
-
-      pOutputMotion->SetPosture(startKeyframe + frame, interpolatedPosture);
+      }
     }
+  });
 
-    startKeyframe = endKeyframe;
-  }
-
-  for(int frame=startKeyframe+1; frame<inputLength; frame++)
-    pOutputMotion->SetPosture(frame, *(pInputMotion->GetPosture(frame)));
-    clock_t end=clock();
-    times<<end-start<<endl;
-
-//    for(int i=600;i<=800;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph1<<g1->bone_rotation[2].p[0]<<endl;
-//
-//    }
-//    for(int i=200;i<=500;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph3<<g1->bone_rotation[0].p[2]<<endl;
-//    }
+  FinishSegments(pInputMotion, pOutputMotion, numSegments * (N+1));
 }
 
 void Interpolator::Rotation2Euler(double R[9], double angles[3])
@@ -142,395 +450,347 @@ void Interpolator::Euler2Rotation(double angles[3], double R[9])
 void Interpolator::BezierInterpolationEuler(Motion * pInputMotion, Motion * pOutputMotion, int N)
 {
   // students should implement this
-//    ofstream graph1_("graph1_be.txt");
-//    ofstream graph1("graph1_input.txt");
-//    ofstream graph3_("graph3_be.txt");
-//    ofstream graph3("graph3_input.txt");
-    ofstream times("BezierEuler_time.txt");
-    clock_t start=clock();
-    int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
-    int startKeyframe = 0;
-    int previousKeyframe = 0;
-
-    while (startKeyframe + N + 1 < inputLength)
+  int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
+  // only the bones with degrees of freedom are interpolated (the others keep the default rotation 0)
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  const int * activeBones = pSkeleton->getActiveBones();
+  int numSegments = GetNumSegments(inputLength, N);
+  PrepareSegments(pInputMotion, pOutputMotion);
+
+  // forward differences of the Bezier curves of each segment, for the root position (index 0) and the bone rotations (1 + k)
+  int numCurves = 1 + numActiveBones;
+  ReserveBuffer(m_pControlPoints, m_ControlPointsCapacity, numSegments * numCurves * 4);
+
+  ForEachSegment(numSegments, [&](int segment)
+  {
+    int startKeyframe = segment * (N+1);
+    int endKeyframe = startKeyframe + N + 1;
+    int previousKeyframe = (segment == 0) ? 0 : startKeyframe - (N+1);
+    int thirdKeyframe = startKeyframe + 2 * N + 2;
+    int hasPreviousKeyframe = (segment > 0);
+    int hasThirdKeyframe = (thirdKeyframe < inputLength);
+
+    Posture * previousPosture = pInputMotion->GetPosture(previousKeyframe);
+    Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
+    Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
+    Posture * thirdPosture = pInputMotion->GetPosture(hasThirdKeyframe ? thirdKeyframe : endKeyframe); // not used if there is no third keyframe
+
+    // compute the control points once per segment, and the forward differences of the curves at t = 0, 1/(N+1), ...
+    double h = 1.0 / (N+1);
+    vector an, bn;
+    vector * differences = &m_pControlPoints[segment * numCurves * 4];
+    ComputeEulerControlPoints(previousPosture->root_pos, startPosture->root_pos, endPosture->root_pos, thirdPosture->root_pos, 
+      hasPreviousKeyframe, hasThirdKeyframe, an, bn);
+    ComputeBezierForwardDifferences(startPosture->root_pos, an, bn, endPosture->root_pos, h, &differences[0]);
+    for (int k = 0; k < numActiveBones; k++)
     {
-        int endKeyframe = startKeyframe + N + 1;
-        int thirdKeyframe = startKeyframe + 2 * N + 2;
-
-        Posture * previousPosture = pInputMotion->GetPosture(previousKeyframe);
-        Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
-        Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
-        Posture * thirdPosture;
-        if(thirdKeyframe<inputLength)thirdPosture = pInputMotion->GetPosture(thirdKeyframe);
-
-        // copy start and end keyframe
-        pOutputMotion->SetPosture(startKeyframe, *startPosture);
-        pOutputMotion->SetPosture(endKeyframe, *endPosture);
-
-        // interpolate in between
-        for(int frame=1; frame<=N; frame++)
-        {
-            Posture interpolatedPosture;
-            double t = 1.0 * frame / (N+1);
-
-           // interpolate root position
-            vector an_root,bn_root,middle_root,an_hat1_root,an_hat2_root;
-            vector previousRoot=previousPosture->root_pos;
-            vector startRoot=startPosture->root_pos;
-            vector endRoot=endPosture->root_pos;
-            vector thirdRoot;
-            if(thirdKeyframe<inputLength)thirdRoot=thirdPosture->root_pos;
-            if(startKeyframe==0)
-            {
-                middle_root=endRoot*2-thirdRoot;
-                an_root=startRoot*(1.0-1.0/3)+middle_root*(1.0/3);
-            }
-            else
-            {
-                middle_root=startRoot*2-previousRoot;
-                an_hat1_root=middle_root*0.5+endRoot*0.5;
-                an_root=startRoot*(1.0-1.0/3)+an_hat1_root*(1.0/3);
-            }
-            if(thirdKeyframe>inputLength)
-            {
-                middle_root=startRoot*2-previousRoot;
-                bn_root=endRoot*(1.0-1.0/3)+middle_root*(1.0/3);
-            }
-            else
-            {
-                middle_root=endRoot*2.0-startRoot;
-                an_hat2_root=middle_root*0.5+thirdRoot*0.5;
-                bn_root=endRoot*(1+1.0/3)-an_hat2_root*(1.0/3);
-            }
-            interpolatedPosture.root_pos = DeCasteljauEuler(t,startRoot,an_root,bn_root,endRoot);
-            // interpolate bone rotations
-            for (int bone = 0; bone < MAX_BONES_IN_ASF_FILE; bone++)
-            {
-
-                vector angles0,angles1,angles2,angles3,angles;
-                vector middle,an_hat1,an_hat2,an,bn_,an_;
-                angles0=(previousPosture->bone_rotation)[bone];
-                angles1=(startPosture->bone_rotation)[bone];
-                angles2=(endPosture->bone_rotation)[bone];
-
-                if(thirdKeyframe<inputLength)
-                {
-                    angles3 = (thirdPosture->bone_rotation)[bone];
-                }
-                //calculate an,bn_
-                if(startKeyframe==0)
-                {
-                    middle=angles2*2.0-angles3;
-                    an=angles1*(1.0-1.0/3)+middle*(1.0/3);
-                }
-                else
-                {
-                    middle = angles1*2.0-angles0;
-                    an_hat1=middle*0.5+angles2*0.5;
-                    an=angles1*(1.0-1.0/3)+an_hat1*(1.0/3);
-                }
-                if(thirdKeyframe>inputLength)
-                {
-                    middle = angles1*2.0-angles0;
-                    bn_=angles2*(1.0-1.0/3)+middle*(1.0/3);
-                }
-                else
-                {
-                    middle=angles2*2.0-angles1;
-                    an_hat2=middle*0.5+angles3*0.5;
-                    bn_=angles2*(1.0+1.0/3)-an_hat2*(1.0/3);
-                }
-                angles=DeCasteljauEuler(t,angles1,an,bn_,angles2);
-
-                interpolatedPosture.bone_rotation[bone]=angles;
-            }
-
-            pOutputMotion->SetPosture(startKeyframe + frame, interpolatedPosture);
-        }
-            previousKeyframe = startKeyframe;
-            startKeyframe = endKeyframe;
-        }
-        for(int frame=startKeyframe+1; frame<inputLength; frame++)
-         pOutputMotion->SetPosture(frame, *(pInputMotion->GetPosture(frame)));
-        clock_t end=clock();
-        times<<end-start<<endl;
-//    for(int i=600;i<=800;i++)
-//    {
-//        Posture* g1;
-//        Posture* g2;
-//        g1=pInputMotion->GetPosture(i);
-//        g2=pOutputMotion->GetPosture(i);
-//        graph1<<g1->bone_rotation[2].p[0]<<endl;
-//        graph1_<<g2->bone_rotation[2].p[0]<<endl;
-//    }
-//    for(int i=200;i<=500;i++)
-//    {
-//        Posture* g1;
-//        Posture* g2;
-//        g1=pInputMotion->GetPosture(i);
-//        g2=pOutputMotion->GetPosture(i);
-//        graph3<<g1->bone_rotation[0].p[2]<<endl;
-//        graph3_<<g2->bone_rotation[0].p[2]<<endl;
-//    }
+      int bone = activeBones[k];
+      ComputeEulerControlPoints(previousPosture->bone_rotation[bone], startPosture->bone_rotation[bone], endPosture->bone_rotation[bone], 
+        thirdPosture->bone_rotation[bone], hasPreviousKeyframe, hasThirdKeyframe, an, bn);
+      ComputeBezierForwardDifferences(startPosture->bone_rotation[bone], an, bn, endPosture->bone_rotation[bone], h, &differences[4 + 4 * k]);
+    }
+
+    // copy start keyframe (the end keyframe is copied by the next segment)
+    *pOutputMotion->GetPosture(startKeyframe) = *startPosture;
+
+    // interpolate in between
+    for(int frame=1; frame<=N; frame++)
+    {
+      Posture & interpolatedPosture = *pOutputMotion->GetPosture(startKeyframe + frame);
+      ClearBoneTranslations(pSkeleton, interpolatedPosture);
+
+      // interpolate root position
+      StepForwardDifferences(&differences[0], interpolatedPosture.root_pos);
+
+      // interpolate bone rotations
+      for (int k = 0; k < numActiveBones; k++)
+        StepForwardDifferences(&differences[4 + 4 * k], interpolatedPosture.bone_rotation[activeBones[k]]);
+    }
+  });
+
+  FinishSegments(pInputMotion, pOutputMotion, numSegments * (N+1));
 }
 
 
 void Interpolator::LinearInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N)
 {
   // students should implement this
-//    ofstream graph1("graph1_lq.txt");
-//    ofstream graph3("graph3_lq.txt");
-    ofstream times("LinearQuaternion_time.txt");
-    clock_t start=clock();
-    int inputLength=pInputMotion->GetNumFrames();
-    int startKeyframe = 0;
-    while (startKeyframe + N + 1 < inputLength)
+  int inputLength=pInputMotion->GetNumFrames();
+  // only the bones with degrees of freedom are interpolated (the others keep the default rotation 0)
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  int numSegments = GetNumSegments(inputLength, N);
+  PrepareSegments(pInputMotion, pOutputMotion);
+
+  // convert the keyframes to quaternions once (there is no keyframe if the motion is empty)
+  int numKeyframes = (inputLength > 0) ? numSegments + 1 : 0;
+  ComputeKeyframeQuaternions(pInputMotion, N, numKeyframes);
+
+  ForEachSegment(numSegments, [&](int segment)
   {
+    int startKeyframe = segment * (N+1);
     int endKeyframe = startKeyframe + N + 1;
 
     Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
     Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
+    double * startQuaternions[4], * endQuaternions[4], * interpolatedQuaternions[4];
+    GetQuaternionArrays(&m_pKeyframeQuaternions[segment * numActiveBones * 4], numActiveBones, startQuaternions);
+    GetQuaternionArrays(&m_pKeyframeQuaternions[(segment + 1) * numActiveBones * 4], numActiveBones, endQuaternions);
+    double interpolatedBuffer[4 * MAX_BONES_IN_ASF_FILE], anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+    GetQuaternionArrays(interpolatedBuffer, numActiveBones, interpolatedQuaternions);
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
 
-    // copy start and end keyframe
-    pOutputMotion->SetPosture(startKeyframe, *startPosture);
-    pOutputMotion->SetPosture(endKeyframe, *endPosture);
+    // copy start keyframe (the end keyframe is copied by the next segment)
+    *pOutputMotion->GetPosture(startKeyframe) = *startPosture;
 
     // interpolate in between
     for(int frame=1; frame<=N; frame++)
     {
-      Posture interpolatedPosture;
       double t = 1.0 * frame / (N+1);
+      Posture & interpolatedPosture = *pOutputMotion->GetPosture(startKeyframe + frame);
+      ClearBoneTranslations(pSkeleton, interpolatedPosture);
 
       // interpolate root position
       interpolatedPosture.root_pos = startPosture->root_pos * (1-t) + endPosture->root_pos * t;
 
-      // interpolate bone rotations
-      for (int bone = 0; bone < MAX_BONES_IN_ASF_FILE; bone++)
-      {
-        Quaternion<double> bone_rotate1;
-        Quaternion<double> bone_rotate2;
-        Quaternion<double> bone_con;
-        double angles1[3];
-        double angles2[3];
-        double angles[3];
-        angles1[0]=((startPosture->bone_rotation)[bone]).p[0];
-        angles1[1]=((startPosture->bone_rotation)[bone]).p[1];
-        angles1[2]=((startPosture->bone_rotation)[bone]).p[2];
-        Euler2Quaternion(angles1, bone_rotate1);
-        
-        angles2[0]=((endPosture->bone_rotation)[bone]).p[0];
-        angles2[1]=((endPosture->bone_rotation)[bone]).p[1];
-        angles2[2]=((endPosture->bone_rotation)[bone]).p[2];
-
-        Euler2Quaternion(angles2, bone_rotate2);
-          bone_con=Slerp(t,bone_rotate1,bone_rotate2);
-          bone_con.Normalize();
-        Quaternion2Euler(bone_con,angles);
-
-        interpolatedPosture.bone_rotation[bone].p[0]=angles[0];
-        interpolatedPosture.bone_rotation[bone].p[1]=angles[1];
-        interpolatedPosture.bone_rotation[bone].p[2]=angles[2];
-
-      }
-      pOutputMotion->SetPosture(startKeyframe + frame, interpolatedPosture);
+      // interpolate bone rotations (all bones at once)
+      SlerpBatch(numActiveBones, &t, 0, startQuaternions, endQuaternions, interpolatedQuaternions);
+      QuaternionToEulerBatch(numActiveBones, interpolatedQuaternions, angles);
+      SetActiveBoneRotations(pSkeleton, angles, interpolatedPosture);
     }
+  });
 
-    startKeyframe = endKeyframe;
-  }
+  FinishSegments(pInputMotion, pOutputMotion, numSegments * (N+1));
 
-  for(int frame=startKeyframe+1; frame<inputLength; frame++)
-    pOutputMotion->SetPosture(frame, *(pInputMotion->GetPosture(frame)));
-
-//    for(int i=600;i<=800;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph1<<g1->bone_rotation[2].p[0]<<endl;
-//
-//    }
-//    for(int i=200;i<=500;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph3<<g1->bone_rotation[0].p[2]<<endl;
-//    }
-    clock_t end=clock();
-    times<<end-start<<endl;
 }
 
 void Interpolator::BezierInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N)
 {
-//    ofstream graph1("graph1_bq.txt");
-//    ofstream graph3("graph3_bq.txt");
-    ofstream times("BezierQuaternion.txt");
-    clock_t start=clock();
-    int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
-    int startKeyframe = 0;
-    int previousKeyframe = 0;
+  int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
+  // only the bones with degrees of freedom are interpolated (the others keep the default rotation 0)
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  int numSegments = GetNumSegments(inputLength, N);
+  PrepareSegments(pInputMotion, pOutputMotion);
+
+  // convert the keyframes to quaternions once (there is no keyframe if the motion is empty)
+  int numKeyframes = (inputLength > 0) ? numSegments + 1 : 0;
+  ComputeKeyframeQuaternions(pInputMotion, N, numKeyframes);
+
+  // control points of each segment: forward differences of the root position curve, and for each bone: start, a_n, b_n, end quaternion
+  ReserveBuffer(m_pControlPoints, m_ControlPointsCapacity, numSegments * 4);
+  ReserveBuffer(m_pControlQuaternions, m_ControlQuaternionsCapacity, numSegments * 4 * numActiveBones * 4);
+
+  ForEachSegment(numSegments, [&](int segment)
+  {
+    int startKeyframe = segment * (N+1);
+    int endKeyframe = startKeyframe + N + 1;
+    int previousKeyframe = (segment == 0) ? 0 : startKeyframe - (N+1);
+    int thirdKeyframe = startKeyframe + 2 * N + 2;
+    int hasPreviousKeyframe = (segment > 0);
+    int hasThirdKeyframe = (thirdKeyframe < inputLength);
+
+    Posture * previousPosture = pInputMotion->GetPosture(previousKeyframe);
+    Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
+    Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
+    Posture * thirdPosture = pInputMotion->GetPosture(hasThirdKeyframe ? thirdKeyframe : endKeyframe); // not used if there is no third keyframe
+
+    // keyframe quaternions (index previousKeyframe / (N+1), ...)
+    int previousIndex = hasPreviousKeyframe ? segment - 1 : 0;
+    int thirdIndex = hasThirdKeyframe ? segment + 2 : segment + 1;
+    const double * previousQuaternions = &m_pKeyframeQuaternions[previousIndex * numActiveBones * 4];
+    const double * startQuaternions = &m_pKeyframeQuaternions[segment * numActiveBones * 4];
+    const double * endQuaternions = &m_pKeyframeQuaternions[(segment + 1) * numActiveBones * 4];
+    const double * thirdQuaternions = &m_pKeyframeQuaternions[thirdIndex * numActiveBones * 4];
+
+    // compute the control points once per segment
+    vector an, bn;
+    vector * rootDifferences = &m_pControlPoints[segment * 4];
+    ComputeEulerControlPoints(previousPosture->root_pos, startPosture->root_pos, endPosture->root_pos, thirdPosture->root_pos, 
+      hasPreviousKeyframe, hasThirdKeyframe, an, bn);
+    ComputeBezierForwardDifferences(startPosture->root_pos, an, bn, endPosture->root_pos, 1.0 / (N+1), rootDifferences);
+    // control point i of all bones: controlQuaternions[i] (structure-of-arrays layout)
+    double * controlQuaternions[4][4];
+    for(int i=0; i<4; i++)
+      GetQuaternionArrays(&m_pControlQuaternions[(segment * 4 + i) * numActiveBones * 4], numActiveBones, controlQuaternions[i]);
+    for (int k = 0; k < numActiveBones; k++)
+    {
+      Quaternion<double> q[4];
+      ComputeQuaternionControlPoints(GetQuaternion(previousQuaternions, numActiveBones, k), GetQuaternion(startQuaternions, numActiveBones, k), 
+        GetQuaternion(endQuaternions, numActiveBones, k), GetQuaternion(thirdQuaternions, numActiveBones, k), hasPreviousKeyframe, hasThirdKeyframe, q);
+      for(int i=0; i<4; i++)
+        SetQuaternion(controlQuaternions[i][0], numActiveBones, k, q[i]);
+    }
+    double interpolatedBuffer[4 * MAX_BONES_IN_ASF_FILE], anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+    double * interpolatedQuaternions[4];
+    GetQuaternionArrays(interpolatedBuffer, numActiveBones, interpolatedQuaternions);
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+
+    // copy start keyframe (the end keyframe is copied by the next segment)
+    *pOutputMotion->GetPosture(startKeyframe) = *startPosture;
+
+    // interpolate in between
+    for(int frame=1; frame<=N; frame++)
+    {
+      double t = 1.0 * frame / (N+1);
+      Posture & interpolatedPosture = *pOutputMotion->GetPosture(startKeyframe + frame);
+      ClearBoneTranslations(pSkeleton, interpolatedPosture);
+
+      // interpolate root position
+      StepForwardDifferences(rootDifferences, interpolatedPosture.root_pos);
+
+      // interpolate bone rotations (all bones at once)
+      DeCasteljauQuaternionBatch(numActiveBones, &t, 0, controlQuaternions[0], controlQuaternions[1], 
+        controlQuaternions[2], controlQuaternions[3], interpolatedQuaternions);
+      QuaternionToEulerBatch(numActiveBones, interpolatedQuaternions, angles);
+      SetActiveBoneRotations(pSkeleton, angles, interpolatedPosture);
+    }
+  });
+
+  FinishSegments(pInputMotion, pOutputMotion, numSegments * (N+1));
+}
+
+void Interpolator::SquadInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N)
+{
+  int inputLength = pInputMotion->GetNumFrames(); // frames are indexed 0, ..., inputLength-1
+  // only the bones with degrees of freedom are interpolated (the others keep the default rotation 0)
+  const Skeleton * pSkeleton = pInputMotion->GetSkeleton();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  int numSegments = GetNumSegments(inputLength, N);
+  PrepareSegments(pInputMotion, pOutputMotion);
+
+  // convert the keyframes to quaternions, and compute the SQUAD control points once (there is no keyframe if the motion is empty)
+  int numKeyframes = (inputLength > 0) ? numSegments + 1 : 0;
+  ComputeKeyframeQuaternions(pInputMotion, N, numKeyframes);
+  int blockSize = 2 * 4 * numActiveBones;
+  ReserveBuffer(m_pControlQuaternions, m_ControlQuaternionsCapacity, numKeyframes * blockSize);
+  ComputeSquadControlPoints(m_pKeyframeQuaternions, numKeyframes, numActiveBones, m_pControlQuaternions);
+
+  // per segment: forward differences of the root position curve (Bezier, as in the other modes), and for all bones:
+  // the arcs from q_i to q_i+1 and from s_i to s_i+1
+  ReserveBuffer(m_pControlPoints, m_ControlPointsCapacity, numSegments * 4);
+  ReserveBuffer(m_pSlerpArcs, m_SlerpArcsCapacity, numSegments * 2 * 9 * numActiveBones);
+
+  ForEachSegment(numSegments, [&](int segment)
+  {
+    int startKeyframe = segment * (N+1);
+    int endKeyframe = startKeyframe + N + 1;
+    int previousKeyframe = (segment == 0) ? 0 : startKeyframe - (N+1);
+    int thirdKeyframe = startKeyframe + 2 * N + 2;
+    int hasPreviousKeyframe = (segment > 0);
+    int hasThirdKeyframe = (thirdKeyframe < inputLength);
 
-    while (startKeyframe + N + 1 < inputLength)
+    Posture * previousPosture = pInputMotion->GetPosture(previousKeyframe);
+    Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
+    Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
+    Posture * thirdPosture = pInputMotion->GetPosture(hasThirdKeyframe ? thirdKeyframe : endKeyframe); // not used if there is no third keyframe
+
+    vector an, bn;
+    vector * rootDifferences = &m_pControlPoints[segment * 4];
+    ComputeEulerControlPoints(previousPosture->root_pos, startPosture->root_pos, endPosture->root_pos, thirdPosture->root_pos, 
+      hasPreviousKeyframe, hasThirdKeyframe, an, bn);
+    ComputeBezierForwardDifferences(startPosture->root_pos, an, bn, endPosture->root_pos, 1.0 / (N+1), rootDifferences);
+
+    double * startQuaternions[4], * endQuaternions[4], * startControlPoints[4], * endControlPoints[4];
+    double * start = &m_pControlQuaternions[segment * blockSize];
+    GetQuaternionArrays(start, numActiveBones, startQuaternions);
+    GetQuaternionArrays(start + 4 * numActiveBones, numActiveBones, startControlPoints);
+    GetQuaternionArrays(start + blockSize, numActiveBones, endQuaternions);
+    GetQuaternionArrays(start + blockSize + 4 * numActiveBones, numActiveBones, endControlPoints);
+    double * keyframeArc[9], * controlPointArc[9];
+    GetSlerpArcArrays(&m_pSlerpArcs[segment * 2 * 9 * numActiveBones], numActiveBones, keyframeArc);
+    GetSlerpArcArrays(&m_pSlerpArcs[(segment * 2 + 1) * 9 * numActiveBones], numActiveBones, controlPointArc);
+    ComputeSlerpArcBatch(numActiveBones, startQuaternions, endQuaternions, keyframeArc);
+    ComputeSlerpArcBatch(numActiveBones, startControlPoints, endControlPoints, controlPointArc);
+
+    double buffer[3 * 4 * MAX_BONES_IN_ASF_FILE], anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+    double * keyframeSlerp[4], * controlPointSlerp[4], * interpolatedQuaternions[4];
+    GetQuaternionArrays(buffer, numActiveBones, keyframeSlerp);
+    GetQuaternionArrays(buffer + 4 * numActiveBones, numActiveBones, controlPointSlerp);
+    GetQuaternionArrays(buffer + 8 * numActiveBones, numActiveBones, interpolatedQuaternions);
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+
+    // copy start keyframe (the end keyframe is copied by the next segment)
+    *pOutputMotion->GetPosture(startKeyframe) = *startPosture;
+
+    // interpolate in between: Squad(t) = Slerp(2t(1-t), Slerp(t, q_i, q_i+1), Slerp(t, s_i, s_i+1))
+    for(int frame=1; frame<=N; frame++)
     {
-        int endKeyframe = startKeyframe + N + 1;
-        int thirdKeyframe = startKeyframe + 2 * N + 2;
-
-        Posture * previousPosture = pInputMotion->GetPosture(previousKeyframe);
-        Posture * startPosture = pInputMotion->GetPosture(startKeyframe);
-        Posture * endPosture = pInputMotion->GetPosture(endKeyframe);
-        Posture * thirdPosture;
-        if(thirdKeyframe<inputLength)thirdPosture = pInputMotion->GetPosture(thirdKeyframe);
-
-        // copy start and end keyframe
-        pOutputMotion->SetPosture(startKeyframe, *startPosture);
-        pOutputMotion->SetPosture(endKeyframe, *endPosture);
-
-        // interpolate in between
-        for(int frame=1; frame<=N; frame++)
-        {
-            Posture interpolatedPosture;
-            double t = 1.0 * frame / (N+1);
-
-
-            // interpolate root position
-            vector an_root,bn_root,middle_root,an_hat1_root,an_hat2_root;
-            vector previousRoot=previousPosture->root_pos;
-            vector startRoot=startPosture->root_pos;
-            vector endRoot=endPosture->root_pos;
-            vector thirdRoot;
-            if(thirdKeyframe<inputLength)thirdRoot=thirdPosture->root_pos;
-            if(startKeyframe==0)
-            {
-                middle_root=endRoot*2-thirdRoot;
-                an_root=startRoot*(1.0-1.0/3)+middle_root*(1.0/3);
-            }
-            else
-            {
-                middle_root=startRoot*2-previousRoot;
-                an_hat1_root=middle_root*0.5+endRoot*0.5;
-                an_root=startRoot*(1.0-1.0/3)+an_hat1_root*(1.0/3);
-            }
-            if(thirdKeyframe>inputLength)
-            {
-                middle_root=startRoot*2-previousRoot;
-                bn_root=endRoot*(1.0-1.0/3)+middle_root*(1.0/3);
-            }
-            else
-            {
-                middle_root=endRoot*2.0-startRoot;
-                an_hat2_root=middle_root*0.5+thirdRoot*0.5;
-                bn_root=endRoot*(1+1.0/3)-an_hat2_root*(1.0/3);
-            }
-            interpolatedPosture.root_pos = DeCasteljauEuler(t,startRoot,an_root,bn_root,endRoot);
-
-            // interpolate bone rotations
-            for (int bone = 0; bone < MAX_BONES_IN_ASF_FILE; bone++)
-            {
-                Quaternion<double> bone_rotate1;
-                Quaternion<double> bone_rotate2;
-                Quaternion<double> bone_rotate0;
-                Quaternion<double> bone_rotate3;
-                Quaternion<double> bone_con;
-                Quaternion<double> an,bn_;
-                double angles1[3];
-                double angles2[3];
-                double angles0[3];
-                double angles3[3];
-                double angles[3];
-
-                angles0[0]=((previousPosture->bone_rotation)[bone]).p[0];
-                angles0[1]=((previousPosture->bone_rotation)[bone]).p[1];
-                angles0[2]=((previousPosture->bone_rotation)[bone]).p[2];
-                Euler2Quaternion(angles0, bone_rotate0);
-
-                angles1[0]=((startPosture->bone_rotation)[bone]).p[0];
-                angles1[1]=((startPosture->bone_rotation)[bone]).p[1];
-                angles1[2]=((startPosture->bone_rotation)[bone]).p[2];
-                Euler2Quaternion(angles1, bone_rotate1);
-
-                angles2[0]=((endPosture->bone_rotation)[bone]).p[0];
-                angles2[1]=((endPosture->bone_rotation)[bone]).p[1];
-                angles2[2]=((endPosture->bone_rotation)[bone]).p[2];
-                Euler2Quaternion(angles2, bone_rotate2);
-
-                if(thirdKeyframe<inputLength)
-                {
-                    angles3[0] = ((thirdPosture->bone_rotation)[bone]).p[0];
-                    angles3[1] = ((thirdPosture->bone_rotation)[bone]).p[1];
-                    angles3[2] = ((thirdPosture->bone_rotation)[bone]).p[2];
-                    Euler2Quaternion(angles3, bone_rotate3);
-                }
-
-                //calculate an,bn_
-                Quaternion<double> middle;
-                Quaternion<double> an_hat1, an_hat2,an_;
-                if(startKeyframe==0)
-                {
-                    middle=Slerp(2.0,bone_rotate3,bone_rotate2);
-                    an=Slerp(1.0/3,bone_rotate1,middle);
-                }
-                else
-                {
-                    middle=Slerp(2.0,bone_rotate0,bone_rotate1);
-                    an_hat1=Slerp(0.5,middle,bone_rotate2);
-                    an=Slerp(1.0/3,bone_rotate1,an_hat1);
-                }
-                if(thirdKeyframe>inputLength)
-                {
-                    middle = Slerp(2.0,bone_rotate0,bone_rotate1);
-                    bn_=Slerp(1.0/3,bone_rotate2,middle);
-                }
-                else
-                {
-                    middle=Slerp(2.0,bone_rotate1,bone_rotate2);
-                    an_hat2=Slerp(0.5,middle,bone_rotate3);
-                    an_=Slerp(1.0/3,bone_rotate2,middle);
-                    bn_=Slerp(-1.0/3,bone_rotate2,an_hat2);
-                }
-                bone_con=DeCasteljauQuaternion(t,bone_rotate1,an,bn_,bone_rotate2);
-                Quaternion2Euler(bone_con,angles);
-                interpolatedPosture.bone_rotation[bone].p[0]=angles[0];
-                interpolatedPosture.bone_rotation[bone].p[1]=angles[1];
-                interpolatedPosture.bone_rotation[bone].p[2]=angles[2];
-            }
-
-            pOutputMotion->SetPosture(startKeyframe + frame, interpolatedPosture);
-        }
-        previousKeyframe = startKeyframe;
-        startKeyframe = endKeyframe;
+      double t = 1.0 * frame / (N+1);
+      double u = 2.0 * t * (1.0 - t);
+      Posture & interpolatedPosture = *pOutputMotion->GetPosture(startKeyframe + frame);
+      ClearBoneTranslations(pSkeleton, interpolatedPosture);
+
+      // interpolate root position
+      StepForwardDifferences(rootDifferences, interpolatedPosture.root_pos);
+
+      // interpolate bone rotations (all bones at once)
+      EvaluateSlerpArcBatch(numActiveBones, &t, 0, keyframeArc, keyframeSlerp);
+      EvaluateSlerpArcBatch(numActiveBones, &t, 0, controlPointArc, controlPointSlerp);
+      SlerpBatch(numActiveBones, &u, 0, keyframeSlerp, controlPointSlerp, interpolatedQuaternions);
+      QuaternionToEulerBatch(numActiveBones, interpolatedQuaternions, angles);
+      SetActiveBoneRotations(pSkeleton, angles, interpolatedPosture);
     }
+  });
 
-    for(int frame=startKeyframe+1; frame<inputLength; frame++)
-        pOutputMotion->SetPosture(frame, *(pInputMotion->GetPosture(frame)));
-    clock_t end=clock();
-    times<<end-start<<endl;
-//    for(int i=600;i<=800;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph1<<g1->bone_rotation[2].p[0]<<endl;
-//
-//    }
-//    for(int i=200;i<=500;i++)
-//    {
-//        Posture* g1;
-//        g1=pOutputMotion->GetPosture(i);
-//        graph3<<g1->bone_rotation[0].p[2]<<endl;
-//    }
+  FinishSegments(pInputMotion, pOutputMotion, numSegments * (N+1));
 }
 
 void Interpolator::Euler2Quaternion(double angles[3], Quaternion<double> & q) 
 {
-  // students should implement this
-    double R[9];
-    Euler2Rotation(angles,R);
-    q=q.Matrix2Quaternion(R);
+  // q = qz * qy * qx, where qx = (cos(angle x / 2), sin(angle x / 2), 0, 0), etc.
+  double sinHalf[3], cosHalf[3];
+  for(int i=0; i<3; i++)
+  {
+    double halfAngle = angles[i] * (M_PI / 360.0);
+    sinHalf[i] = sin(halfAngle);
+    cosHalf[i] = cos(halfAngle);
+  }
+  double s = cosHalf[0] * cosHalf[1] * cosHalf[2] + sinHalf[0] * sinHalf[1] * sinHalf[2];
+  double x = sinHalf[0] * cosHalf[1] * cosHalf[2] - cosHalf[0] * sinHalf[1] * sinHalf[2];
+  double y = cosHalf[0] * sinHalf[1] * cosHalf[2] + sinHalf[0] * cosHalf[1] * sinHalf[2];
+  double z = cosHalf[0] * cosHalf[1] * sinHalf[2] - sinHalf[0] * sinHalf[1] * cosHalf[2];
+
+  // choose the sign as Quaternion::Matrix2Quaternion does (Slerp's linear branch depends on it):
+  // s >= 0 if the trace 4 s^2 - 1 of the rotation matrix is non-negative, otherwise the largest of x, y, z is positive
+  double pivot = s;
+  if (4 * s * s - 1 < 0)
+  {
+    pivot = (y * y > x * x) ? y : x;
+    if (z * z > pivot * pivot)
+      pivot = z;
+  }
+  if (pivot < 0)
+    q.Set(-s, -x, -y, -z);
+  else
+    q.Set(s, x, y, z);
 }
 
 void Interpolator::Quaternion2Euler(Quaternion<double> & q, double angles[3]) 
 {
-  // students should implement this
-    double R[9];
-    q.Quaternion2Matrix(R);
-    Rotation2Euler(R,angles);
+  // only the entries of the rotation matrix (see Quaternion::Quaternion2Matrix) that Rotation2Euler uses
+  double s = q.Gets(), x = q.Getx(), y = q.Gety(), z = q.Getz();
+  double R0 = 1 - 2*y*y - 2*z*z;
+  double R3 = 2*x*y + 2*s*z;
+  double R6 = 2*x*z - 2*s*y;
+  double cy = sqrt(R0*R0 + R3*R3);
+
+  if (cy > 16*DBL_EPSILON) 
+  {
+    angles[0] = atan2(2*y*z + 2*s*x, 1 - 2*x*x - 2*y*y);
+    angles[1] = atan2(-R6, cy);
+    angles[2] = atan2(R3, R0);
+  } 
+  else 
+  {
+    angles[0] = atan2(-(2*y*z - 2*s*x), 1 - 2*x*x - 2*z*z);
+    angles[1] = atan2(-R6, cy);
+    angles[2] = 0;
+  }
+
+  for(int i=0; i<3; i++)
+    angles[i] *= 180 / M_PI;
 }
 
 Quaternion<double> Interpolator::Slerp(double t, Quaternion<double> & qStart, Quaternion<double> & qEnd_)
@@ -569,7 +829,6 @@ Quaternion<double> Interpolator::Slerp(double t, Quaternion<double> & qStart, Qu
              qStart.Getz()*cos(theta)+mid.Getz()*sin(theta));
   result.Normalize();
   return result;
-
 }
 
 Quaternion<double> Interpolator::Double(Quaternion<double> p, Quaternion<double> q)
@@ -585,16 +844,16 @@ Quaternion<double> Interpolator::Double(Quaternion<double> p, Quaternion<double>
   return result;
 }
 
-vector Interpolator::DeCasteljauEuler(double t, vector p0, vector p1, vector p2, vector p3)
+vector Interpolator::DeCasteljauEuler(double t, const vector & p0, const vector & p1, const vector & p2, const vector & p3)
 {
   // students should implement this
   vector result;
     vector Q0,Q1,Q2,R0,R1;
     for(int i=0;i<3;i++)
     {
-        Q0[i]=p0[i]*(1-t)+p1[i]*t;
-        Q1[i]=p1[i]*(1-t)+p2[i]*t;
-        Q2[i]=p2[i]*(1-t)+p3[i]*t;
+        Q0[i]=p0.p[i]*(1-t)+p1.p[i]*t;
+        Q1[i]=p1.p[i]*(1-t)+p2.p[i]*t;
+        Q2[i]=p2.p[i]*(1-t)+p3.p[i]*t;
         R0[i]=Q0[i]*(1-t)+Q1[i]*t;
         R1[i]=Q1[i]*(1-t)+Q2[i]*t;
         result[i]=R0[i]*(1-t)+R1[i]*t;
@@ -11,12 +11,13 @@
 #ifndef _INTERPOLATOR_H
 #define _INTERPOLATOR_H
 
+#include <functional>
 #include "motion.h"
 #include "quaternion.h"
 
 enum InterpolationType
 {
-  LINEAR = 0, BEZIER = 1
+  LINEAR = 0, BEZIER = 1, SQUAD = 2 // SQUAD: quaternions only
 };
 
 enum AngleRepresentation
@@ -36,33 +37,97 @@ public:
   //Set angle representation for interpolation
   void SetAngleRepresentation(AngleRepresentation angleRepresentation) {m_AngleRepresentation = angleRepresentation;};
 
+  //Interpolate the keyframe segments in parallel on the given thread pool (NULL = serially, the default)
+  //The output is identical to the serial interpolation.
+  void SetThreadPool(ThreadPool * pThreadPool) { m_pThreadPool = pThreadPool; }
+
   //Create interpolated motion and store it into pOutputMotion (which will also be allocated)
   void Interpolate(Motion * pInputMotion, Motion ** pOutputMotion, int N);
-
-protected:
-  InterpolationType m_InterpolationType; //Interpolation type (Linear, Bezier)
-  AngleRepresentation m_AngleRepresentation; //Angle representation (Euler, Quaternion)
-
-  // conversion routines
+  //Create interpolated motion in an existing motion (for example, the output of a previous interpolation),
+  //which must have the skeleton and the number of frames of the input motion; nothing is allocated (after the first call),
+  //and the output motion is not cleared first: every frame is written, with the values that the interpolation does not compute
+  //(the bone translations and length changes) set to 0, as in a new motion
+  //The output motion can be the input motion (in-place interpolation): only the keyframes are read, and they are not modified.
+  //Returns 0 on success, and -1 if the output motion does not match (an error message is printed)
+  int Interpolate(Motion * pInputMotion, Motion * pOutputMotion, int N);
+
+  // conversion routines (the interpolation routines use the batch versions in quaternionBatch.h)
   // angles are given in degrees; assume XYZ Euler angle order
   void Rotation2Euler(double R[9], double angles[3]);
-  void Euler2Rotation(double angles[3], double R[9]);
-  void Euler2Quaternion(double angles[3], Quaternion<double> & q); 
+  void Euler2Rotation(double angles[3], double R[9]); // note: converts angles to radians in place
+  void Euler2Quaternion(double angles[3], Quaternion<double> & q); // same quaternion (and, except for ties, sign) as Quaternion::Matrix2Quaternion of Euler2Rotation
   void Quaternion2Euler(Quaternion<double> & q, double angles[3]); 
 
-  // quaternion interpolation
+  // quaternion interpolation (the interpolation routines use the batch versions in quaternionBatch.h)
+  // Slerp normalizes its arguments, and may negate qEnd
   Quaternion<double> Slerp(double t, Quaternion<double> & qStart, Quaternion<double> & qEnd);
+  Quaternion<double> DeCasteljauQuaternion(double t, Quaternion<double> p0, Quaternion<double> p1, Quaternion<double> p2, Quaternion<double> p3); // evaluate Bezier spline at t, using DeCasteljau construction, Quaternion version
+
+protected:
+  friend class MotionSampler; // uses the control point construction and the conversion helpers
+  friend class KeyframeSelector; // uses the conversion helpers
+  friend class MotionCodec; // uses the conversion helpers
+
+  InterpolationType m_InterpolationType; //Interpolation type (Linear, Bezier, SQUAD)
+  AngleRepresentation m_AngleRepresentation; //Angle representation (Euler, Quaternion)
+  ThreadPool * m_pThreadPool; //Thread pool for the keyframe segments (NULL = serial)
+
+  // buffers reused by the interpolation routines (an interpolator must not be used by several threads at once)
+  // (the quaternion tables store the quaternions of all bones in structure-of-arrays layout, see quaternionBatch.h)
+  double * m_pKeyframeQuaternions; // bone rotations of each keyframe, converted to quaternions
+  vector * m_pControlPoints; // forward differences of the Bezier curves of each segment, Euler angles / root position
+  double * m_pControlQuaternions; // Bezier control points (start, a_n, b_n, end) of all bones, for each segment / SQUAD control points, quaternions
+  double * m_pSlerpArcs; // SQUAD: the two Slerp arcs of each segment, for all bones
+  int m_KeyframeQuaternionsCapacity, m_ControlPointsCapacity, m_ControlQuaternionsCapacity, m_SlerpArcsCapacity;
+
   Quaternion<double> Double(Quaternion<double> p, Quaternion<double> q);
 
+  // keyframe segments: segment i interpolates the frames between keyframes i*(N+1) and (i+1)*(N+1)
+  static int GetNumSegments(int inputLength, int N);
+  void PrepareSegments(Motion * pInputMotion, Motion * pOutputMotion);
+  // executes segment(0), ..., segment(numSegments-1); each segment writes its start keyframe and the frames after it
+  void ForEachSegment(int numSegments, const std::function<void(int)> & segment);
+  // copies the remaining frames from lastKeyframe on
+  void FinishSegments(Motion * pInputMotion, Motion * pOutputMotion, int lastKeyframe);
+
+  // converts the bone rotations of keyframes 0, N+1, ..., (numKeyframes-1)*(N+1) to quaternions (into m_pKeyframeQuaternions)
+  void ComputeKeyframeQuaternions(Motion * pInputMotion, int N, int numKeyframes);
+  // Bezier control points a_n, b_n of the segment p1 -> p2, given the previous keyframe p0 and the next keyframe p3 
+  // (if there is no previous / next keyframe, the corresponding point is ignored)
+  void ComputeEulerControlPoints(vector p0, vector p1, vector p2, vector p3, int hasPrevious, int hasNext, vector & an, vector & bn);
+  // quaternion version; controlPoints receives the four control points (start, a_n, b_n, end) of the segment
+  void ComputeQuaternionControlPoints(Quaternion<double> q0, Quaternion<double> q1, Quaternion<double> q2, Quaternion<double> q3, 
+    int hasPrevious, int hasNext, Quaternion<double> controlPoints[4]);
+  // SQUAD: for each keyframe, the keyframe quaternions (on the same hemisphere as the previous keyframe) and the 
+  // control points s_i, into controlQuaternions (8 * numActiveBones values per keyframe), 
+  // given the quaternions of the keyframes (4 * numActiveBones values per keyframe, as from ComputeKeyframeQuaternions)
+  void ComputeSquadControlPoints(const double * keyframeQuaternions, int numKeyframes, int numActiveBones, double * controlQuaternions);
+
+  // copies the rotations of the active bones into the arrays angles[0..2] (x, y, z angles; see quaternionBatch.h)
+  static void GetActiveBoneRotations(const Skeleton * pSkeleton, const Posture & posture, double * const angles[3]);
+  // sets the rotations of the active bones from the arrays angles[0..2], and applies the rotational DOF masks
+  static void SetActiveBoneRotations(const Skeleton * pSkeleton, const double * const angles[3], Posture & posture);
+  // sets the translations and length changes of the bones with translational / length DOFs to 0 (in an interpolated frame;
+  // the other values that are not interpolated are 0 in every posture: the rotations of the bones without DOFs, and so on)
+  static void ClearBoneTranslations(const Skeleton * pSkeleton, Posture & posture);
+
   // interpolation routines
+  void InterpolateMotion(Motion * pInputMotion, Motion * pOutputMotion, int N); // calls the routine of the interpolation type and angle representation
   void LinearInterpolationEuler(Motion * pInputMotion, Motion * pOutputMotion, int N);
   void BezierInterpolationEuler(Motion * pInputMotion, Motion * pOutputMotion, int N);
   void LinearInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N);
   void BezierInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N);
+  // spherical quadrangle interpolation (Shoemake): a C1 quaternion spline, with two precomputed Slerp arcs per segment 
+  // and one Slerp between them per frame (instead of the six Slerps of DeCasteljauQuaternion)
+  void SquadInterpolationQuaternion(Motion * pInputMotion, Motion * pOutputMotion, int N);
 
   // Bezier spline evaluation
-  vector DeCasteljauEuler(double t, vector p0, vector p1, vector p2, vector p3); // evaluate Bezier spline at t, using DeCasteljau construction, vector version
-  Quaternion<double> DeCasteljauQuaternion(double t, Quaternion<double> p0, Quaternion<double> p1, Quaternion<double> p2, Quaternion<double> p3); // evaluate Bezier spline at t, using DeCasteljau construction, Quaternion version
+  vector DeCasteljauEuler(double t, const vector & p0, const vector & p1, const vector & p2, const vector & p3); // evaluate Bezier spline at t, using DeCasteljau construction, vector version
+  // the interpolation routines evaluate the Euler / root position curves at the uniformly spaced frames t = h, 2h, ... by forward differencing:
+  // differences receives B(0) and the first, second and third forward difference of the cubic Bezier curve with control points p0, p1, p2, p3
+  static void ComputeBezierForwardDifferences(const vector & p0, const vector & p1, const vector & p2, const vector & p3, double h, vector differences[4]);
+  // advances the forward differences by h; value = B(t + h)
+  static void StepForwardDifferences(vector differences[4], vector & value);
 
 };
 
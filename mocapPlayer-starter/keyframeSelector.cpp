@@ -0,0 +1,251 @@
+/*
+keyframeSelector.cpp
+
+Adaptive keyframe selection within an error tolerance.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "keyframeSelector.h"
+#include "motionSampler.h"
+#include "forwardKinematics.h"
+#include "quaternionBatch.h"
+
+KeyframeSelector::KeyframeSelector(InterpolationType interpolationType, AngleRepresentation angleRepresentation, KeyframeErrorMetric metric, double tolerance)
+{
+  m_InterpolationType = interpolationType;
+  m_AngleRepresentation = angleRepresentation;
+  m_Metric = metric;
+  m_Tolerance = tolerance;
+  m_MaxError = 0.0;
+  m_NumSegmentEvaluations = 0;
+  m_pMotion = NULL;
+  m_NumActiveBones = 0;
+  m_pReference = NULL;
+  m_ReferenceSize = 0;
+  m_pForwardKinematics = NULL;
+}
+
+KeyframeSelector::~KeyframeSelector()
+{
+  delete [] m_pReference;
+  delete m_pForwardKinematics;
+}
+
+void KeyframeSelector::ComputeReference(Motion * pMotion)
+{
+  const Skeleton * pSkeleton = pMotion->GetSkeleton();
+  m_pMotion = pMotion;
+  m_NumActiveBones = pSkeleton->getNumActiveBones();
+  delete [] m_pReference;
+  delete m_pForwardKinematics;
+  m_pForwardKinematics = NULL;
+
+  int numFrames = pMotion->GetNumFrames();
+  if (m_Metric == ROTATION_ERROR)
+    m_ReferenceSize = 4 * m_NumActiveBones;
+  else
+  {
+    m_pForwardKinematics = new ForwardKinematics(pSkeleton);
+    m_ReferenceSize = 3 * pMotion->GetNumBones();
+  }
+  m_pReference = new double[numFrames * m_ReferenceSize];
+
+  pMotion->UpdatePostures();
+  for(int frame=0; frame<numFrames; frame++)
+  {
+    double * reference = &m_pReference[frame * m_ReferenceSize];
+    if (m_Metric == ROTATION_ERROR)
+    {
+      double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+      double * angles[3] = { anglesBuffer, anglesBuffer + m_NumActiveBones, anglesBuffer + 2 * m_NumActiveBones };
+      Interpolator::GetActiveBoneRotations(pSkeleton, *pMotion->GetPosture(frame), angles);
+      double * q[4];
+      GetQuaternionArrays(reference, m_NumActiveBones, q);
+      EulerToQuaternionBatch(m_NumActiveBones, angles, q);
+    }
+    else
+      m_pForwardKinematics->ComputeJointPositions(*pMotion->GetPosture(frame), reference);
+  }
+}
+
+double KeyframeSelector::GetFrameError(const Posture & posture, int frame)
+{
+  const double * reference = &m_pReference[frame * m_ReferenceSize];
+  double maxError = 0.0;
+  if (m_Metric == ROTATION_ERROR)
+  {
+    int numActiveBones = m_NumActiveBones;
+    double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE], buffer[4 * MAX_BONES_IN_ASF_FILE];
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+    Interpolator::GetActiveBoneRotations(m_pMotion->GetSkeleton(), posture, angles);
+    double * q[4];
+    GetQuaternionArrays(buffer, numActiveBones, q);
+    EulerToQuaternionBatch(numActiveBones, angles, q);
+
+    const double * r[4];
+    for(int c=0; c<4; c++)
+      r[c] = reference + c * numActiveBones;
+    double errors[MAX_BONES_IN_ASF_FILE];
+    RotationAngleBatch(numActiveBones, r, q, errors);
+    for (int k = 0; k < numActiveBones; k++)
+      if (errors[k] > maxError)
+        maxError = errors[k];
+  }
+  else
+  {
+    double positions[3 * MAX_BONES_IN_ASF_FILE];
+    m_pForwardKinematics->ComputeJointPositions(posture, positions);
+    for(int j=0; j<m_pForwardKinematics->GetNumBones(); j++)
+    {
+      double dx = positions[3 * j] - reference[3 * j];
+      double dy = positions[3 * j + 1] - reference[3 * j + 1];
+      double dz = positions[3 * j + 2] - reference[3 * j + 2];
+      double distance = sqrt(dx * dx + dy * dy + dz * dz);
+      if (distance > maxError)
+        maxError = distance;
+    }
+  }
+  return maxError;
+}
+
+double KeyframeSelector::GetSegmentError(const int * keyframes, int first, int last, int segment, int * worstFrame)
+{
+  m_NumSegmentEvaluations++;
+  *worstFrame = -1;
+  if (keyframes[segment + 1] - keyframes[segment] < 2)
+    return 0.0;
+
+  MotionSampler sampler(m_pMotion, last - first + 1, &keyframes[first], m_InterpolationType, m_AngleRepresentation);
+  Posture posture;
+  double maxError = -1.0;
+  for(int frame=keyframes[segment]+1; frame<keyframes[segment+1]; frame++)
+  {
+    sampler.Sample(frame, posture);
+    double error = GetFrameError(posture, frame);
+    if (error > maxError)
+    {
+      maxError = error;
+      *worstFrame = frame;
+    }
+  }
+  return maxError;
+}
+
+int KeyframeSelector::SelectKeyframes(Motion * pMotion, int ** keyframes)
+{
+  m_MaxError = 0.0;
+  m_NumSegmentEvaluations = 0;
+  int numFrames = pMotion->GetNumFrames();
+  *keyframes = NULL;
+  if (numFrames < 1)
+    return 0;
+  ComputeReference(pMotion);
+
+  // 1. greedy pass; window: the previous keyframe (if any), the current keyframe, and the candidate
+  std::vector<int> selected;
+  selected.push_back(0);
+  int lastFrame = numFrames - 1;
+  while (selected.back() < lastFrame)
+  {
+    int current = selected.back();
+    int window[3] = { current, current, 0 };
+    int numPrevious = 0;
+    if (selected.size() > 1)
+    {
+      window[0] = selected[selected.size() - 2];
+      numPrevious = 1;
+    }
+    int worstFrame;
+    auto fits = [&](int candidate)
+    {
+      window[numPrevious + 1] = candidate;
+      return GetSegmentError(window, 0, numPrevious + 1, numPrevious, &worstFrame) <= m_Tolerance;
+    };
+
+    // exponential search for the first step that exceeds the tolerance, then binary search
+    int good = current + 1, bad = -1;
+    for(int step=2; ; step*=2)
+    {
+      int candidate = (current + step < lastFrame) ? current + step : lastFrame;
+      if (!fits(candidate))
+      {
+        bad = candidate;
+        break;
+      }
+      good = candidate;
+      if (candidate == lastFrame)
+        break;
+    }
+    if (bad >= 0)
+    {
+      while (bad - good > 1)
+      {
+        int middle = (good + bad) / 2;
+        if (fits(middle))
+          good = middle;
+        else
+          bad = middle;
+      }
+    }
+    selected.push_back(good);
+  }
+
+  // 2. refinement with all neighbouring keyframes; the curve of segment s depends on keyframes s-1, ..., s+2
+  int numSegments = (int)selected.size() - 1;
+  std::vector<double> errors(numSegments);
+  std::vector<int> worstFrames(numSegments);
+  auto evaluate = [&](int segment)
+  {
+    int numKeyframes = (int)selected.size();
+    int first = (segment > 0) ? segment - 1 : 0;
+    int last = (segment + 2 < numKeyframes) ? segment + 2 : numKeyframes - 1;
+    errors[segment] = GetSegmentError(selected.data(), first, last, segment, &worstFrames[segment]);
+  };
+  for(int segment=0; segment<numSegments; segment++)
+    evaluate(segment);
+
+  int segment = 0;
+  while (segment < numSegments)
+  {
+    if (errors[segment] <= m_Tolerance)
+    {
+      segment++;
+      continue;
+    }
+
+    // the worst frame becomes a keyframe; it splits the segment in two
+    selected.insert(selected.begin() + segment + 1, worstFrames[segment]);
+    errors.insert(errors.begin() + segment + 1, 0.0);
+    worstFrames.insert(worstFrames.begin() + segment + 1, -1);
+    numSegments++;
+    int firstAffected = (segment > 0) ? segment - 1 : 0;
+    int lastAffected = (segment + 2 < numSegments - 1) ? segment + 2 : numSegments - 1;
+    for(int s=firstAffected; s<=lastAffected; s++)
+      evaluate(s);
+    segment = firstAffected;
+  }
+
+  for(int s=0; s<numSegments; s++)
+    if (errors[s] > m_MaxError)
+      m_MaxError = errors[s];
+
+  int numKeyframes = (int)selected.size();
+  *keyframes = new int[numKeyframes];
+  for(int i=0; i<numKeyframes; i++)
+    (*keyframes)[i] = selected[i];
+  return numKeyframes;
+}
+
+void KeyframeSelector::Reconstruct(Motion * pMotion, int numKeyframes, const int * keyframes, Motion ** pOutputMotion)
+{
+  *pOutputMotion = new Motion(pMotion->GetNumFrames(), pMotion->GetSkeleton());
+  if (numKeyframes < 1)
+    return;
+  MotionSampler sampler(pMotion, numKeyframes, keyframes, m_InterpolationType, m_AngleRepresentation);
+  for(int frame=0; frame<pMotion->GetNumFrames(); frame++)
+    sampler.Sample(frame, *(*pOutputMotion)->GetPosture(frame));
+  (*pOutputMotion)->PosturesModified();
+}
+
@@ -0,0 +1,86 @@
+/*
+keyframeSelector.h
+
+Adaptive keyframe selection: chooses keyframes of a motion (instead of every
+(N+1)th frame) such that the motion reconstructed from them with an
+interpolation method (see MotionSampler) stays within an error tolerance.
+
+Error metrics (of a frame; the maximum over the bones):
+  ROTATION_ERROR: angle (in degrees) between the rotation of each active bone in the
+    reconstructed and in the original frame
+  POSITION_ERROR: distance between the world positions of each joint (see forwardKinematics.h),
+    in skeleton units; unlike ROTATION_ERROR, this includes the root position
+
+The selection has two passes:
+  1. greedy: from each keyframe, the next keyframe is the farthest frame for which the segment
+     in between is within the tolerance (exponential, then binary search); the segment is evaluated
+     without the keyframe after it, which is not known yet
+  2. refinement: while a segment exceeds the tolerance, its worst frame becomes a keyframe;
+     only the segments whose curves depend on the new keyframe are evaluated again
+Segments are evaluated with a MotionSampler on the keyframes that their curves depend on,
+so that each evaluation costs O(segment length).
+The first and the last frame are always keyframes; every frame of the
+reconstructed motion is within the tolerance.
+
+Usage:
+  KeyframeSelector selector(BEZIER, QUATERNION, ROTATION_ERROR, 2.0); // at most 2 degrees
+  int * keyframes;
+  int numKeyframes = selector.SelectKeyframes(pMotion, &keyframes);
+  selector.Reconstruct(pMotion, numKeyframes, keyframes, &pOutputMotion);
+  delete [] keyframes;
+*/
+
+#ifndef _KEYFRAMESELECTOR_H_
+#define _KEYFRAMESELECTOR_H_
+
+#include "interpolator.h"
+
+enum KeyframeErrorMetric
+{
+  ROTATION_ERROR = 0, POSITION_ERROR = 1
+};
+
+class ForwardKinematics;
+
+class KeyframeSelector
+{
+public:
+  KeyframeSelector(InterpolationType interpolationType, AngleRepresentation angleRepresentation, KeyframeErrorMetric metric, double tolerance);
+  ~KeyframeSelector();
+
+  // selects the keyframes of pMotion; *keyframes is allocated (the caller deletes it with delete []),
+  // and receives the keyframes in increasing order; returns the number of keyframes (0 for an empty motion)
+  int SelectKeyframes(Motion * pMotion, int ** keyframes);
+
+  // reconstructs all frames of pMotion from the keyframes with the interpolation method; *pOutputMotion is allocated
+  void Reconstruct(Motion * pMotion, int numKeyframes, const int * keyframes, Motion ** pOutputMotion);
+
+  // largest error of a frame reconstructed from the keyframes of the last SelectKeyframes
+  double GetMaxError() { return m_MaxError; }
+  // number of segment evaluations of the last SelectKeyframes
+  int GetNumSegmentEvaluations() { return m_NumSegmentEvaluations; }
+
+protected:
+  InterpolationType m_InterpolationType;
+  AngleRepresentation m_AngleRepresentation;
+  KeyframeErrorMetric m_Metric;
+  double m_Tolerance;
+  double m_MaxError;
+  int m_NumSegmentEvaluations;
+
+  // reference data of the original motion, for all frames
+  Motion * m_pMotion;
+  int m_NumActiveBones;
+  double * m_pReference; // ROTATION_ERROR: quaternions of the active bones; POSITION_ERROR: joint positions
+  int m_ReferenceSize; // number of values per frame
+  ForwardKinematics * m_pForwardKinematics;
+
+  void ComputeReference(Motion * pMotion);
+  double GetFrameError(const Posture & posture, int frame);
+  // largest error of the frames strictly between keyframes[segment] and keyframes[segment+1], interpolated
+  // from the keyframes keyframes[first], ..., keyframes[last]; worstFrame receives the frame with that error (-1 if none)
+  double GetSegmentError(const int * keyframes, int first, int last, int segment, int * worstFrame);
+};
+
+#endif
+
@@ -0,0 +1,128 @@
+/*
+mappedFile.cpp
+
+View of an entire file in memory.
+*/
+
+#ifdef WIN32
+  #define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mappedFile.h"
+
+#if (defined __unix__) || (defined __APPLE__)
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+{
+  m_pData = NULL;
+  m_Size = 0;
+  m_Mapped = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+#if (defined __unix__) || (defined __APPLE__)
+
+int MappedFile::Open(const char * filename, int writable)
+{
+  Close();
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+  m_Size = (size_t)fileStat.st_size;
+  if (m_Size == 0)
+  {
+    // mmap does not support empty files
+    close(fd);
+    m_pData = (char*) malloc(1);
+    m_Mapped = 0;
+    return 0;
+  }
+
+  int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void * data = mmap(NULL, m_Size, protection, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    m_Size = 0;
+    return -1;
+  }
+
+  // the file is read front to back
+  madvise(data, m_Size, MADV_SEQUENTIAL);
+
+  m_pData = (char*) data;
+  m_Mapped = 1;
+  return 0;
+}
+
+void MappedFile::Close()
+{
+  if (m_pData != NULL)
+  {
+    if (m_Mapped)
+      munmap(m_pData, m_Size);
+    else
+      free(m_pData);
+  }
+  m_pData = NULL;
+  m_Size = 0;
+  m_Mapped = 0;
+}
+
+#else
+
+int MappedFile::Open(const char * filename, int writable)
+{
+  Close();
+
+  FILE * file = fopen(filename, "rb");
+  if (file == NULL)
+    return -1;
+
+  fseek(file, 0, SEEK_END);
+  m_Size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  m_pData = (char*) malloc(m_Size + 1);
+  if (fread(m_pData, 1, m_Size, file) != m_Size)
+  {
+    fclose(file);
+    Close();
+    return -1;
+  }
+  fclose(file);
+  m_Mapped = 0;
+  return 0;
+}
+
+void MappedFile::Close()
+{
+  if (m_pData != NULL)
+    free(m_pData);
+  m_pData = NULL;
+  m_Size = 0;
+  m_Mapped = 0;
+}
+
+#endif
+
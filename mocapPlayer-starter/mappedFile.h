@@ -0,0 +1,41 @@
+/*
+mappedFile.h
+
+View of an entire file in memory.
+
+Under Linux/Mac OS X, the file is memory-mapped (mmap), so that no copy of the
+file is made. Under Windows, the file is read into a buffer.
+
+Usage:
+  MappedFile file;
+  if (file.Open(filename) != 0) ... // error
+  const char * data = file.GetData(); // file.GetSize() bytes, not 0-terminated
+*/
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <stddef.h>
+
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+
+  // maps the file; returns 0 on success, -1 on failure
+  // if writable is 1, the memory can be modified; the changes are private and never written to the file
+  int Open(const char * filename, int writable=0);
+  void Close();
+
+  char * GetData() { return m_pData; }
+  size_t GetSize() { return m_Size; }
+
+protected:
+  char * m_pData;
+  size_t m_Size;
+  int m_Mapped; // 1 if m_pData is memory-mapped, 0 if it was allocated
+};
+
+#endif
+
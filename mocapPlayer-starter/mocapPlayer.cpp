@@ -312,7 +312,7 @@ void resetPostureAccordingFrameSlider(void)
       postureID = currentFrameIndex;
     // Set skeleton to the first posture
     Posture * currentPosture = displayer.GetSkeletonMotion(skeletonIndex)->GetPosture(postureID);
-    displayer.GetSkeleton(skeletonIndex)->setPosture(*currentPosture);
+    displayer.GetSkeletonPose(skeletonIndex)->setPosture(*currentPosture);
   }
 }
 
@@ -337,10 +337,11 @@ void load_callback(Fl_Button *button, void *)
       {
         // Read skeleton from asf file
         pSkeleton = new Skeleton(filename, MOCAP_SCALE);
+        // the motions may list all rotational DOFs (:FORCE-ALL-JOINTS-BE-3DOF); the DOFs that a motion does not list stay 0
+        pSkeleton->enableAllRotationalDOFs();
         lastSkeleton++;
-        // Set the rotations for all bones in their local coordinate system to 0
-        // Set root position to (0, 0, 0)
-        pSkeleton->setBasePosture();
+        // The skeleton is displayed with the rotations for all bones in their local coordinate system set to 0
+        // and the root position at (0, 0, 0), until a motion is loaded
         displayer.LoadSkeleton(pSkeleton);
         glwindow->redraw();
       }
@@ -442,7 +443,7 @@ void SetSkeletonsToSpecifiedFrame(int frameIndex)
         postureID = displayer.GetSkeletonMotion(skeletonIndex)->GetNumFrames() - 1;
       else 
         postureID = frameIndex;
-      displayer.GetSkeleton(skeletonIndex)->setPosture(* (displayer.GetSkeletonMotion(skeletonIndex)->GetPosture(postureID)));
+      displayer.GetSkeletonPose(skeletonIndex)->setPosture(* (displayer.GetSkeletonMotion(skeletonIndex)->GetPosture(postureID)));
     }
 }
 
@@ -498,7 +499,7 @@ void idle(void*)
       if (displayer.GetSkeletonMotion(i) != NULL)
       {
         Posture * initSkeleton = displayer.GetSkeletonMotion(i)->GetPosture(0);
-        displayer.GetSkeleton(i)->setPosture(*initSkeleton);
+        displayer.GetSkeletonPose(i)->setPosture(*initSkeleton);
       }
     }
     rewindButton = OFF;
@@ -650,9 +651,9 @@ void skeletonID_callback(Fl_Value_Input *obj, void*)
     
   // Change values of other inputs to match sub-number
   double translation[3];
-  displayer.GetSkeleton(subnum)->GetTranslation(translation);
+  displayer.GetSkeletonPose(subnum)->GetTranslation(translation);
   double rotationAngle[3];
-  displayer.GetSkeleton(subnum)->GetRotationAngle(rotationAngle);
+  displayer.GetSkeletonPose(subnum)->GetRotationAngle(rotationAngle);
   tx_input->value(translation[0]);
   ty_input->value(translation[1]);
   tz_input->value(translation[2]);
@@ -668,7 +669,7 @@ void tx_callback(Fl_Value_Input *obj, void*)
   int subnum = 0;
   subnum = (int)sub_input->value();
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetTranslationX(tx_input->value());
+    displayer.GetSkeletonPose(subnum)->SetTranslationX(tx_input->value());
   glwindow->redraw();
 }
 
@@ -678,7 +679,7 @@ void ty_callback(Fl_Value_Input *obj, void*)
   subnum = (int)sub_input->value();
 
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetTranslationY(ty_input->value());
+    displayer.GetSkeletonPose(subnum)->SetTranslationY(ty_input->value());
 
   glwindow->redraw();
 }
@@ -689,7 +690,7 @@ void tz_callback(Fl_Value_Input *obj, void*)
   subnum = (int)sub_input->value();
 
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetTranslationZ(tz_input->value());
+    displayer.GetSkeletonPose(subnum)->SetTranslationZ(tz_input->value());
 
   glwindow->redraw();
 }
@@ -699,7 +700,7 @@ void rx_callback(Fl_Value_Input *obj, void*)
   int subnum = 0;
   subnum = (int)sub_input->value();
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetRotationAngleX(rx_input->value());
+    displayer.GetSkeletonPose(subnum)->SetRotationAngleX(rx_input->value());
   glwindow->redraw();
 }
 
@@ -708,7 +709,7 @@ void ry_callback(Fl_Value_Input *obj, void*)
   int subnum = 0;
   subnum = (int)sub_input->value();
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetRotationAngleY(ry_input->value());
+    displayer.GetSkeletonPose(subnum)->SetRotationAngleY(ry_input->value());
   glwindow->redraw();
 }
 
@@ -717,7 +718,7 @@ void rz_callback(Fl_Value_Input *obj, void*)
   int subnum = 0;
   subnum = (int)sub_input->value();
   if (subnum < displayer.GetNumSkeletons() && subnum >= 0)
-    displayer.GetSkeleton(subnum)->SetRotationAngleZ(rz_input->value());
+    displayer.GetSkeletonPose(subnum)->SetRotationAngleZ(rz_input->value());
   glwindow->redraw();
 }
 
@@ -954,10 +955,11 @@ int main(int argc, char **argv)
     {
       //Read skeleton from asf file
       pSkeleton = new Skeleton(filename, MOCAP_SCALE);
+      // the motions may list all rotational DOFs (:FORCE-ALL-JOINTS-BE-3DOF); the DOFs that a motion does not list stay 0
+      pSkeleton->enableAllRotationalDOFs();
 
-      //Set the rotations for all bones in their local coordinate system to 0
-      //Set root position to (0, 0, 0)
-      pSkeleton->setBasePosture();
+      //The skeleton is displayed with the rotations for all bones in their local coordinate system set to 0
+      //and the root position at (0, 0, 0), until a motion is loaded
       displayer.LoadSkeleton(pSkeleton);
       lastSkeleton++;
     }
@@ -976,7 +978,7 @@ int main(int argc, char **argv)
         lastMotion++;
 
         //Tell skeleton to perform the first pose ( first posture )
-        pSkeleton->setPosture(*(displayer.GetSkeletonMotion(0)->GetPosture(0)));          
+        displayer.GetSkeletonPose(0)->setPosture(*(displayer.GetSkeletonMotion(0)->GetPosture(0)));          
 
         // Set skeleton to perform the first pose ( first posture )         
         int currentFrames = displayer.GetSkeletonMotion(0)->GetNumFrames();
@@ -7,33 +7,81 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 */
 #include <stdio.h>
 #include <string.h>
-#include <fstream>
 #include <math.h>
 #include <stdlib.h>
 
 #include "skeleton.h"
 #include "motion.h"
 #include "vector.h"
+#include "mappedFile.h"
+#include "amcParser.h"
+#include "amcWriter.h"
+#include "threadPool.h"
 
-Motion::Motion(int numFrames_, Skeleton * pSkeleton_)
+Motion::Motion(int numFrames_, const Skeleton * pSkeleton_)
 {
   pSkeleton = pSkeleton_;
   m_NumFrames = numFrames_;
+  m_NumBones = pSkeleton->getNumBones();
+  m_pPostures = NULL;
+  m_pPostureData = NULL;
+  m_pChannels = NULL;
+  m_PosturesValid = m_ChannelsValid = 0;
+  m_pMappedFile = NULL;
 
   //allocate postures array
-  m_pPostures = new Posture[m_NumFrames];
+  AllocatePostures();
 
   //Set all postures to default posture
   SetPosturesToDefault();
 }
 
-Motion::Motion(char *amc_filename, double scale, Skeleton * pSkeleton_)
+Motion::Motion(MotionChannels * pChannels, const Skeleton * pSkeleton_)
+{
+  pSkeleton = pSkeleton_;
+  m_NumFrames = pChannels->GetNumFrames();
+  m_NumBones = pSkeleton->getNumBones();
+  if (pChannels->GetNumBones() != m_NumBones)
+  {
+    printf("Error in Motion::Motion: channels have %d bones, the skeleton has %d bones.\n", pChannels->GetNumBones(), m_NumBones);
+    throw 1;
+  }
+  m_pPostures = NULL;
+  m_pPostureData = NULL;
+  m_pChannels = pChannels;
+  m_PosturesValid = 0;
+  m_ChannelsValid = 1;
+  m_pMappedFile = NULL;
+}
+
+Motion::Motion(char *amcb_filename, const Skeleton * pSkeleton_, double scale, int quiet)
 {
   pSkeleton = pSkeleton_;
   m_NumFrames = 0;
+  m_NumBones = pSkeleton->getNumBones();
   m_pPostures = NULL;
+  m_pPostureData = NULL;
+  m_pChannels = NULL;
+  m_PosturesValid = m_ChannelsValid = 0;
+  m_pMappedFile = NULL;
 
-  int code = readAMCfile(amc_filename, scale);	
+  int code = readAMCBfile(amcb_filename, scale, quiet);
+  if (code < 0)
+    throw 1;
+}
+
+Motion::Motion(char *amc_filename, double scale, const Skeleton * pSkeleton_, ThreadPool * pThreadPool, int quiet)
+{
+  pSkeleton = pSkeleton_;
+  m_NumFrames = 0;
+  m_NumBones = pSkeleton->getNumBones();
+  m_pPostures = NULL;
+  m_pPostureData = NULL;
+  m_pChannels = NULL;
+  m_PosturesValid = m_ChannelsValid = 0;
+  m_pMappedFile = NULL;
+
+  int code = readAMCfile(amc_filename, scale, pThreadPool, quiet);	
   if (code < 0)
     throw 1;
 }
@@ -42,36 +90,123 @@ Motion::~Motion()
 {
   if (m_pPostures != NULL)
     delete [] m_pPostures;
+  if (m_pPostureData != NULL)
+    delete [] m_pPostureData;
+  if (m_pChannels != NULL)
+    delete m_pChannels;
+  if (m_pMappedFile != NULL)
+    delete m_pMappedFile;
+}
+
+void Motion::AllocatePostures()
+{
+  m_pPostures = new Posture[m_NumFrames];
+  m_pPostureData = new vector[3 * m_NumBones * m_NumFrames];
+  for (int frame = 0; frame < m_NumFrames; frame++)
+    m_pPostures[frame].Attach(m_NumBones, &m_pPostureData[3 * m_NumBones * frame]);
+}
+
+void Motion::ResizePostures(int numFrames)
+{
+  Posture * pPostures = new Posture[numFrames];
+  vector * pPostureData = new vector[3 * m_NumBones * numFrames];
+  for (int frame = 0; frame < numFrames; frame++)
+  {
+    pPostures[frame].Attach(m_NumBones, &pPostureData[3 * m_NumBones * frame]);
+    if (frame < m_NumFrames)
+      pPostures[frame] = m_pPostures[frame];
+    else
+      pPostures[frame].SetToZero();
+  }
+
+  if (m_pPostures != NULL)
+    delete [] m_pPostures;
+  if (m_pPostureData != NULL)
+    delete [] m_pPostureData;
+
+  m_pPostures = pPostures;
+  m_pPostureData = pPostureData;
+  m_NumFrames = numFrames;
+}
+
+void Motion::UpdatePostures()
+{
+  if (m_PosturesValid)
+    return;
+
+  if (m_pPostures == NULL)
+  {
+    AllocatePostures();
+    for (int frame = 0; frame < m_NumFrames; frame++)
+      m_pPostures[frame].SetToZero();
+  }
+
+  if (m_pChannels != NULL)
+  {
+    for (int frame = 0; frame < m_NumFrames; frame++)
+      m_pChannels->GetPosture(frame, m_pPostures[frame]);
+  }
+  m_PosturesValid = 1;
+}
+
+void Motion::UpdateChannels()
+{
+  if (m_ChannelsValid)
+    return;
+
+  if (m_pChannels == NULL)
+    m_pChannels = new MotionChannels(m_NumFrames, m_NumBones);
+
+  if (m_pPostures != NULL)
+  {
+    for (int frame = 0; frame < m_NumFrames; frame++)
+      m_pChannels->SetPosture(frame, m_pPostures[frame]);
+  }
+  m_ChannelsValid = 1;
+}
+
+MotionChannels * Motion::GetChannels()
+{
+  UpdateChannels();
+  return m_pChannels;
 }
 
 //Set all postures to default posture
 void Motion::SetPosturesToDefault()
 {
+  if (m_pPostures == NULL)
+    AllocatePostures();
+
   for (int frame = 0; frame<m_NumFrames; frame++)
   {
-    //set root position to (0,0,0)
-    m_pPostures[frame].root_pos.setValue(0.0, 0.0, 0.0);
-    //set each bone orientation to (0,0,0)
-    for (int j = 0; j < MAX_BONES_IN_ASF_FILE; j++)
-      m_pPostures[frame].bone_rotation[j].setValue(0.0, 0.0, 0.0);
+    //set root position and each bone orientation to (0,0,0)
+    m_pPostures[frame].SetToZero();
 
   }
+  m_PosturesValid = 1;
+  m_ChannelsValid = 0;
 }
 
 //Set posture at spesified frame
-void Motion::SetPosture(int frameIndex, Posture InPosture)
+void Motion::SetPosture(int frameIndex, const Posture & InPosture)
 {
+  UpdatePostures();
   m_pPostures[frameIndex] = InPosture; 	
+  m_ChannelsValid = 0;
 }
 
 void Motion::SetBoneRotation(int frameIndex, int boneIndex, vector vRot)
 {
+  UpdatePostures();
   m_pPostures[frameIndex].bone_rotation[boneIndex] = vRot;
+  m_ChannelsValid = 0;
 }
 
 void Motion::SetRootPos(int frameIndex, vector vPos)
 {
+  UpdatePostures();
   m_pPostures[frameIndex].root_pos = vPos;
+  m_ChannelsValid = 0;
 }
 
 Posture * Motion::GetPosture(int frameIndex)
@@ -82,204 +217,240 @@ Posture * Motion::GetPosture(int frameIndex)
     printf("m_NumFrames = %d\n", m_NumFrames);
     exit(0);
   }
+  UpdatePostures();
   return &(m_pPostures[frameIndex]);
 }
 
-int Motion::readAMCfile(char* name, double scale)
+int Motion::readAMCfile(char* name, double scale, ThreadPool * pThreadPool, int quiet)
 {
-  Bone *hroot, *bone;
-  bone = hroot = pSkeleton->getRoot();
-
-  std::ifstream file( name, std::ios::in );
-  if( file.fail() ) 
+  MappedFile file;
+  if (file.Open(name) != 0)
     return -1;
 
-  int n=0;
-  char str[2048];
+  const char * p = file.GetData();
+  const char * end = p + file.GetSize();
 
-  // count the number of lines
-  while(!file.eof())  
+  // process the header (the frames list all rotational DOFs if requested)
+  int forceAllJointsBe3DOF;
+  p = AMCParser::ParseHeader(p, end, &forceAllJointsBe3DOF);
+  if (p == NULL)
   {
-    file.getline(str, 2048);
-    if(file.eof()) break;
-    //We do not want to count empty lines
-    if (strcmp(str, "") != 0)
-      n++;
+    printf("Error: no :DEGREES line in the header of '%s'.\n", name);
+    return -1;
   }
+  AMCParser parser(pSkeleton, scale, forceAllJointsBe3DOF);
 
-  file.close();
+  if ((pThreadPool != NULL) && (pThreadPool->GetNumThreads() > 1))
+  {
+    // Locate the frames, and parse them in chunks on the thread pool.
+    // Each frame must end exactly where the next one starts; otherwise, the
+    // frame lines are not well-formed, and the file is parsed serially below
+    // (which reports the error, if any; the parallel attempt is quiet).
+    std::vector<const char *> frames;
+    AMCParser::FindFrames(p, end, frames, pThreadPool);
+    int n = (int)frames.size();
+
+    m_NumFrames = 0;
+    ResizePostures(n);
+
+    int numChunks = 4 * pThreadPool->GetNumThreads();
+    std::atomic<int> consistent(1);
+    pThreadPool->ParallelFor(numChunks, [&](int chunk)
+    {
+      int chunkStart = (int)((long)n * chunk / numChunks);
+      int chunkEnd = (int)((long)n * (chunk + 1) / numChunks);
+      std::vector<int> boneOrder(parser.GetNumBones(), -1);
+      for(int i = chunkStart; (i < chunkEnd) && consistent; i++)
+      {
+        int frame_num;
+        const char * frameEnd = parser.ParseFrame(frames[i], end, m_pPostures[i], &frame_num, boneOrder.data(), 1);
+        const char * nextFrame = (i + 1 < n) ? frames[i + 1] : end;
+        if (frameEnd != nextFrame)
+          consistent = 0;
+      }
+    });
 
-  //Compute number of frames. 
-  //Subtract 3 to  ignore the header
-  //There are (NUM_BONES_IN_ASF_FILE - 2) moving bones and 2 dummy bones (lhipjoint and rhipjoint)
-  int numbones = pSkeleton->numBonesInSkel(bone[0]);
-  int movbones = pSkeleton->movBonesInSkel(bone[0]);
-  n = (n-3)/((movbones) + 1);   
+    if (consistent && (AMCParser::SkipWhitespace(p, end) == ((n > 0) ? frames[0] : end)))
+    {
+      m_PosturesValid = 1;
+      m_ChannelsValid = 0;
+      if (!quiet)
+        printf("%d samples in '%s' are read.\n", n, name);
+      return n;
+    }
 
-  m_NumFrames = n;
+    delete [] m_pPostures;
+    delete [] m_pPostureData;
+    m_pPostures = NULL;
+    m_pPostureData = NULL;
+  }
 
-  //Allocate memory for state vector
-  m_pPostures = new Posture[m_NumFrames]; 
+  // The frames are read in a single pass. The storage starts with a single frame;
+  // after the first frame, the number of frames is estimated from its size, and
+  // the storage is grown as needed (and trimmed at the end).
+  m_NumFrames = 0;
+  ResizePostures(1);
 
-  //Set all postures to default posture
-  SetPosturesToDefault();
+  int n = 0;
+  std::vector<int> boneOrder(parser.GetNumBones(), -1);
+  const char * firstFrame = AMCParser::SkipWhitespace(p, end);
+  p = firstFrame;
+  while (p < end)
+  {
+    if (n == m_NumFrames)
+    {
+      int numFrames = m_NumFrames + m_NumFrames / 2 + 16;
+      if (n == 1)
+        numFrames = (int)((end - firstFrame) / (p - firstFrame)) + 16;
+      ResizePostures(numFrames);
+    }
 
-  file.open(name);
+    int frame_num;
+    p = parser.ParseFrame(p, end, m_pPostures[n], &frame_num, boneOrder.data());
+    if (p == NULL)
+    {
+      printf("Error: failed to parse frame %d of '%s'.\n", n + 1, name);
+      return -1;
+    }
+    n++;
+    p = AMCParser::SkipWhitespace(p, end);
+  }
 
-  // process the header (add rotational DOFs to skeleton if requested)
-  while (1) 
-  {
-    file >> str;
+  ResizePostures(n);
+  m_PosturesValid = 1;
+  m_ChannelsValid = 0;
+
+  if (!quiet)
+    printf("%d samples in '%s' are read.\n", n, name);
+  return n;
+}
 
-    if(strcmp(str, ":FORCE-ALL-JOINTS-BE-3DOF") == 0) 
-      pSkeleton->enableAllRotationalDOFs();
+int Motion::writeAMCfile(char * filename, double scale, int forceAllJointsBe3DOF, int quiet)
+{
+  AMCWriter writer(pSkeleton, scale);
+  if (writer.Open(filename, forceAllJointsBe3DOF) != 0)
+    return -1;
 
-    if(strcmp(str, ":DEGREES") == 0) 
-      break;
-  }
+  UpdatePostures();
 
-  for(int i=0; i<m_NumFrames; i++)
+  for(int f=0; f < m_NumFrames; f++)
+    writer.WriteFrame(f+1, m_pPostures[f]);
+
+  if (writer.Close() != 0)
   {
-    //read frame number
-    int frame_num;
-    file >> frame_num;
+    printf("Error writing '%s'.\n", filename);
+    return -1;
+  }
 
-    //There are (NUM_BONES_IN_ASF_FILE - 2) movable bones and 2 dummy bones (lhipjoint and rhipjoint)
-    for(int j=0; j<movbones; j++)
-    {
-      //read bone name
-      file >> str;
+  if (!quiet)
+    printf("Write %d samples to '%s' \n", m_NumFrames, filename);
+  return 0;
+}
 
-      //fine the bone index corresponding to the bone name
-      int bone_idx; 
-      for( bone_idx = 0; bone_idx < numbones; bone_idx++ )
-        if( strcmp( str, pSkeleton->idx2name(bone_idx) ) == 0 ) 
-          break;
+int Motion::readAMCBfile(char* name, double scale, int quiet)
+{
+  MappedFile * pFile = new MappedFile();
+  // writable: the channels are modified in place (the changes are private to this process)
+  if (pFile->Open(name, 1) != 0)
+  {
+    printf("Error: cannot open %s.\n", name);
+    delete pFile;
+    return -1;
+  }
 
-      //init rotation angles for this bone to (0, 0, 0)
-      m_pPostures[i].bone_rotation[bone_idx].setValue(0.0, 0.0, 0.0);
+  AMCBHeader header;
+  if (pFile->GetSize() < sizeof(AMCBHeader))
+  {
+    printf("Error: %s is not an AMCB file.\n", name);
+    delete pFile;
+    return -1;
+  }
+  memcpy(&header, pFile->GetData(), sizeof(AMCBHeader));
+  if (AMCBFile::CheckHeader(header, pFile->GetSize(), pSkeleton, name) != 0)
+  {
+    delete pFile;
+    return -1;
+  }
 
-      for(int x = 0; x < bone[bone_idx].dof; x++)
-      {
-        double tmp;
-        file >> tmp;
-        //	printf("%d %f\n",bone[bone_idx].dofo[x],tmp);
-        switch (bone[bone_idx].dofo[x]) 
-        {
-        case 0:
-          printf("FATAL ERROR in bone %d not found %d\n",bone_idx,x);
-          x = bone[bone_idx].dof;
-          break;
-        case 1:
-          m_pPostures[i].bone_rotation[bone_idx].p[0] = tmp;
-          break;
-        case 2:
-          m_pPostures[i].bone_rotation[bone_idx].p[1] = tmp;
-          break;
-        case 3:
-          m_pPostures[i].bone_rotation[bone_idx].p[2] = tmp;
-          break;
-        case 4:
-          m_pPostures[i].bone_translation[bone_idx].p[0] = tmp * scale;
-          break;
-        case 5:
-          m_pPostures[i].bone_translation[bone_idx].p[1] = tmp * scale;
-          break;
-        case 6:
-          m_pPostures[i].bone_translation[bone_idx].p[2] = tmp * scale;
-          break;
-        case 7:
-          m_pPostures[i].bone_length[bone_idx].p[0] = tmp;// * scale;
-          break;
-        }
-      }
-      if( strcmp( str, "root" ) == 0 ) 
-      {
-        m_pPostures[i].root_pos.p[0] = m_pPostures[i].bone_translation[0].p[0];// * scale;
-        m_pPostures[i].root_pos.p[1] = m_pPostures[i].bone_translation[0].p[1];// * scale;
-        m_pPostures[i].root_pos.p[2] = m_pPostures[i].bone_translation[0].p[2];// * scale;
-      }
+  m_NumFrames = header.numFrames;
+  char * data = pFile->GetData() + header.dataOffset;
+  if (header.valueType == AMCB_DOUBLE)
+  {
+    // use the mapped arrays directly
+    m_pChannels = new MotionChannels(m_NumFrames, m_NumBones, (double*) data);
+    m_pMappedFile = pFile;
+  }
+  else
+  {
+    m_pChannels = new MotionChannels(m_NumFrames, m_NumBones);
+    const float * values = (const float*) data;
+    double * channelData = m_pChannels->GetData();
+    long numValues = (long)m_pChannels->GetNumChannels() * m_NumFrames;
+    for(long i = 0; i < numValues; i++)
+      channelData[i] = values[i];
+    delete pFile;
+  }
 
-      // read joint angles, including root orientation
+  if (header.scale != scale)
+  {
+    double factor = scale / header.scale;
+    for(int axis = 0; axis < 3; axis++)
+    {
+      double * channel = m_pChannels->GetRootChannel(axis);
+      for(int frame = 0; frame < m_NumFrames; frame++)
+        channel[frame] *= factor;
     }
   }
 
-  file.close();
-  printf("%d samples in '%s' are read.\n", n, name);
-  return n;
+  m_PosturesValid = 0;
+  m_ChannelsValid = 1;
+
+  if (!quiet)
+    printf("%d samples in '%s' are read.\n", m_NumFrames, name);
+  return m_NumFrames;
 }
 
-int Motion::writeAMCfile(char * filename, double scale, int forceAllJointsBe3DOF)
+int Motion::writeAMCBfile(char * filename, double scale, int forceAllJointsBe3DOF, int valueType, double frameRate, int quiet)
 {
-  Bone * bone = pSkeleton->getRoot();
-
-  std::ofstream os(filename);
-  if(os.fail()) 
+  FILE * file = fopen(filename, "wb");
+  if (file == NULL)
     return -1;
 
-  // header lines
-  os << ":FULLY-SPECIFIED" << std::endl;
-  if (forceAllJointsBe3DOF)
-    os << ":FORCE-ALL-JOINTS-BE-3DOF" << std::endl;
-  os << ":DEGREES" << std::endl;
+  UpdateChannels();
 
-  int numbones = pSkeleton->numBonesInSkel(bone[0]);
+  AMCBHeader header;
+  AMCBFile::InitHeader(&header, pSkeleton, m_NumFrames, valueType, scale, frameRate, forceAllJointsBe3DOF ? AMCB_FORCE_ALL_JOINTS_BE_3DOF : 0);
 
-  int root = Skeleton::getRootIndex();
-  for(int f=0; f < m_NumFrames; f++)
+  int error = (fwrite(&header, sizeof(AMCBHeader), 1, file) != 1);
+
+  const double * channelData = m_pChannels->GetData();
+  long numValues = (long)m_pChannels->GetNumChannels() * m_NumFrames;
+  if (valueType == AMCB_FLOAT)
   {
-    os << f+1 << std::endl;
-    os << "root " 
-       << m_pPostures[f].root_pos.p[0] / scale << " " 
-       << m_pPostures[f].root_pos.p[1] / scale << " " 
-       << m_pPostures[f].root_pos.p[2] / scale << " " 
-       << m_pPostures[f].bone_rotation[root].p[0] << " " 
-       << m_pPostures[f].bone_rotation[root].p[1] << " " 
-       << m_pPostures[f].bone_rotation[root].p[2] ;
-
-    for(int j = 2; j < numbones; j++) 
+    // convert in blocks
+    const long blockSize = 16384;
+    float block[blockSize];
+    for(long start = 0; (start < numValues) && !error; start += blockSize)
     {
-      //output bone name
-      if(bone[j].dof != 0)
-      {
-        os << std::endl << pSkeleton->idx2name(j);
-
-        //output bone rotation angles
-        for(int d=0; d<bone[j].dof; d++)
-        {
-          // traverse all DOFs
-
-          // is this DOF rx ?
-          if (bone[j].dofo[d] == 1)
-          {
-            // if enabled, output the DOF
-            if(bone[j].dofrx == 1) 
-              os << " " << m_pPostures[f].bone_rotation[j].p[0];
-          }
-
-          // is this DOF ry ?
-          if (bone[j].dofo[d] == 2)
-          {
-            // if enabled, output the DOF
-            if(bone[j].dofry == 1) 
-              os << " " << m_pPostures[f].bone_rotation[j].p[1];
-          }
-
-          // is this DOF rz ?
-          if (bone[j].dofo[d] == 3)
-          {
-            // if enabled, output the DOF
-            if(bone[j].dofrz == 1) 
-              os << " " << m_pPostures[f].bone_rotation[j].p[2];
-          }
-        }
-      }
+      long count = (numValues - start < blockSize) ? numValues - start : blockSize;
+      for(long i = 0; i < count; i++)
+        block[i] = (float) channelData[start + i];
+      error = (fwrite(block, sizeof(float), count, file) != (size_t)count);
     }
-    os << std::endl;
   }
+  else if (!error && (numValues > 0))
+    error = (fwrite(channelData, sizeof(double), numValues, file) != (size_t)numValues);
+
+  if (fclose(file) != 0)
+    error = 1;
 
-  os.close();
-  printf("Write %d samples to '%s' \n", m_NumFrames, filename);
+  if (error)
+  {
+    printf("Error writing '%s'.\n", filename);
+    return -1;
+  }
+
+  if (!quiet)
+    printf("Write %d samples to '%s' \n", m_NumFrames, filename);
   return 0;
 }
-
@@ -17,21 +17,42 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb 2012
 #ifndef _MOTION_H_
 #define _MOTION_H_
 
+#include <stddef.h>
 #include "vector.h"
 #include "types.h"
 #include "posture.h"
 #include "skeleton.h"
+#include "motionChannels.h"
+#include "amcbFile.h"
+
+class ThreadPool;
+class MappedFile;
 
 class Motion 
 {
   //function members
 public:
 
+  // The loaders do not modify the skeleton, so several motions can be loaded with one skeleton at the same time.
+  // Files with :FORCE-ALL-JOINTS-BE-3DOF list all rotational DOFs of the bones; to use them (e.g., to interpolate
+  // or display them), call pSkeleton->enableAllRotationalDOFs() once, before the skeleton is shared.
+  // With quiet = 1, the loaders and the writers print error messages only (not the number of samples).
+
   // parse AMC file (default scale=0.06)
-  Motion(char *amc_filename, double scale, Skeleton * pSkeleton);
+  // if pThreadPool is given, the file is split at the frame number lines, and the frames are parsed in parallel
+  // (the result is identical to parsing the file serially)
+  Motion(char *amc_filename, double scale, const Skeleton * pSkeleton, ThreadPool * pThreadPool=NULL, int quiet=0);
 
   //Use to create default motion with specified number of frames
-  Motion(int numFrames, Skeleton * pSkeleton);
+  Motion(int numFrames, const Skeleton * pSkeleton);
+
+  //Load a binary motion file (.amcb, see amcbFile.h)
+  //The file is memory-mapped, and its channel arrays are used in place (when stored as doubles).
+  //Root positions stored with a different scale are rescaled to scale.
+  Motion(char *amcb_filename, const Skeleton * pSkeleton, double scale, int quiet=0);
+
+  //Create a motion backed by channel (structure-of-arrays) storage; the motion takes ownership of pChannels
+  Motion(MotionChannels * pChannels, const Skeleton * pSkeleton);
 
   ~Motion();
 
@@ -39,14 +60,19 @@ public:
   // the value of scale should be consistent with the scale parameter used in Skeleton()
   // forceAllJointsBe3DOF should be set to 0; use 1 to signal that the file contains three Euler
   // angles for all the joints, even those that are 1-dimensional or 2-dimensional (advanced usage)
-  int writeAMCfile(char* filename, double scale, int forceAllJointsBe3DOF=0);
+  int writeAMCfile(char* filename, double scale, int forceAllJointsBe3DOF=0, int quiet=0);
+
+  // write a binary motion file (.amcb, see amcbFile.h)
+  // valueType is AMCB_DOUBLE or AMCB_FLOAT (smaller file, but loading requires a conversion)
+  // scale and forceAllJointsBe3DOF are stored in the file; frameRate is stored for other tools
+  int writeAMCBfile(char* filename, double scale, int forceAllJointsBe3DOF=0, int valueType=AMCB_DOUBLE, double frameRate=AMCB_DEFAULT_FRAME_RATE, int quiet=0);
 
   //Set all postures to default posture
   //Root position at (0,0,0), orientation of each bone to (0,0,0)
   void SetPosturesToDefault();
 
   //Set the entire posture at specified frame (posture = root position and all bone rotations)
-  void SetPosture(int frameIndex, Posture InPosture);
+  void SetPosture(int frameIndex, const Posture & InPosture);
 
   //Set root position at specified frame
   void SetRootPos(int frameIndex, vector vPos);
@@ -54,18 +80,48 @@ public:
   void SetBoneRotation(int frameIndex, int boneIndex, vector vRot);
 
   int GetNumFrames() { return m_NumFrames; }
+  //Number of bones in each posture (equal to the number of bones in the skeleton)
+  int GetNumBones() { return m_NumBones; }
   Posture * GetPosture(int frameIndex);
 
-  Skeleton * GetSkeleton() { return pSkeleton; }
+  const Skeleton * GetSkeleton() { return pSkeleton; }
+
+  //The motion is stored in one or both of two layouts: postures (one Posture per frame, see GetPosture), 
+  //and channels (one contiguous array of frames per degree of freedom, see motionChannels.h).
+  //A layout is (re)built from the other one when it is first accessed after a modification.
+
+  //Get the channel layout of the motion. If the channels are modified, call ChannelsModified() afterwards.
+  MotionChannels * GetChannels();
+  void ChannelsModified() { m_PosturesValid = 0; }
+  //If the postures returned by GetPosture are modified directly, call PosturesModified() afterwards.
+  void PosturesModified() { m_ChannelsValid = 0; }
+  //Bring the posture / channel layout up to date. GetPosture and GetChannels do this automatically,
+  //but it should be called explicitly before several threads access the motion.
+  void UpdatePostures();
+  void UpdateChannels();
 
 protected:
   int m_NumFrames; //number of frames in the motion 
-  Skeleton * pSkeleton;
+  int m_NumBones; //number of bones in the skeleton
+  const Skeleton * pSkeleton;
   //Root position and all bone rotation angles for each frame (as read from AMC file)
   Posture * m_pPostures; 
+  //Per-bone storage for all postures (3 * m_NumBones vectors per frame), referenced by m_pPostures
+  vector * m_pPostureData;
+  //Channel layout of the motion (NULL until first used)
+  MotionChannels * m_pChannels;
+  int m_PosturesValid, m_ChannelsValid; // whether each layout holds the current motion
+  //Memory-mapped AMCB file that m_pChannels points into (NULL if the channels are not mapped)
+  MappedFile * m_pMappedFile;
+
+  //Allocate m_NumFrames postures sized to the skeleton
+  void AllocatePostures();
+  //Change the number of postures to numFrames, keeping the existing frames; new frames are set to the default posture
+  void ResizePostures(int numFrames);
 
   // The default value is 0.06
-  int readAMCfile(char* name, double scale);
+  int readAMCfile(char* name, double scale, ThreadPool * pThreadPool=NULL, int quiet=0);
+  int readAMCBfile(char* name, double scale, int quiet=0);
 };
 
 #endif
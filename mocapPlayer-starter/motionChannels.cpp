@@ -0,0 +1,66 @@
+/*
+motionChannels.cpp
+
+Structure-of-arrays storage for a motion.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "skeleton.h"
+#include "motionChannels.h"
+
+MotionChannels::MotionChannels(int numFrames_, int numBones_)
+{
+  m_NumFrames = numFrames_;
+  m_NumBones = numBones_;
+  m_pData = new double[(long)GetNumChannels() * m_NumFrames];
+  m_OwnsData = 1;
+  SetToZero();
+}
+
+MotionChannels::MotionChannels(int numFrames_, int numBones_, double * data)
+{
+  m_NumFrames = numFrames_;
+  m_NumBones = numBones_;
+  m_pData = data;
+  m_OwnsData = 0;
+}
+
+MotionChannels::~MotionChannels()
+{
+  if (m_OwnsData)
+    delete [] m_pData;
+}
+
+void MotionChannels::SetToZero()
+{
+  long numValues = (long)GetNumChannels() * m_NumFrames;
+  for(long i = 0; i < numValues; i++)
+    m_pData[i] = 0.0;
+}
+
+void MotionChannels::GetPosture(int frameIndex, Posture & posture) const
+{
+  for(int axis = 0; axis < 3; axis++)
+    posture.root_pos.p[axis] = GetChannel(RootChannel(axis))[frameIndex];
+
+  int numBones = (posture.GetNumBones() < m_NumBones) ? posture.GetNumBones() : m_NumBones;
+  for(int bone = 0; bone < numBones; bone++)
+    for(int axis = 0; axis < 3; axis++)
+      posture.bone_rotation[bone].p[axis] = GetChannel(BoneChannel(bone, axis))[frameIndex];
+
+  if (numBones > 0)
+    posture.bone_translation[Skeleton::getRootIndex()] = posture.root_pos;
+}
+
+void MotionChannels::SetPosture(int frameIndex, const Posture & posture)
+{
+  for(int axis = 0; axis < 3; axis++)
+    GetChannel(RootChannel(axis))[frameIndex] = posture.root_pos.p[axis];
+
+  int numBones = (posture.GetNumBones() < m_NumBones) ? posture.GetNumBones() : m_NumBones;
+  for(int bone = 0; bone < numBones; bone++)
+    for(int axis = 0; axis < 3; axis++)
+      GetChannel(BoneChannel(bone, axis))[frameIndex] = posture.bone_rotation[bone].p[axis];
+}
+
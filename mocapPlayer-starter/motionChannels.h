@@ -0,0 +1,67 @@
+/*
+motionChannels.h
+
+Structure-of-arrays storage for a motion.
+
+Each degree of freedom (root x, y, z, and rx, ry, rz of each bone) is kept 
+as its own contiguous array of frames, so that per-channel operations 
+(interpolation, filtering, export) can stream one channel at a time.
+
+Channel layout:
+  channel 0, 1, 2: root position x, y, z
+  channel 3 + 3 * bone + axis: rotation angle of bone around axis (0=x, 1=y, 2=z)
+Channels are stored one after another; each channel holds numFrames values.
+*/
+
+#ifndef _MOTIONCHANNELS_H_
+#define _MOTIONCHANNELS_H_
+
+#include "posture.h"
+
+class MotionChannels
+{
+public:
+  // allocates (and owns) the storage for numFrames frames of a skeleton with numBones bones; all values are set to 0
+  MotionChannels(int numFrames, int numBones);
+  // uses external storage of GetNumChannels(numBones) * numFrames values, laid out as described above; 
+  // the storage is not freed by this class
+  MotionChannels(int numFrames, int numBones, double * data);
+  ~MotionChannels();
+
+  int GetNumFrames() const { return m_NumFrames; }
+  int GetNumBones() const { return m_NumBones; }
+  int GetNumChannels() const { return GetNumChannels(m_NumBones); }
+  static int GetNumChannels(int numBones) { return 3 + 3 * numBones; }
+
+  // channel index of root position (axis = 0, 1, 2 for x, y, z)
+  static int RootChannel(int axis) { return axis; }
+  // channel index of bone rotation angle (axis = 0, 1, 2 for rx, ry, rz)
+  static int BoneChannel(int bone, int axis) { return 3 + 3 * bone + axis; }
+
+  // pointer to the numFrames contiguous values of a channel
+  double * GetChannel(int channel) { return m_pData + (long)channel * m_NumFrames; }
+  const double * GetChannel(int channel) const { return m_pData + (long)channel * m_NumFrames; }
+  double * GetRootChannel(int axis) { return GetChannel(RootChannel(axis)); }
+  double * GetBoneChannel(int bone, int axis) { return GetChannel(BoneChannel(bone, axis)); }
+
+  // all channels, one after another
+  double * GetData() { return m_pData; }
+
+  // gather root position and bone rotations of a frame into a posture (posture must have GetNumBones() bones)
+  // the root translation (bone_translation of the root) is set to the root position, as done by the AMC reader
+  void GetPosture(int frameIndex, Posture & posture) const;
+  // scatter root position and bone rotations of a posture into a frame
+  void SetPosture(int frameIndex, const Posture & posture);
+
+  // set all channels to 0
+  void SetToZero();
+
+protected:
+  int m_NumFrames;
+  int m_NumBones;
+  double * m_pData;
+  int m_OwnsData;
+};
+
+#endif
+
@@ -0,0 +1,452 @@
+/*
+motionCodec.cpp
+
+Lossy compressed motion file format (.amcz).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "motionCodec.h"
+#include "motionSampler.h"
+#include "amcbFile.h"
+#include "mappedFile.h"
+#include "quaternionBatch.h"
+
+static_assert(sizeof(AMCZHeader) == 120, "the AMCZ header must be 120 bytes");
+
+#define QUANTIZATION_MAX 65535 // 16 bits
+#define SMALLEST_THREE_MAX 32767 // 15 bits
+#define SMALLEST_THREE_RANGE 0.70710678118654752 // 1 / sqrt(2)
+#define KEYFRAME_ROOT_SIZE 6 // bytes of a root position
+#define KEYFRAME_ROTATION_SIZE 6 // bytes of a bone rotation
+
+// quantization of a value in [minimum, minimum + QUANTIZATION_MAX * step]
+static inline unsigned int Quantize(double value, double minimum, double step)
+{
+  if (step <= 0.0)
+    return 0;
+  double q = floor((value - minimum) / step + 0.5);
+  return (q <= 0.0) ? 0 : ((q >= QUANTIZATION_MAX) ? QUANTIZATION_MAX : (unsigned int)q);
+}
+
+static void ComputeRange(double minimum, double maximum, double * step)
+{
+  *step = (maximum > minimum) ? (maximum - minimum) / QUANTIZATION_MAX : 0.0;
+}
+
+static inline void Write16(unsigned char * p, unsigned int value)
+{
+  p[0] = (unsigned char)(value & 0xff);
+  p[1] = (unsigned char)(value >> 8);
+}
+
+static inline unsigned int Read16(const unsigned char * p)
+{
+  return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static inline void Write48(unsigned char * p, unsigned long long value)
+{
+  for(int i=0; i<6; i++)
+    p[i] = (unsigned char)((value >> (8 * i)) & 0xff);
+}
+
+static inline unsigned long long Read48(const unsigned char * p)
+{
+  unsigned long long value = 0;
+  for(int i=0; i<6; i++)
+    value |= (unsigned long long)p[i] << (8 * i);
+  return value;
+}
+
+// smallest three: bits 45-46: index of the largest component; bits 30-44, 15-29, 0-14: the other components, in order
+static unsigned long long PackQuaternion(double s, double x, double y, double z)
+{
+  double q[4] = { s, x, y, z };
+  int largest = 0;
+  for(int i=1; i<4; i++)
+    if (fabs(q[i]) > fabs(q[largest]))
+      largest = i;
+  double sign = (q[largest] < 0.0) ? -1.0 : 1.0;
+
+  unsigned long long value = (unsigned long long)largest;
+  for(int i=0; i<4; i++)
+  {
+    if (i == largest)
+      continue;
+    double c = floor((sign * q[i] + SMALLEST_THREE_RANGE) * (SMALLEST_THREE_MAX / (2.0 * SMALLEST_THREE_RANGE)) + 0.5);
+    unsigned int quantized = (c <= 0.0) ? 0 : ((c >= SMALLEST_THREE_MAX) ? SMALLEST_THREE_MAX : (unsigned int)c);
+    value = (value << 15) | quantized;
+  }
+  return value;
+}
+
+static void UnpackQuaternion(unsigned long long value, double q[4])
+{
+  int largest = (int)((value >> 45) & 3);
+  double sum = 0.0;
+  int shift = 30;
+  for(int i=0; i<4; i++)
+  {
+    if (i == largest)
+      continue;
+    unsigned int quantized = (unsigned int)((value >> shift) & SMALLEST_THREE_MAX);
+    q[i] = quantized * (2.0 * SMALLEST_THREE_RANGE / SMALLEST_THREE_MAX) - SMALLEST_THREE_RANGE;
+    sum += q[i] * q[i];
+    shift -= 15;
+  }
+  q[largest] = (sum < 1.0) ? sqrt(1.0 - sum) : 0.0;
+}
+
+size_t MotionCodec::Encode(Motion * pMotion, int numKeyframes, const int * keyframes,
+  InterpolationType interpolationType, AngleRepresentation angleRepresentation, unsigned char ** data)
+{
+  *data = NULL;
+  const Skeleton * pSkeleton = pMotion->GetSkeleton();
+  int numFrames = pMotion->GetNumFrames();
+  int numActiveBones = pSkeleton->getNumActiveBones();
+  int valid = ((numKeyframes >= 1) || (numFrames == 0)) && (numKeyframes <= numFrames) &&
+    !((interpolationType == SQUAD) && (angleRepresentation != QUATERNION));
+  for(int i=0; (i<numKeyframes) && valid; i++)
+    valid = (keyframes[i] >= ((i > 0) ? keyframes[i-1] + 1 : 0)) && (keyframes[i] < numFrames);
+  if (!valid)
+  {
+    printf("Error in MotionCodec::Encode: invalid keyframes or interpolation method.\n");
+    return 0;
+  }
+
+  AMCZHeader header;
+  memset(&header, 0, sizeof(AMCZHeader));
+  memcpy(header.magic, "AMCZ", 4);
+  header.version = AMCZ_VERSION;
+  header.byteOrder = AMCB_BYTE_ORDER;
+  header.skeletonHash = AMCBFile::HashSkeleton(pSkeleton);
+  header.numFrames = numFrames;
+  header.numBones = pMotion->GetNumBones();
+  header.numActiveBones = numActiveBones;
+  header.numKeyframes = numKeyframes;
+  header.interpolationType = interpolationType;
+  header.angleRepresentation = angleRepresentation;
+  header.frameRate = AMCB_DEFAULT_FRAME_RATE;
+  header.scale = MOCAP_SCALE;
+
+  // the Euler angles of the keyframes (one array per axis, keyframe after keyframe), and the ranges
+  int numAngles = numKeyframes * numActiveBones;
+  double * anglesBuffer = new double[3 * numAngles];
+  double * angles[3] = { anglesBuffer, anglesBuffer + numAngles, anglesBuffer + 2 * numAngles };
+  double rootMax[3];
+  for(int i=0; i<numKeyframes; i++)
+  {
+    Posture * posture = pMotion->GetPosture(keyframes[i]);
+    double * keyframeAngles[3] = { &angles[0][i * numActiveBones], &angles[1][i * numActiveBones], &angles[2][i * numActiveBones] };
+    Interpolator::GetActiveBoneRotations(pSkeleton, *posture, keyframeAngles);
+    for(int axis=0; axis<3; axis++)
+    {
+      double value = posture->root_pos.p[axis];
+      header.rootMin[axis] = ((i == 0) || (value < header.rootMin[axis])) ? value : header.rootMin[axis];
+      rootMax[axis] = ((i == 0) || (value > rootMax[axis])) ? value : rootMax[axis];
+    }
+  }
+  for(int axis=0; (axis<3) && (numKeyframes > 0); axis++)
+    ComputeRange(header.rootMin[axis], rootMax[axis], &header.rootStep[axis]);
+
+  float * ranges = NULL;
+  int numRangeValues = (angleRepresentation == EULER) ? 2 * 3 * numActiveBones : 0;
+  if (angleRepresentation == EULER)
+  {
+    ranges = new float[numRangeValues];
+    for (int k = 0; k < numActiveBones; k++)
+      for(int axis=0; axis<3; axis++)
+      {
+        double minimum = 0.0, maximum = 0.0;
+        for(int i=0; i<numKeyframes; i++)
+        {
+          double value = angles[axis][i * numActiveBones + k];
+          minimum = ((i == 0) || (value < minimum)) ? value : minimum;
+          maximum = ((i == 0) || (value > maximum)) ? value : maximum;
+        }
+        double step;
+        ComputeRange(minimum, maximum, &step);
+        ranges[2 * (3 * k + axis)] = (float)minimum;
+        ranges[2 * (3 * k + axis) + 1] = (float)step;
+      }
+  }
+
+  // the frames of the keyframes
+  unsigned char * keyframeBytes = new unsigned char[5 * numKeyframes + 1];
+  size_t numKeyframeBytes = 0;
+  for(int i=0; i<numKeyframes; i++)
+  {
+    unsigned int difference = (unsigned int)(keyframes[i] - ((i > 0) ? keyframes[i-1] : 0));
+    while (difference >= 0x80)
+    {
+      keyframeBytes[numKeyframeBytes++] = (unsigned char)((difference & 0x7f) | 0x80);
+      difference >>= 7;
+    }
+    keyframeBytes[numKeyframeBytes++] = (unsigned char)difference;
+  }
+
+  // layout
+  header.rangeOffset = (unsigned int)((sizeof(AMCZHeader) + numKeyframeBytes + 3) / 4 * 4);
+  header.dataOffset = header.rangeOffset + (unsigned int)(numRangeValues * sizeof(float));
+  size_t keyframeSize = KEYFRAME_ROOT_SIZE + KEYFRAME_ROTATION_SIZE * numActiveBones;
+  size_t size = header.dataOffset + keyframeSize * numKeyframes;
+  header.fileSize = (unsigned int)size;
+
+  *data = new unsigned char[size];
+  memset(*data, 0, header.dataOffset);
+  memcpy(*data, &header, sizeof(AMCZHeader));
+  memcpy(*data + sizeof(AMCZHeader), keyframeBytes, numKeyframeBytes);
+  if (numRangeValues > 0)
+    memcpy(*data + header.rangeOffset, ranges, numRangeValues * sizeof(float));
+
+  double * quaternionBuffer = new double[4 * numActiveBones];
+  for(int i=0; i<numKeyframes; i++)
+  {
+    unsigned char * p = *data + header.dataOffset + keyframeSize * i;
+    Posture * posture = pMotion->GetPosture(keyframes[i]);
+    for(int axis=0; axis<3; axis++)
+      Write16(p + 2 * axis, Quantize(posture->root_pos.p[axis], header.rootMin[axis], header.rootStep[axis]));
+    p += KEYFRAME_ROOT_SIZE;
+
+    double * keyframeAngles[3] = { &angles[0][i * numActiveBones], &angles[1][i * numActiveBones], &angles[2][i * numActiveBones] };
+    if (angleRepresentation == EULER)
+    {
+      for (int k = 0; k < numActiveBones; k++, p += KEYFRAME_ROTATION_SIZE)
+        for(int axis=0; axis<3; axis++)
+          Write16(p + 2 * axis, Quantize(keyframeAngles[axis][k], ranges[2 * (3 * k + axis)], ranges[2 * (3 * k + axis) + 1]));
+    }
+    else
+    {
+      double * q[4];
+      GetQuaternionArrays(quaternionBuffer, numActiveBones, q);
+      EulerToQuaternionBatch(numActiveBones, keyframeAngles, q);
+      for (int k = 0; k < numActiveBones; k++, p += KEYFRAME_ROTATION_SIZE)
+        Write48(p, PackQuaternion(q[0][k], q[1][k], q[2][k], q[3][k]));
+    }
+  }
+
+  delete [] quaternionBuffer;
+  delete [] keyframeBytes;
+  delete [] ranges;
+  delete [] anglesBuffer;
+  return size;
+}
+
+int MotionCodec::CheckHeader(const AMCZHeader & header, size_t size, const Skeleton * pSkeleton, const char * name)
+{
+  if ((size < sizeof(AMCZHeader)) || (memcmp(header.magic, "AMCZ", 4) != 0))
+  {
+    printf("Error: %s is not AMCZ data.\n", name);
+    return -1;
+  }
+
+  if (header.byteOrder != AMCB_BYTE_ORDER)
+  {
+    printf("Error: %s was written on a machine with a different byte order.\n", name);
+    return -1;
+  }
+
+  if (header.version != AMCZ_VERSION)
+  {
+    printf("Error: %s has unsupported version %u.\n", name, header.version);
+    return -1;
+  }
+
+  int numBones = pSkeleton->getNumBones();
+  if ((header.numBones != numBones) || (header.numActiveBones != pSkeleton->getNumActiveBones()) ||
+      (header.skeletonHash != AMCBFile::HashSkeleton(pSkeleton)))
+  {
+    printf("Error: %s was written for a different skeleton (%d bones, hash %08x; the skeleton has %d bones, hash %08x).\n",
+      name, header.numBones, header.skeletonHash, numBones, AMCBFile::HashSkeleton(pSkeleton));
+    return -1;
+  }
+
+  size_t numRangeValues = (header.angleRepresentation == EULER) ? 2 * 3 * header.numActiveBones : 0;
+  if ((header.numFrames < 0) || (header.numKeyframes < 0) || (header.numKeyframes > header.numFrames) ||
+      ((header.numKeyframes == 0) && (header.numFrames > 0)) ||
+      ((header.interpolationType != LINEAR) && (header.interpolationType != BEZIER) && (header.interpolationType != SQUAD)) ||
+      ((header.angleRepresentation != EULER) && (header.angleRepresentation != QUATERNION)) ||
+      ((header.interpolationType == SQUAD) && (header.angleRepresentation != QUATERNION)) ||
+      (header.rangeOffset < sizeof(AMCZHeader)) || (header.dataOffset != header.rangeOffset + numRangeValues * sizeof(float)) ||
+      (header.fileSize != header.dataOffset + (size_t)header.numKeyframes * (KEYFRAME_ROOT_SIZE + KEYFRAME_ROTATION_SIZE * header.numActiveBones)))
+  {
+    printf("Error: %s has an invalid header.\n", name);
+    return -1;
+  }
+
+  if (size < header.fileSize)
+  {
+    printf("Error: %s is truncated (%u bytes required, %lu bytes given).\n", name, header.fileSize, (unsigned long)size);
+    return -1;
+  }
+
+  return 0;
+}
+
+int MotionCodec::Decode(const unsigned char * data, size_t size, const Skeleton * pSkeleton, Motion ** pMotion, const char * name)
+{
+  *pMotion = NULL;
+  AMCZHeader header;
+  if (size >= sizeof(AMCZHeader))
+    memcpy(&header, data, sizeof(AMCZHeader));
+  else
+    memset(&header, 0, sizeof(AMCZHeader));
+  if (CheckHeader(header, size, pSkeleton, name) != 0)
+    return -1;
+
+  // the keyframes are encoded (and interpolated) with all rotational DOFs, as in the interpolation of the other motion files;
+  // with the DOFs of the ASF file only, the DOF masks would clear the angles of the 1- and 2-DOF bones that the conversion
+  // from quaternions produces for rotations beyond +-90 degrees
+  if (!pSkeleton->hasAllRotationalDOFs())
+  {
+    printf("Error: %s must be decoded with a skeleton with all rotational DOFs (see Skeleton::enableAllRotationalDOFs).\n", name);
+    return -1;
+  }
+
+  // the frames of the keyframes
+  int numKeyframes = header.numKeyframes;
+  int * keyframes = new int[numKeyframes + 1];
+  const unsigned char * p = data + sizeof(AMCZHeader);
+  const unsigned char * end = data + header.rangeOffset;
+  int valid = 1;
+  for(int i=0; (i<numKeyframes) && valid; i++)
+  {
+    unsigned int difference = 0;
+    int shift = 0;
+    while ((p < end) && (*p & 0x80) && (shift < 28))
+    {
+      difference |= (unsigned int)(*p++ & 0x7f) << shift;
+      shift += 7;
+    }
+    valid = (p < end) && !(*p & 0x80);
+    if (valid)
+      difference |= (unsigned int)(*p++) << shift;
+    long long frame = (long long)((i > 0) ? keyframes[i-1] : 0) + difference;
+    valid = valid && ((i == 0) || (difference > 0)) && (frame < header.numFrames);
+    keyframes[i] = (int)frame;
+  }
+  if (!valid)
+  {
+    printf("Error: %s has invalid keyframes.\n", name);
+    delete [] keyframes;
+    return -1;
+  }
+
+  // the keyframes
+  int numActiveBones = header.numActiveBones;
+  Motion * pOutputMotion = new Motion(header.numFrames, pSkeleton);
+  const float * ranges = (header.angleRepresentation == EULER) ? (const float *)(data + header.rangeOffset) : NULL;
+  size_t keyframeSize = KEYFRAME_ROOT_SIZE + KEYFRAME_ROTATION_SIZE * numActiveBones;
+  double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE], quaternionBuffer[4 * MAX_BONES_IN_ASF_FILE];
+  double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+  double * q[4];
+  GetQuaternionArrays(quaternionBuffer, numActiveBones, q);
+  for(int i=0; i<numKeyframes; i++)
+  {
+    p = data + header.dataOffset + keyframeSize * i;
+    Posture * posture = pOutputMotion->GetPosture(keyframes[i]);
+    for(int axis=0; axis<3; axis++)
+      posture->root_pos.p[axis] = header.rootMin[axis] + header.rootStep[axis] * Read16(p + 2 * axis);
+    p += KEYFRAME_ROOT_SIZE;
+
+    if (ranges != NULL)
+    {
+      for (int k = 0; k < numActiveBones; k++, p += KEYFRAME_ROTATION_SIZE)
+        for(int axis=0; axis<3; axis++)
+          angles[axis][k] = ranges[2 * (3 * k + axis)] + (double)ranges[2 * (3 * k + axis) + 1] * Read16(p + 2 * axis);
+    }
+    else
+    {
+      for (int k = 0; k < numActiveBones; k++, p += KEYFRAME_ROTATION_SIZE)
+      {
+        double quaternion[4];
+        UnpackQuaternion(Read48(p), quaternion);
+        for(int c=0; c<4; c++)
+          q[c][k] = quaternion[c];
+      }
+      QuaternionToEulerBatch(numActiveBones, q, angles);
+    }
+    Interpolator::SetActiveBoneRotations(pSkeleton, angles, *posture);
+  }
+  pOutputMotion->PosturesModified();
+
+  // the frames in between (the sampler reads only the keyframes; with one keyframe, all frames are that keyframe)
+  if (numKeyframes > 0)
+  {
+    MotionSampler sampler(pOutputMotion, numKeyframes, keyframes, (InterpolationType)header.interpolationType,
+      (AngleRepresentation)header.angleRepresentation);
+    int keyframe = 0;
+    for(int frame=0; frame<header.numFrames; frame++)
+    {
+      if ((keyframe < numKeyframes) && (frame == keyframes[keyframe]))
+      {
+        keyframe++;
+        continue;
+      }
+      sampler.Sample(frame, *pOutputMotion->GetPosture(frame));
+    }
+    pOutputMotion->PosturesModified();
+  }
+
+  delete [] keyframes;
+  *pMotion = pOutputMotion;
+  return 0;
+}
+
+int MotionCodec::WriteFile(const char * filename, Motion * pMotion, int numKeyframes, const int * keyframes,
+  InterpolationType interpolationType, AngleRepresentation angleRepresentation)
+{
+  unsigned char * data;
+  size_t size = Encode(pMotion, numKeyframes, keyframes, interpolationType, angleRepresentation, &data);
+  if (size == 0)
+    return -1;
+
+  FILE * file = fopen(filename, "wb");
+  int error = (file == NULL);
+  if (!error)
+  {
+    error = (fwrite(data, 1, size, file) != size);
+    if (fclose(file) != 0)
+      error = 1;
+  }
+  delete [] data;
+
+  if (error)
+  {
+    printf("Error writing '%s'.\n", filename);
+    return -1;
+  }
+
+  printf("Write %d samples (%d keyframes, %lu bytes) to '%s' \n", pMotion->GetNumFrames(), numKeyframes, (unsigned long)size, filename);
+  return 0;
+}
+
+int MotionCodec::ReadFile(const char * filename, const Skeleton * pSkeleton, Motion ** pMotion)
+{
+  *pMotion = NULL;
+  MappedFile file;
+  if (file.Open(filename) != 0)
+  {
+    printf("Error: cannot open %s.\n", filename);
+    return -1;
+  }
+  return Decode((const unsigned char *)file.GetData(), file.GetSize(), pSkeleton, pMotion, filename);
+}
+
+int MotionCodec::IsAMCZFilename(const char * filename)
+{
+  size_t length = strlen(filename);
+  if (length < 5)
+    return 0;
+
+  const char * extension = &filename[length - 5];
+  const char * amcz = ".amcz";
+  for(int i = 0; i < 5; i++)
+    if (tolower((unsigned char)extension[i]) != amcz[i])
+      return 0;
+  return 1;
+}
+
@@ -0,0 +1,92 @@
+/*
+motionCodec.h
+
+Lossy compressed motion file format (.amcz).
+
+An AMCZ file stores only the keyframes of a motion (for example, those chosen by
+KeyframeSelector), quantized; the decoder reconstructs all frames from them with the
+interpolation method that the keyframes were selected for (see MotionSampler).
+
+Quantization (48 bits per bone rotation, 48 bits per root position):
+  root position: 16 bits per coordinate, uniform over the range of the keyframes
+  QUATERNION: the rotation of each active bone as a unit quaternion, "smallest three":
+    the sign is chosen such that the largest component is positive; the index of the
+    largest component (2 bits) and the other three components (15 bits each, in
+    [-1/sqrt(2), 1/sqrt(2)]) are stored; the largest component is
+    sqrt(1 - the sum of the squares of the others); the rotation error is below 0.01 degrees
+  EULER: the Euler angles of each active bone, 16 bits per angle, uniform over the
+    range of the angle at the keyframes (Euler interpolation depends on the angles,
+    not only on the rotation they represent, so they are stored as they are); an angle
+    that spans 360 degrees has an error of up to 0.003 degrees
+Only the rotations of the active bones and the root position are stored; the other
+values of the decoded postures are 0 (as in the CMU motions).
+
+File layout:
+  AMCZHeader (native byte order; 120 bytes)
+  the frames of the keyframes, as differences to the previous keyframe (the first: to frame 0),
+    7 bits per byte, the high bit set in all bytes but the last of a number
+  EULER only, at header.rangeOffset: (minimum, step) of each angle, as float, for the active bones (k * 3 + axis)
+  at header.dataOffset: for each keyframe, the root position (3 x 16 bits), then the
+    rotations of the active bones (6 bytes each; all values little-endian)
+
+The skeleton hash is that of AMCB files (see amcbFile.h).
+*/
+
+#ifndef _MOTIONCODEC_H_
+#define _MOTIONCODEC_H_
+
+#include <stddef.h>
+#include "interpolator.h"
+
+#define AMCZ_VERSION 1
+
+struct AMCZHeader
+{
+  char magic[4]; // "AMCZ"
+  unsigned int version; // AMCZ_VERSION
+  unsigned int byteOrder; // AMCB_BYTE_ORDER, as stored by the writer
+  unsigned int skeletonHash;
+  int numFrames;
+  int numBones;
+  int numActiveBones;
+  int numKeyframes;
+  int interpolationType; // InterpolationType used for decoding
+  int angleRepresentation; // AngleRepresentation used for decoding; also selects the rotation quantization
+  double frameRate; // frames per second
+  double scale; // scale of the root positions (which are stored in skeleton units)
+  double rootMin[3]; // root position = rootMin + rootStep * quantized value
+  double rootStep[3];
+  unsigned int rangeOffset; // offset of the Euler angle ranges from the start of the file
+  unsigned int dataOffset; // offset of the keyframe data
+  unsigned int fileSize;
+  unsigned int reserved;
+};
+
+class MotionCodec
+{
+public:
+  // encodes the keyframes (numKeyframes >= 1 frames of pMotion, strictly increasing; 0 for an empty motion) of pMotion,
+  // to be reconstructed with the interpolation method; *data is allocated (the caller deletes it with delete [])
+  // returns the size of the data in bytes, and 0 on invalid keyframes (*data is then NULL; an error message is printed)
+  static size_t Encode(Motion * pMotion, int numKeyframes, const int * keyframes,
+    InterpolationType interpolationType, AngleRepresentation angleRepresentation, unsigned char ** data);
+
+  // decodes the data of Encode, for the skeleton the motion was encoded with; *pMotion is allocated
+  // the skeleton is not modified; all its rotational DOFs must be enabled (Skeleton::enableAllRotationalDOFs)
+  // returns 0 on success, and -1 on invalid data (an error message, mentioning name, is printed)
+  static int Decode(const unsigned char * data, size_t size, const Skeleton * pSkeleton, Motion ** pMotion, const char * name = "AMCZ data");
+
+  // Encode / Decode to / from a file; return 0 on success, and -1 otherwise
+  static int WriteFile(const char * filename, Motion * pMotion, int numKeyframes, const int * keyframes,
+    InterpolationType interpolationType, AngleRepresentation angleRepresentation);
+  static int ReadFile(const char * filename, const Skeleton * pSkeleton, Motion ** pMotion);
+
+  // returns 1 if filename ends with ".amcz" (case-insensitive), and 0 otherwise
+  static int IsAMCZFilename(const char * filename);
+
+protected:
+  static int CheckHeader(const AMCZHeader & header, size_t size, const Skeleton * pSkeleton, const char * name);
+};
+
+#endif
+
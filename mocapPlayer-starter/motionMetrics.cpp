@@ -0,0 +1,408 @@
+/*
+motionMetrics.cpp
+
+Reconstruction error metrics between a motion and a reference motion.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "motionMetrics.h"
+#include "forwardKinematics.h"
+#include "quaternionBatch.h"
+#include "threadPool.h"
+
+MotionMetrics::MotionMetrics(const Skeleton * pSkeleton, double frameRate)
+{
+  m_pSkeleton = pSkeleton;
+  m_pForwardKinematics = new ForwardKinematics(pSkeleton);
+  m_pThreadPool = NULL;
+  m_FrameRate = frameRate;
+  m_NumJoints = m_pForwardKinematics->GetNumBones();
+  m_pRotating = new int[m_NumJoints];
+  for(int joint=0; joint<m_NumJoints; joint++)
+    m_pRotating[joint] = 0;
+
+  m_NumFrames = 0;
+  m_pPositions[0] = m_pPositions[1] = NULL;
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    m_pErrors[metric] = m_pFrameMean[metric] = m_pFrameMax[metric] = NULL;
+    m_pJointStatistics[metric] = NULL;
+    m_Statistics[metric].mean = m_Statistics[metric].rms = m_Statistics[metric].max = m_Statistics[metric].percentile95 = 0.0;
+    m_Statistics[metric].maxFrame = m_Statistics[metric].maxJoint = -1;
+  }
+}
+
+MotionMetrics::~MotionMetrics()
+{
+  Free();
+  delete [] m_pRotating;
+  delete m_pForwardKinematics;
+}
+
+void MotionMetrics::Free()
+{
+  for(int i=0; i<2; i++)
+  {
+    delete [] m_pPositions[i];
+    m_pPositions[i] = NULL;
+  }
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    delete [] m_pErrors[metric];
+    delete [] m_pFrameMean[metric];
+    delete [] m_pFrameMax[metric];
+    delete [] m_pJointStatistics[metric];
+    m_pErrors[metric] = m_pFrameMean[metric] = m_pFrameMax[metric] = NULL;
+    m_pJointStatistics[metric] = NULL;
+  }
+  m_NumFrames = 0;
+}
+
+void MotionMetrics::ForEachBlock(int numFrames, const std::function<void(int, int)> & block)
+{
+  const int blockSize = 256;
+  int numBlocks = (numFrames + blockSize - 1) / blockSize;
+  auto task = [&](int blockIndex)
+  {
+    int begin = blockIndex * blockSize;
+    block(begin, (begin + blockSize < numFrames) ? begin + blockSize : numFrames);
+  };
+  if (m_pThreadPool != NULL)
+    m_pThreadPool->ParallelFor(numBlocks, task);
+  else
+  {
+    for(int blockIndex=0; blockIndex<numBlocks; blockIndex++)
+      task(blockIndex);
+  }
+}
+
+int MotionMetrics::Compute(Motion * pReferenceMotion, Motion * pMotion)
+{
+  if ((pReferenceMotion->GetNumFrames() != pMotion->GetNumFrames()) ||
+      (pReferenceMotion->GetNumBones() != m_NumJoints) || (pMotion->GetNumBones() != m_NumJoints))
+  {
+    printf("Error in MotionMetrics::Compute: the motions have %d and %d frames, %d and %d bones (the skeleton has %d bones).\n",
+      pReferenceMotion->GetNumFrames(), pMotion->GetNumFrames(), pReferenceMotion->GetNumBones(), pMotion->GetNumBones(), m_NumJoints);
+    Free();
+    return -1;
+  }
+
+  int numFrames = pMotion->GetNumFrames();
+  int numJoints = m_NumJoints;
+  for(int joint=0; joint<numJoints; joint++)
+    m_pRotating[joint] = (m_pSkeleton->getRotationalDOFMask(joint) != 0);
+  // the buffers of the previous comparison are reused if the motions have the same length
+  if ((numFrames != m_NumFrames) || (m_pPositions[0] == NULL))
+  {
+    Free();
+    m_NumFrames = numFrames;
+    for(int i=0; i<2; i++)
+      m_pPositions[i] = new double[3 * numJoints * numFrames];
+    for(int metric=0; metric<NUM_METRICS; metric++)
+    {
+      m_pErrors[metric] = new double[numJoints * numFrames];
+      m_pFrameMean[metric] = new double[numFrames];
+      m_pFrameMax[metric] = new double[numFrames];
+      m_pJointStatistics[metric] = new MetricStatistics[numJoints];
+    }
+  }
+
+  // the postures and the channels (for the joint positions) are read by several threads
+  Motion * pMotions[2] = { pReferenceMotion, pMotion };
+  for(int i=0; i<2; i++)
+  {
+    pMotions[i]->UpdatePostures();
+    pMotions[i]->UpdateChannels();
+  }
+
+  // 1. positions, angle and position errors
+  ForEachBlock(numFrames, [&](int begin, int end)
+  {
+    double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE], quaternionBuffer[2][4 * MAX_BONES_IN_ASF_FILE];
+    double * angles[3] = { anglesBuffer, anglesBuffer + numJoints, anglesBuffer + 2 * numJoints };
+    double * q[2][4];
+    for(int i=0; i<2; i++)
+      m_pForwardKinematics->ComputeJointPositions(pMotions[i], begin, end - begin, &m_pPositions[i][3 * numJoints * begin]);
+    for(int frame=begin; frame<end; frame++)
+    {
+      for(int i=0; i<2; i++)
+      {
+        Posture * posture = pMotions[i]->GetPosture(frame);
+        for(int joint=0; joint<numJoints; joint++)
+          for(int axis=0; axis<3; axis++)
+            angles[axis][joint] = posture->bone_rotation[joint].p[axis];
+        GetQuaternionArrays(quaternionBuffer[i], numJoints, q[i]);
+        EulerToQuaternionBatch(numJoints, angles, q[i]);
+      }
+
+      double * angleErrors = &m_pErrors[METRIC_ANGLE][numJoints * frame];
+      RotationAngleBatch(numJoints, q[0], q[1], angleErrors);
+      for(int joint=0; joint<numJoints; joint++)
+      {
+        if (!m_pRotating[joint])
+          angleErrors[joint] = 0.0;
+        const double * p0 = &m_pPositions[0][3 * (numJoints * frame + joint)];
+        const double * p1 = &m_pPositions[1][3 * (numJoints * frame + joint)];
+        double dx = p1[0] - p0[0], dy = p1[1] - p0[1], dz = p1[2] - p0[2];
+        m_pErrors[METRIC_POSITION][numJoints * frame + joint] = sqrt(dx * dx + dy * dy + dz * dz);
+      }
+    }
+  });
+
+  // 2. velocity and acceleration errors (from the positions of the neighbouring frames), and the per-frame statistics
+  ForEachBlock(numFrames, [&](int begin, int end)
+  {
+    for(int frame=begin; frame<end; frame++)
+    {
+      int previous = (frame > 0) ? frame - 1 : frame;
+      int next = (frame + 1 < numFrames) ? frame + 1 : frame;
+      double velocityScale = (next > previous) ? m_FrameRate / (next - previous) : 0.0;
+      // the accelerations are defined at the frames 1, ..., numFrames-2 (if numFrames >= 3)
+      int center = (frame < 1) ? 1 : ((frame > numFrames - 2) ? numFrames - 2 : frame);
+      double accelerationScale = m_FrameRate * m_FrameRate;
+
+      for(int joint=0; joint<numJoints; joint++)
+      {
+        double velocityDifference[3], accelerationDifference[3];
+        for(int axis=0; axis<3; axis++)
+        {
+          double v[2], a[2];
+          for(int i=0; i<2; i++)
+          {
+            const double * p = &m_pPositions[i][3 * joint + axis];
+            int stride = 3 * numJoints;
+            v[i] = (p[stride * next] - p[stride * previous]) * velocityScale;
+            a[i] = (numFrames >= 3) ? (p[stride * (center + 1)] - 2.0 * p[stride * center] + p[stride * (center - 1)]) * accelerationScale : 0.0;
+          }
+          velocityDifference[axis] = v[1] - v[0];
+          accelerationDifference[axis] = a[1] - a[0];
+        }
+        m_pErrors[METRIC_VELOCITY][numJoints * frame + joint] = sqrt(velocityDifference[0] * velocityDifference[0] +
+          velocityDifference[1] * velocityDifference[1] + velocityDifference[2] * velocityDifference[2]);
+        m_pErrors[METRIC_ACCELERATION][numJoints * frame + joint] = sqrt(accelerationDifference[0] * accelerationDifference[0] +
+          accelerationDifference[1] * accelerationDifference[1] + accelerationDifference[2] * accelerationDifference[2]);
+      }
+
+      for(int metric=0; metric<NUM_METRICS; metric++)
+      {
+        const double * errors = &m_pErrors[metric][numJoints * frame];
+        double sum = 0.0, maximum = 0.0;
+        int count = 0;
+        for(int joint=0; joint<numJoints; joint++)
+        {
+          if (!IsJointCounted((MotionMetric)metric, joint))
+            continue;
+          sum += errors[joint];
+          maximum = (errors[joint] > maximum) ? errors[joint] : maximum;
+          count++;
+        }
+        m_pFrameMean[metric][frame] = (count > 0) ? sum / count : 0.0;
+        m_pFrameMax[metric][frame] = maximum;
+      }
+    }
+  });
+
+  ComputeStatistics();
+  return 0;
+}
+
+void MotionMetrics::ComputeStatistics()
+{
+  int numFrames = m_NumFrames;
+  int numJoints = m_NumJoints;
+
+  // per joint (in parallel over the joints), and in total
+  auto jointTask = [&](int task)
+  {
+    int metric = task / numJoints;
+    int joint = task % numJoints;
+    MetricStatistics & statistics = m_pJointStatistics[metric][joint];
+    double sum = 0.0, sum2 = 0.0;
+    statistics.max = 0.0;
+    statistics.maxFrame = -1;
+    statistics.maxJoint = -1;
+    statistics.percentile95 = 0.0;
+    for(int frame=0; frame<numFrames; frame++)
+    {
+      double error = m_pErrors[metric][numJoints * frame + joint];
+      sum += error;
+      sum2 += error * error;
+      if ((statistics.maxFrame < 0) || (error > statistics.max))
+      {
+        statistics.max = error;
+        statistics.maxFrame = frame;
+      }
+    }
+    statistics.mean = (numFrames > 0) ? sum / numFrames : 0.0;
+    statistics.rms = (numFrames > 0) ? sqrt(sum2 / numFrames) : 0.0;
+  };
+  if (m_pThreadPool != NULL)
+    m_pThreadPool->ParallelFor(NUM_METRICS * numJoints, jointTask);
+  else
+  {
+    for(int task=0; task<NUM_METRICS * numJoints; task++)
+      jointTask(task);
+  }
+
+  double * frameMax = new double[numFrames + 1];
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    MetricStatistics & statistics = m_Statistics[metric];
+    double sum = 0.0, sum2 = 0.0;
+    int count = 0;
+    statistics.max = 0.0;
+    statistics.maxFrame = statistics.maxJoint = -1;
+    for(int joint=0; joint<numJoints; joint++)
+    {
+      if (!IsJointCounted((MotionMetric)metric, joint))
+        continue;
+      const MetricStatistics & jointStatistics = m_pJointStatistics[metric][joint];
+      sum += jointStatistics.mean * numFrames;
+      sum2 += jointStatistics.rms * jointStatistics.rms * numFrames;
+      count += numFrames;
+      if ((jointStatistics.maxFrame >= 0) && ((statistics.maxFrame < 0) || (jointStatistics.max > statistics.max)))
+      {
+        statistics.max = jointStatistics.max;
+        statistics.maxFrame = jointStatistics.maxFrame;
+        statistics.maxJoint = joint;
+      }
+    }
+    statistics.mean = (count > 0) ? sum / count : 0.0;
+    statistics.rms = (count > 0) ? sqrt(sum2 / count) : 0.0;
+
+    // 95th percentile of the per-frame maximum (nearest rank)
+    statistics.percentile95 = 0.0;
+    if (numFrames > 0)
+    {
+      for(int frame=0; frame<numFrames; frame++)
+        frameMax[frame] = m_pFrameMax[metric][frame];
+      int rank = (int)ceil(0.95 * numFrames) - 1;
+      rank = (rank < 0) ? 0 : rank;
+      std::nth_element(frameMax, frameMax + rank, frameMax + numFrames);
+      statistics.percentile95 = frameMax[rank];
+    }
+  }
+  delete [] frameMax;
+}
+
+const char * MotionMetrics::GetMetricName(MotionMetric metric)
+{
+  const char * names[NUM_METRICS] = { "angle", "position", "velocity", "acceleration" };
+  return ((metric >= 0) && (metric < NUM_METRICS)) ? names[metric] : "unknown";
+}
+
+int MotionMetrics::WriteJSON(const char * filename)
+{
+  FILE * file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+
+  fprintf(file, "{\n  \"frames\": %d,\n  \"joints\": %d,\n  \"frameRate\": %.17g,\n", m_NumFrames, m_NumJoints, m_FrameRate);
+  fprintf(file, "  \"units\": { \"angle\": \"degrees\", \"position\": \"skeleton units\", \"velocity\": \"units/s\", \"acceleration\": \"units/s^2\" },\n");
+  fprintf(file, "  \"total\": {\n");
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    const MetricStatistics & statistics = m_Statistics[metric];
+    fprintf(file, "    \"%s\": { \"mean\": %.9g, \"rms\": %.9g, \"max\": %.9g, \"maxFrame\": %d, \"maxJoint\": \"%s\", \"p95FrameMax\": %.9g }%s\n",
+      GetMetricName((MotionMetric)metric), statistics.mean, statistics.rms, statistics.max, statistics.maxFrame,
+      (statistics.maxJoint >= 0) ? m_pSkeleton->idx2name(statistics.maxJoint) : "", statistics.percentile95, (metric + 1 < NUM_METRICS) ? "," : "");
+  }
+  fprintf(file, "  },\n  \"perJoint\": [\n");
+  for(int joint=0; joint<m_NumJoints; joint++)
+  {
+    fprintf(file, "    { \"joint\": %d, \"name\": \"%s\"", joint, m_pSkeleton->idx2name(joint));
+    for(int metric=0; metric<NUM_METRICS; metric++)
+    {
+      if (!IsJointCounted((MotionMetric)metric, joint))
+        continue;
+      const MetricStatistics & statistics = m_pJointStatistics[metric][joint];
+      fprintf(file, ", \"%s\": { \"mean\": %.9g, \"rms\": %.9g, \"max\": %.9g, \"maxFrame\": %d }",
+        GetMetricName((MotionMetric)metric), statistics.mean, statistics.rms, statistics.max, statistics.maxFrame);
+    }
+    fprintf(file, " }%s\n", (joint + 1 < m_NumJoints) ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  if (fclose(file) != 0)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+  return 0;
+}
+
+int MotionMetrics::WriteJointsCSV(const char * filename)
+{
+  FILE * file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+
+  fprintf(file, "joint,name");
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    const char * name = GetMetricName((MotionMetric)metric);
+    fprintf(file, ",%s_mean,%s_rms,%s_max", name, name, name);
+  }
+  fprintf(file, "\n");
+  for(int joint=0; joint<m_NumJoints; joint++)
+  {
+    fprintf(file, "%d,%s", joint, m_pSkeleton->idx2name(joint));
+    for(int metric=0; metric<NUM_METRICS; metric++)
+    {
+      const MetricStatistics & statistics = m_pJointStatistics[metric][joint];
+      if (IsJointCounted((MotionMetric)metric, joint))
+        fprintf(file, ",%.9g,%.9g,%.9g", statistics.mean, statistics.rms, statistics.max);
+      else
+        fprintf(file, ",,,"); // (no rotational DOFs)
+    }
+    fprintf(file, "\n");
+  }
+
+  if (fclose(file) != 0)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+  return 0;
+}
+
+int MotionMetrics::WriteFramesCSV(const char * filename)
+{
+  FILE * file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+
+  fprintf(file, "frame");
+  for(int metric=0; metric<NUM_METRICS; metric++)
+  {
+    const char * name = GetMetricName((MotionMetric)metric);
+    fprintf(file, ",%s_mean,%s_max", name, name);
+  }
+  fprintf(file, "\n");
+  for(int frame=0; frame<m_NumFrames; frame++)
+  {
+    fprintf(file, "%d", frame);
+    for(int metric=0; metric<NUM_METRICS; metric++)
+      fprintf(file, ",%.9g,%.9g", m_pFrameMean[metric][frame], m_pFrameMax[metric][frame]);
+    fprintf(file, "\n");
+  }
+
+  if (fclose(file) != 0)
+  {
+    printf("Error: cannot write %s.\n", filename);
+    return -1;
+  }
+  return 0;
+}
+
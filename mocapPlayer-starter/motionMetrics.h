@@ -0,0 +1,114 @@
+/*
+motionMetrics.h
+
+Error metrics between a motion and a reference motion of the same skeleton (for example,
+an input motion and the motion interpolated from its keyframes), for each frame and joint:
+  METRIC_ANGLE: angle (in degrees) of the rotation between the rotations of the joint
+    (the geodesic distance of the quaternions); only the bones with rotational DOFs are counted
+  METRIC_POSITION: distance between the world positions of the joint (the end of the bone, see
+    forwardKinematics.h), in skeleton units
+  METRIC_VELOCITY: length of the difference of the joint velocities, in skeleton units per second;
+    the velocities are central differences of the positions (one-sided at the first and the last frame)
+  METRIC_ACCELERATION: the same for the accelerations (second differences; at the first and the
+    last frame, those of the neighbouring frame), in skeleton units per second^2
+
+Statistics of each metric: for each joint (over all frames), for each frame (over the counted joints),
+and in total: mean, root mean square, maximum (and where it occurs), and the 95th percentile of the
+per-frame maximum. The frames are evaluated in parallel if a thread pool is set.
+
+Usage:
+  MotionMetrics metrics(pSkeleton);
+  metrics.SetThreadPool(&threadPool); // optional
+  if (metrics.Compute(pInputMotion, pInterpolatedMotion) == 0)
+  {
+    printf("max angle error: %f degrees\n", metrics.GetStatistics(METRIC_ANGLE).max);
+    metrics.WriteJSON("errors.json");
+  }
+*/
+
+#ifndef _MOTIONMETRICS_H_
+#define _MOTIONMETRICS_H_
+
+#include <functional>
+#include "motion.h"
+#include "amcbFile.h"
+
+class ForwardKinematics;
+class ThreadPool;
+
+enum MotionMetric
+{
+  METRIC_ANGLE = 0, METRIC_POSITION = 1, METRIC_VELOCITY = 2, METRIC_ACCELERATION = 3, NUM_METRICS = 4
+};
+
+struct MetricStatistics
+{
+  double mean;
+  double rms; // root mean square
+  double max;
+  int maxFrame; // frame of the maximum (-1 if there are no values)
+  int maxJoint; // joint (bone index) of the maximum (-1 if there are no values, or for the per-joint statistics)
+  double percentile95; // 95th percentile of the per-frame maximum (total statistics only)
+};
+
+class MotionMetrics
+{
+public:
+  // frameRate: frames per second of the motions (for the velocities and accelerations)
+  MotionMetrics(const Skeleton * pSkeleton, double frameRate = AMCB_DEFAULT_FRAME_RATE);
+  ~MotionMetrics();
+
+  // evaluate the frames in parallel with the threads of the pool (NULL = serial; the default)
+  void SetThreadPool(ThreadPool * pThreadPool) { m_pThreadPool = pThreadPool; }
+
+  // compares pMotion with pReferenceMotion (same skeleton, same number of frames)
+  // returns 0 on success, and -1 if the motions cannot be compared (an error message is printed)
+  int Compute(Motion * pReferenceMotion, Motion * pMotion);
+
+  // results of the last Compute
+  int GetNumFrames() { return m_NumFrames; }
+  int GetNumJoints() { return m_NumJoints; }
+  const MetricStatistics & GetStatistics(MotionMetric metric) { return m_Statistics[metric]; }
+  const MetricStatistics & GetJointStatistics(MotionMetric metric, int joint) { return m_pJointStatistics[metric][joint]; }
+  // error of the joint at the frame
+  double GetError(MotionMetric metric, int frame, int joint) { return m_pErrors[metric][frame * m_NumJoints + joint]; }
+  // mean and maximum error of the counted joints at the frame
+  double GetFrameMean(MotionMetric metric, int frame) { return m_pFrameMean[metric][frame]; }
+  double GetFrameMax(MotionMetric metric, int frame) { return m_pFrameMax[metric][frame]; }
+  // whether the joint is included in the statistics of the metric (bones without rotational DOFs have no angle error)
+  int IsJointCounted(MotionMetric metric, int joint) { return (metric != METRIC_ANGLE) || m_pRotating[joint]; }
+
+  static const char * GetMetricName(MotionMetric metric);
+
+  // output of the results; return 0 on success, and -1 otherwise
+  // JSON: the total statistics and the statistics of each joint
+  int WriteJSON(const char * filename);
+  // CSV, one line per joint: joint, name, and mean, rms, max of each metric
+  int WriteJointsCSV(const char * filename);
+  // CSV, one line per frame: frame, and mean, max of each metric
+  int WriteFramesCSV(const char * filename);
+
+protected:
+  const Skeleton * m_pSkeleton;
+  ForwardKinematics * m_pForwardKinematics;
+  ThreadPool * m_pThreadPool;
+  double m_FrameRate;
+  int m_NumJoints;
+  int * m_pRotating; // 1 for the bones with rotational DOFs
+
+  int m_NumFrames;
+  double * m_pPositions[2]; // joint positions of the reference motion and of the motion, 3 per joint and frame
+  double * m_pErrors[NUM_METRICS]; // per frame and joint
+  double * m_pFrameMean[NUM_METRICS];
+  double * m_pFrameMax[NUM_METRICS];
+  MetricStatistics * m_pJointStatistics[NUM_METRICS];
+  MetricStatistics m_Statistics[NUM_METRICS];
+
+  void Free();
+  // calls block(begin, end) for blocks of frames begin, ..., end-1 that cover all frames, in parallel if there is a thread pool
+  void ForEachBlock(int numFrames, const std::function<void(int, int)> & block);
+  void ComputeStatistics();
+};
+
+#endif
+
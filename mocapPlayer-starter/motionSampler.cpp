@@ -0,0 +1,350 @@
+/*
+motionSampler.cpp
+
+Interpolated postures of a motion at arbitrary times, with the segment coefficients computed once.
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include "motionSampler.h"
+#include "quaternionBatch.h"
+
+MotionSampler::MotionSampler(Motion * pMotion, int numKeyframes, const int * keyframes,
+  InterpolationType interpolationType, AngleRepresentation angleRepresentation)
+{
+  m_InterpolationType = interpolationType;
+  m_AngleRepresentation = angleRepresentation;
+  Init(pMotion, numKeyframes, keyframes);
+}
+
+MotionSampler::MotionSampler(Motion * pMotion, int N, InterpolationType interpolationType, AngleRepresentation angleRepresentation)
+{
+  m_InterpolationType = interpolationType;
+  m_AngleRepresentation = angleRepresentation;
+  if ((N < 0) || (pMotion->GetNumFrames() < 1))
+  {
+    printf("Error: invalid number of skipped frames (%d), or empty motion.\n", N);
+    throw 1;
+  }
+  int numKeyframes = (pMotion->GetNumFrames() - 1) / (N+1) + 1;
+  int * keyframes = new int[numKeyframes];
+  for(int i=0; i<numKeyframes; i++)
+    keyframes[i] = i * (N+1);
+  try
+  {
+    Init(pMotion, numKeyframes, keyframes);
+  }
+  catch(int)
+  {
+    delete [] keyframes;
+    throw;
+  }
+  delete [] keyframes;
+}
+
+MotionSampler::~MotionSampler()
+{
+  delete [] m_pKeyframes;
+  delete [] m_pCurves;
+  delete [] m_pArcs;
+}
+
+void MotionSampler::ComputeCubicCoefficients(const vector & p0, const vector & p1, const vector & p2, const vector & p3, vector coefficients[4])
+{
+  for(int i=0; i<3; i++)
+  {
+    coefficients[0].p[i] = p3.p[i] - p0.p[i] + 3.0 * (p1.p[i] - p2.p[i]);
+    coefficients[1].p[i] = 3.0 * (p0.p[i] - 2.0 * p1.p[i] + p2.p[i]);
+    coefficients[2].p[i] = 3.0 * (p1.p[i] - p0.p[i]);
+    coefficients[3].p[i] = p0.p[i];
+  }
+}
+
+// value = a u^3 + b u^2 + c u + d, for the coefficients (a, b, c, d)
+static inline void EvaluateCubic(const vector coefficients[4], double u, vector & value)
+{
+  for(int i=0; i<3; i++)
+    value.p[i] = ((coefficients[0].p[i] * u + coefficients[1].p[i]) * u + coefficients[2].p[i]) * u + coefficients[3].p[i];
+}
+
+void MotionSampler::Init(Motion * pMotion, int numKeyframes, const int * keyframes)
+{
+  m_pMotion = pMotion;
+  m_pSkeleton = pMotion->GetSkeleton();
+  m_pKeyframes = NULL;
+  m_pCurves = NULL;
+  m_pArcs = NULL;
+  m_Cursor = 0;
+
+  if ((m_InterpolationType == SQUAD) && (m_AngleRepresentation != QUATERNION))
+  {
+    printf("Error: SQUAD interpolation requires quaternions.\n");
+    throw 1;
+  }
+  if (numKeyframes < 1)
+  {
+    printf("Error: no keyframes.\n");
+    throw 1;
+  }
+  for(int i=0; i<numKeyframes; i++)
+  {
+    if ((keyframes[i] < 0) || (keyframes[i] >= pMotion->GetNumFrames()) || ((i > 0) && (keyframes[i] <= keyframes[i-1])))
+    {
+      printf("Error: keyframe %d (frame %d) is out of range, or not after the previous keyframe.\n", i, keyframes[i]);
+      throw 1;
+    }
+  }
+
+  m_NumKeyframes = numKeyframes;
+  m_pKeyframes = new int[numKeyframes];
+  for(int i=0; i<numKeyframes; i++)
+    m_pKeyframes[i] = keyframes[i];
+
+  // the samples access the postures directly
+  pMotion->UpdatePostures();
+
+  m_NumActiveBones = m_pSkeleton->getNumActiveBones();
+  const int * activeBones = m_pSkeleton->getActiveBones();
+  int numSegments = numKeyframes - 1;
+  Interpolator interpolator; // control point construction
+
+  // cubic curves of the root position, and for Euler angles of the bone rotations
+  m_NumCurves = 1 + ((m_AngleRepresentation == EULER) ? m_NumActiveBones : 0);
+  m_pCurves = new vector[(numSegments > 0 ? numSegments : 1) * m_NumCurves * 4];
+  // linear quaternion interpolation interpolates the root position linearly, as linear Euler interpolation
+  int linearRoot = (m_InterpolationType == LINEAR);
+  for(int segment=0; segment<numSegments; segment++)
+  {
+    int hasPreviousKeyframe = (segment > 0);
+    int hasThirdKeyframe = (segment + 2 < numKeyframes);
+    Posture * previousPosture = pMotion->GetPosture(m_pKeyframes[hasPreviousKeyframe ? segment - 1 : segment]);
+    Posture * startPosture = pMotion->GetPosture(m_pKeyframes[segment]);
+    Posture * endPosture = pMotion->GetPosture(m_pKeyframes[segment + 1]);
+    Posture * thirdPosture = pMotion->GetPosture(m_pKeyframes[hasThirdKeyframe ? segment + 2 : segment + 1]); // not used if there is no third keyframe
+
+    vector * coefficients = &m_pCurves[segment * m_NumCurves * 4];
+    for(int curve=0; curve<m_NumCurves; curve++)
+    {
+      const vector * p[4];
+      if (curve == 0)
+      {
+        p[0] = &previousPosture->root_pos; p[1] = &startPosture->root_pos; p[2] = &endPosture->root_pos; p[3] = &thirdPosture->root_pos;
+      }
+      else
+      {
+        int bone = activeBones[curve - 1];
+        p[0] = &previousPosture->bone_rotation[bone]; p[1] = &startPosture->bone_rotation[bone];
+        p[2] = &endPosture->bone_rotation[bone]; p[3] = &thirdPosture->bone_rotation[bone];
+      }
+
+      if (linearRoot)
+      {
+        coefficients[4 * curve + 0] = vector(0.0, 0.0, 0.0);
+        coefficients[4 * curve + 1] = vector(0.0, 0.0, 0.0);
+        coefficients[4 * curve + 2] = *p[2] - *p[1];
+        coefficients[4 * curve + 3] = *p[1];
+      }
+      else
+      {
+        vector an, bn;
+        interpolator.ComputeEulerControlPoints(*p[0], *p[1], *p[2], *p[3], hasPreviousKeyframe, hasThirdKeyframe, an, bn);
+        ComputeCubicCoefficients(*p[1], an, bn, *p[2], &coefficients[4 * curve]);
+      }
+    }
+  }
+
+  m_NumArcs = 0;
+  if (m_AngleRepresentation != QUATERNION)
+    return;
+
+  // quaternions of the keyframes (structure-of-arrays layout)
+  int numActiveBones = m_NumActiveBones;
+  double * keyframeQuaternions = new double[numKeyframes * numActiveBones * 4];
+  for(int keyframe=0; keyframe<numKeyframes; keyframe++)
+  {
+    double anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+    double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+    Interpolator::GetActiveBoneRotations(m_pSkeleton, *pMotion->GetPosture(m_pKeyframes[keyframe]), angles);
+    double * q[4];
+    GetQuaternionArrays(&keyframeQuaternions[keyframe * numActiveBones * 4], numActiveBones, q);
+    EulerToQuaternionBatch(numActiveBones, angles, q);
+  }
+
+  // SQUAD: aligned keyframe quaternions and control points s_i
+  double * squadQuaternions = NULL;
+  int squadBlockSize = 2 * 4 * numActiveBones;
+  if (m_InterpolationType == SQUAD)
+  {
+    squadQuaternions = new double[numKeyframes * squadBlockSize];
+    interpolator.ComputeSquadControlPoints(keyframeQuaternions, numKeyframes, numActiveBones, squadQuaternions);
+  }
+
+  if (m_InterpolationType == LINEAR)
+    m_NumArcs = 1;
+  else if (m_InterpolationType == BEZIER)
+    m_NumArcs = 3;
+  else
+    m_NumArcs = 2;
+  m_pArcs = new double[(numSegments > 0 ? numSegments : 1) * m_NumArcs * 9 * numActiveBones];
+
+  for(int segment=0; segment<numSegments; segment++)
+  {
+    double * arcs[3][9];
+    for(int i=0; i<m_NumArcs; i++)
+      GetSlerpArcArrays(&m_pArcs[(segment * m_NumArcs + i) * 9 * numActiveBones], numActiveBones, arcs[i]);
+
+    double * startQuaternions[4], * endQuaternions[4];
+    GetQuaternionArrays(&keyframeQuaternions[segment * numActiveBones * 4], numActiveBones, startQuaternions);
+    GetQuaternionArrays(&keyframeQuaternions[(segment + 1) * numActiveBones * 4], numActiveBones, endQuaternions);
+
+    if (m_InterpolationType == LINEAR)
+      ComputeSlerpArcBatch(numActiveBones, startQuaternions, endQuaternions, arcs[0]);
+    else if (m_InterpolationType == BEZIER)
+    {
+      int hasPreviousKeyframe = (segment > 0);
+      int hasThirdKeyframe = (segment + 2 < numKeyframes);
+      const double * previousQuaternions = &keyframeQuaternions[(hasPreviousKeyframe ? segment - 1 : segment) * numActiveBones * 4];
+      const double * thirdQuaternions = &keyframeQuaternions[(hasThirdKeyframe ? segment + 2 : segment + 1) * numActiveBones * 4];
+
+      // control points (start, a_n, b_n, end), as in Interpolator::BezierInterpolationQuaternion
+      double controlBuffer[4 * 4 * MAX_BONES_IN_ASF_FILE];
+      double * controlQuaternions[4][4];
+      for(int i=0; i<4; i++)
+        GetQuaternionArrays(&controlBuffer[i * 4 * numActiveBones], numActiveBones, controlQuaternions[i]);
+      for (int k = 0; k < numActiveBones; k++)
+      {
+        Quaternion<double> q[4];
+        interpolator.ComputeQuaternionControlPoints(
+          Quaternion<double>(previousQuaternions[k], previousQuaternions[numActiveBones + k], previousQuaternions[2 * numActiveBones + k], previousQuaternions[3 * numActiveBones + k]),
+          Quaternion<double>(startQuaternions[0][k], startQuaternions[1][k], startQuaternions[2][k], startQuaternions[3][k]),
+          Quaternion<double>(endQuaternions[0][k], endQuaternions[1][k], endQuaternions[2][k], endQuaternions[3][k]),
+          Quaternion<double>(thirdQuaternions[k], thirdQuaternions[numActiveBones + k], thirdQuaternions[2 * numActiveBones + k], thirdQuaternions[3 * numActiveBones + k]),
+          hasPreviousKeyframe, hasThirdKeyframe, q);
+        for(int i=0; i<4; i++)
+        {
+          controlQuaternions[i][0][k] = q[i].Gets();
+          controlQuaternions[i][1][k] = q[i].Getx();
+          controlQuaternions[i][2][k] = q[i].Gety();
+          controlQuaternions[i][3][k] = q[i].Getz();
+        }
+      }
+      // first step of the DeCasteljau construction: Slerp(t, p0, p1), Slerp(t, p1, p2), Slerp(t, p2, p3)
+      for(int i=0; i<3; i++)
+        ComputeSlerpArcBatch(numActiveBones, controlQuaternions[i], controlQuaternions[i+1], arcs[i]);
+    }
+    else
+    {
+      double * start = &squadQuaternions[segment * squadBlockSize];
+      double * startControlPoints[4], * endControlPoints[4];
+      GetQuaternionArrays(start, numActiveBones, startQuaternions);
+      GetQuaternionArrays(start + squadBlockSize, numActiveBones, endQuaternions);
+      GetQuaternionArrays(start + 4 * numActiveBones, numActiveBones, startControlPoints);
+      GetQuaternionArrays(start + squadBlockSize + 4 * numActiveBones, numActiveBones, endControlPoints);
+      ComputeSlerpArcBatch(numActiveBones, startQuaternions, endQuaternions, arcs[0]);
+      ComputeSlerpArcBatch(numActiveBones, startControlPoints, endControlPoints, arcs[1]);
+    }
+  }
+
+  delete [] squadQuaternions;
+  delete [] keyframeQuaternions;
+}
+
+int MotionSampler::FindSegment(double time)
+{
+  if (m_NumKeyframes < 2)
+    return 0;
+  int lastSegment = m_NumKeyframes - 2;
+
+  // the segment of the previous sample, or the next segment
+  int segment = m_Cursor;
+  if (time >= m_pKeyframes[segment])
+  {
+    if ((segment == lastSegment) || (time < m_pKeyframes[segment + 1]))
+      return segment;
+    if ((segment + 1 == lastSegment) || (time < m_pKeyframes[segment + 2]))
+      return m_Cursor = segment + 1;
+  }
+
+  // binary search: the number of keyframes 1, ..., numKeyframes-2 that are <= time
+  m_Cursor = (int)(std::upper_bound(m_pKeyframes + 1, m_pKeyframes + lastSegment + 1, time) - (m_pKeyframes + 1));
+  return m_Cursor;
+}
+
+void MotionSampler::Sample(double time, Posture & posture)
+{
+  int segment = FindSegment(time);
+  if (m_NumKeyframes < 2)
+  {
+    posture = *m_pMotion->GetPosture(m_pKeyframes[0]);
+    return;
+  }
+
+  int startKeyframe = m_pKeyframes[segment];
+  int endKeyframe = m_pKeyframes[segment + 1];
+  // at the keyframes (and outside of the keyframe range), the keyframe posture is returned
+  if (!(time > startKeyframe))
+  {
+    posture = *m_pMotion->GetPosture(startKeyframe);
+    return;
+  }
+  if (!(time < endKeyframe))
+  {
+    posture = *m_pMotion->GetPosture(endKeyframe);
+    return;
+  }
+  double t = (time - startKeyframe) / (endKeyframe - startKeyframe);
+
+  posture = *m_pMotion->GetPosture(startKeyframe);
+
+  // root position, and Euler angles
+  const vector * coefficients = &m_pCurves[segment * m_NumCurves * 4];
+  EvaluateCubic(&coefficients[0], t, posture.root_pos);
+  int numActiveBones = m_NumActiveBones;
+  const int * activeBones = m_pSkeleton->getActiveBones();
+  if (m_AngleRepresentation == EULER)
+  {
+    for (int k = 0; k < numActiveBones; k++)
+      EvaluateCubic(&coefficients[4 + 4 * k], t, posture.bone_rotation[activeBones[k]]);
+    return;
+  }
+
+  // quaternions (all bones at once)
+  double * arcs[3][9];
+  for(int i=0; i<m_NumArcs; i++)
+    GetSlerpArcArrays(&m_pArcs[(segment * m_NumArcs + i) * 9 * numActiveBones], numActiveBones, arcs[i]);
+  double buffer[6 * 4 * MAX_BONES_IN_ASF_FILE], anglesBuffer[3 * MAX_BONES_IN_ASF_FILE];
+  double * q[6][4];
+  for(int i=0; i<6; i++)
+    GetQuaternionArrays(&buffer[i * 4 * numActiveBones], numActiveBones, q[i]);
+  double * angles[3] = { anglesBuffer, anglesBuffer + numActiveBones, anglesBuffer + 2 * numActiveBones };
+  double * const * interpolatedQuaternions = q[5];
+
+  if (m_InterpolationType == LINEAR)
+    EvaluateSlerpArcBatch(numActiveBones, &t, 0, arcs[0], interpolatedQuaternions);
+  else if (m_InterpolationType == BEZIER)
+  {
+    // DeCasteljau construction, with the first step from the precomputed arcs
+    for(int i=0; i<3; i++)
+      EvaluateSlerpArcBatch(numActiveBones, &t, 0, arcs[i], q[i]);
+    SlerpBatch(numActiveBones, &t, 0, q[0], q[1], q[3]);
+    SlerpBatch(numActiveBones, &t, 0, q[1], q[2], q[4]);
+    SlerpBatch(numActiveBones, &t, 0, q[3], q[4], interpolatedQuaternions);
+  }
+  else
+  {
+    // Squad(t) = Slerp(2t(1-t), Slerp(t, q_i, q_i+1), Slerp(t, s_i, s_i+1))
+    double u = 2.0 * t * (1.0 - t);
+    EvaluateSlerpArcBatch(numActiveBones, &t, 0, arcs[0], q[0]);
+    EvaluateSlerpArcBatch(numActiveBones, &t, 0, arcs[1], q[1]);
+    SlerpBatch(numActiveBones, &u, 0, q[0], q[1], interpolatedQuaternions);
+  }
+  QuaternionToEulerBatch(numActiveBones, interpolatedQuaternions, angles);
+  Interpolator::SetActiveBoneRotations(m_pSkeleton, angles, posture);
+}
+
+void MotionSampler::Sample(int count, const double * times, Posture * postures)
+{
+  for(int i=0; i<count; i++)
+    Sample(times[i], postures[i]);
+}
+
@@ -0,0 +1,85 @@
+/*
+motionSampler.h
+
+Samples the interpolated motion at arbitrary (real-valued) times, without creating
+an output motion (see Interpolator::Interpolate, which computes all frames).
+
+Times are given in frames of the input motion (time = seconds * frame rate; 120 fps
+for the CMU motions): time 10.5 is halfway between frames 10 and 11.
+The keyframes are a strictly increasing list of frames of the input motion. The
+keyframe segment of a time is found by a cursor (consecutive times usually fall
+into the same or the next segment) and otherwise by binary search, so that a
+sample costs O(log K) for K keyframes. The coefficients of all segments (Bezier
+curves, Slerp arcs, SQUAD control points) are computed once, in the constructor.
+
+Usage:
+  MotionSampler sampler(pMotion, N, BEZIER, QUATERNION); // keyframes 0, N+1, 2(N+1), ...
+  Posture posture;
+  for(double time = 0.0; time < sampler.GetEndTime(); time += 120.0 / 30.0) // resample at 30 fps
+    sampler.Sample(time, posture);
+
+With the keyframes 0, N+1, 2(N+1), ..., the samples at the frames up to the last
+keyframe are the same as the frames of Interpolator::Interpolate (up to round-off).
+The Bezier control points are constructed as in Interpolator, which assumes equally
+spaced keyframes; with unequally spaced keyframes, the curves still pass through
+the keyframes, but their tangents do not account for the different spacing.
+*/
+
+#ifndef _MOTIONSAMPLER_H_
+#define _MOTIONSAMPLER_H_
+
+#include "interpolator.h"
+
+class MotionSampler
+{
+public:
+  // samples pMotion with the given keyframes (numKeyframes >= 1 frames of pMotion, strictly increasing)
+  // the motion must not be modified or deleted while the sampler is used
+  MotionSampler(Motion * pMotion, int numKeyframes, const int * keyframes,
+    InterpolationType interpolationType, AngleRepresentation angleRepresentation);
+  // keyframes 0, N+1, 2(N+1), ..., as Interpolator::Interpolate with N
+  MotionSampler(Motion * pMotion, int N, InterpolationType interpolationType, AngleRepresentation angleRepresentation);
+  ~MotionSampler();
+
+  int GetNumKeyframes() { return m_NumKeyframes; }
+  const int * GetKeyframes() { return m_pKeyframes; }
+  // range of the times that are interpolated (the first and the last keyframe); other times are clamped to it
+  double GetStartTime() { return m_pKeyframes[0]; }
+  double GetEndTime() { return m_pKeyframes[m_NumKeyframes - 1]; }
+
+  // sets posture to the interpolated posture at time (posture is allocated if it has no storage yet)
+  // the root position and the rotations of the active bones are interpolated; the other values are those of the
+  // keyframe at the start of the segment
+  // a sampler must not be used by several threads at once (it keeps the cursor)
+  void Sample(double time, Posture & posture);
+  // postures[i] = posture at times[i], for i = 0, ..., count-1 (fastest when the times are sorted)
+  void Sample(int count, const double * times, Posture * postures);
+
+  // keyframe segment that contains time: the index of the last keyframe <= time
+  // (0 <= segment <= numKeyframes-2; 0 if there is only one keyframe)
+  int FindSegment(double time);
+
+protected:
+  Motion * m_pMotion;
+  const Skeleton * m_pSkeleton;
+  InterpolationType m_InterpolationType;
+  AngleRepresentation m_AngleRepresentation;
+  int m_NumKeyframes, m_NumActiveBones;
+  int * m_pKeyframes;
+  int m_Cursor; // segment of the previous sample
+
+  // per segment: the coefficients (a, b, c, d) of the cubic curves a u^3 + b u^2 + c u + d (u = 0..1 in the segment)
+  // of the root position (curve 0) and, for Euler angles, of the rotations of the active bones (curve 1 + k)
+  int m_NumCurves;
+  vector * m_pCurves;
+  // per segment, for quaternions: the Slerp arcs (see quaternionBatch.h) of all active bones:
+  // linear: keyframe to keyframe; Bezier: the three arcs of the first DeCasteljau step; SQUAD: keyframes and control points
+  int m_NumArcs;
+  double * m_pArcs;
+
+  void Init(Motion * pMotion, int numKeyframes, const int * keyframes);
+  static void ComputeCubicCoefficients(const vector & p0, const vector & p1, const vector & p2, const vector & p3, vector coefficients[4]);
+};
+
+#endif
+
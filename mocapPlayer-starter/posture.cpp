@@ -5,5 +5,107 @@ Revision 2 - Alla and Kiran, Jan 18, 2002
 Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 
 */
+#include <stdlib.h>
 #include "posture.h"
 
+Posture::Posture()
+{
+  numBones = 0;
+  m_pStorage = NULL;
+  bone_rotation = bone_translation = bone_length = NULL;
+  root_pos.setValue(0.0, 0.0, 0.0);
+}
+
+Posture::Posture(int numBones_)
+{
+  numBones = 0;
+  m_pStorage = NULL;
+  bone_rotation = bone_translation = bone_length = NULL;
+  Allocate(numBones_);
+}
+
+Posture::Posture(const Posture & posture)
+{
+  numBones = 0;
+  m_pStorage = NULL;
+  bone_rotation = bone_translation = bone_length = NULL;
+  Allocate(posture.numBones);
+  *this = posture;
+}
+
+Posture::~Posture()
+{
+  Free();
+}
+
+void Posture::Free()
+{
+  if (m_pStorage != NULL)
+    delete [] m_pStorage;
+  m_pStorage = NULL;
+  bone_rotation = bone_translation = bone_length = NULL;
+  numBones = 0;
+}
+
+void Posture::Allocate(int numBones_)
+{
+  Free();
+  numBones = numBones_;
+  if (numBones > 0)
+  {
+    m_pStorage = new vector[3 * numBones];
+    bone_rotation = m_pStorage;
+    bone_translation = m_pStorage + numBones;
+    bone_length = m_pStorage + 2 * numBones;
+  }
+  SetToZero();
+}
+
+void Posture::Attach(int numBones_, vector * storage)
+{
+  Free();
+  numBones = numBones_;
+  bone_rotation = storage;
+  bone_translation = storage + numBones;
+  bone_length = storage + 2 * numBones;
+}
+
+void Posture::SetToZero()
+{
+  root_pos.setValue(0.0, 0.0, 0.0);
+  for(int i = 0; i < numBones; i++)
+  {
+    bone_rotation[i].setValue(0.0, 0.0, 0.0);
+    bone_translation[i].setValue(0.0, 0.0, 0.0);
+    bone_length[i].setValue(0.0, 0.0, 0.0);
+  }
+}
+
+Posture & Posture::operator=(const Posture & posture)
+{
+  if (this == &posture)
+    return *this;
+
+  if ((numBones == 0) && (posture.numBones > 0))
+    Allocate(posture.numBones);
+
+  root_pos = posture.root_pos;
+
+  //copy the bones both postures have; remaining bones (if any) are set to 0
+  int n = (numBones < posture.numBones) ? numBones : posture.numBones;
+  for(int i = 0; i < n; i++)
+  {
+    bone_rotation[i] = posture.bone_rotation[i];
+    bone_translation[i] = posture.bone_translation[i];
+    bone_length[i] = posture.bone_length[i];
+  }
+  for(int i = n; i < numBones; i++)
+  {
+    bone_rotation[i].setValue(0.0, 0.0, 0.0);
+    bone_translation[i].setValue(0.0, 0.0, 0.0);
+    bone_length[i].setValue(0.0, 0.0, 0.0);
+  }
+
+  return *this;
+}
+
@@ -10,9 +10,33 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 #include "types.h"
 
 //Root position and all bone rotation angles (including root) 
+//The per-bone arrays are sized to the number of bones in the skeleton (not MAX_BONES_IN_ASF_FILE).
+//A posture either owns its per-bone storage, or refers to storage owned by a Motion (see Attach).
 struct Posture
 {
 public:
+  //Empty posture (no bones); use Allocate to size it
+  Posture();
+  //Posture with numBones bones, all values set to 0
+  Posture(int numBones);
+  Posture(const Posture & posture);
+  ~Posture();
+
+  //Copies root position and all per-bone values
+  //If this posture has no storage yet, storage is allocated
+  Posture & operator=(const Posture & posture);
+
+  //Allocate (own) storage for numBones bones, and set all values to 0
+  void Allocate(int numBones);
+  //Refer to external storage of 3 * numBones vectors (rotations, translations, lengths);
+  //the storage is not freed by the posture
+  void Attach(int numBones, vector * storage);
+
+  //Set root position and all per-bone values to 0
+  void SetToZero();
+
+  int GetNumBones() const { return numBones; }
+
   //Root position (x, y, z)		
   vector root_pos;								
 
@@ -20,13 +44,19 @@ public:
   //If a particular bone does not have a certain degree of freedom, 
   //the corresponding rotation is set to 0.
   //The order of the bones in the array corresponds to their ids in .ASf file: root, lhipjoint, lfemur, ...
-  vector bone_rotation[MAX_BONES_IN_ASF_FILE];
+  vector * bone_rotation;
   
   // bones that are translated relative to parents (resulting in gaps) (rarely used)
-  vector bone_translation[MAX_BONES_IN_ASF_FILE];
+  vector * bone_translation;
 
   // bones that change length during the motion (rarely used)
-  vector bone_length[MAX_BONES_IN_ASF_FILE];
+  vector * bone_length;
+
+protected:
+  int numBones;
+  vector * m_pStorage; // storage for all per-bone arrays, if owned by this posture (NULL otherwise)
+
+  void Free();
 };
 
 #endif
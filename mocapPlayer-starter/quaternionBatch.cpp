@@ -0,0 +1,326 @@
+/*
+quaternionBatch.cpp
+
+Batched quaternion operations, vectorized with AVX2 or SSE2 where available (plain doubles otherwise).
+*/
+
+#include <math.h>
+#include <float.h>
+#include "quaternionBatch.h"
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+// With gcc and clang on x86, the kernels are also compiled for AVX2 and FMA (whatever the compiler flags), 
+// and those are used if the CPU supports them (see UseAVX2).
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define QUATERNION_BATCH_AVX2
+#endif
+
+#if defined(QUATERNION_BATCH_AVX2) || defined(__SSE2__) || defined(_M_X64)
+  #include <immintrin.h>
+#endif
+
+// The SIMD kernels (quaternionBatchKernels.h) are written once, for a "packet" of width doubles;
+// the Ops classes below provide the packet operations for AVX, SSE2 and plain doubles.
+
+struct ScalarOps
+{
+  enum { width = 1 };
+  typedef double Packet;
+  typedef bool Mask;
+
+  static inline Packet Load(const double * p) { return *p; }
+  static inline Packet LoadStrided(const double * p, int) { return *p; }
+  static inline void Store(double * p, Packet a) { *p = a; }
+  static inline Packet Set(double a) { return a; }
+  static inline Packet Add(Packet a, Packet b) { return a + b; }
+  static inline Packet Sub(Packet a, Packet b) { return a - b; }
+  static inline Packet Mul(Packet a, Packet b) { return a * b; }
+  static inline Packet Div(Packet a, Packet b) { return a / b; }
+  static inline Packet Sqrt(Packet a) { return sqrt(a); }
+  static inline Packet Min(Packet a, Packet b) { return (a < b) ? a : b; }
+  static inline Packet Max(Packet a, Packet b) { return (a > b) ? a : b; }
+  static inline Packet Abs(Packet a) { return fabs(a); }
+  static inline Packet CopySign(Packet magnitude, Packet sign) { return copysign(magnitude, sign); }
+  static inline Packet Round(Packet a) { return floor(a + 0.5); }
+  static inline Mask Greater(Packet a, Packet b) { return a > b; }
+  static inline Mask Less(Packet a, Packet b) { return a < b; }
+  static inline Packet Select(Mask m, Packet a, Packet b) { return m ? a : b; }
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+struct SSE2Ops
+{
+  enum { width = 2 };
+  typedef __m128d Packet;
+  typedef __m128d Mask;
+
+  static inline Packet Load(const double * p) { return _mm_loadu_pd(p); }
+  static inline Packet LoadStrided(const double * p, int stride) { return _mm_set_pd(p[stride], p[0]); }
+  static inline void Store(double * p, Packet a) { _mm_storeu_pd(p, a); }
+  static inline Packet Set(double a) { return _mm_set1_pd(a); }
+  static inline Packet Add(Packet a, Packet b) { return _mm_add_pd(a, b); }
+  static inline Packet Sub(Packet a, Packet b) { return _mm_sub_pd(a, b); }
+  static inline Packet Mul(Packet a, Packet b) { return _mm_mul_pd(a, b); }
+  static inline Packet Div(Packet a, Packet b) { return _mm_div_pd(a, b); }
+  static inline Packet Sqrt(Packet a) { return _mm_sqrt_pd(a); }
+  static inline Packet Min(Packet a, Packet b) { return _mm_min_pd(a, b); }
+  static inline Packet Max(Packet a, Packet b) { return _mm_max_pd(a, b); }
+  static inline Packet Abs(Packet a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  static inline Packet CopySign(Packet magnitude, Packet sign) 
+    { return _mm_or_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), magnitude), _mm_and_pd(_mm_set1_pd(-0.0), sign)); }
+  // rounds to the nearest integer (SSE2 has no rounding instruction); valid for |a| < 2^31
+  static inline Packet Round(Packet a) { return _mm_cvtepi32_pd(_mm_cvtpd_epi32(a)); }
+  static inline Mask Greater(Packet a, Packet b) { return _mm_cmpgt_pd(a, b); }
+  static inline Mask Less(Packet a, Packet b) { return _mm_cmplt_pd(a, b); }
+  static inline Packet Select(Mask m, Packet a, Packet b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+#endif
+
+namespace DefaultKernels
+{
+#include "quaternionBatchKernels.h"
+}
+
+#ifdef QUATERNION_BATCH_AVX2
+
+// everything up to the pop below is compiled for AVX2 and FMA, and must only be called if the CPU supports them
+#ifdef __clang__
+  #pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+  #pragma GCC push_options
+  #pragma GCC target("avx2,fma")
+#endif
+
+namespace AVX2Kernels
+{
+struct AVXOps
+{
+  enum { width = 4 };
+  typedef __m256d Packet;
+  typedef __m256d Mask;
+
+  static inline Packet Load(const double * p) { return _mm256_loadu_pd(p); }
+  static inline Packet LoadStrided(const double * p, int stride) { return _mm256_set_pd(p[3 * stride], p[2 * stride], p[stride], p[0]); }
+  static inline void Store(double * p, Packet a) { _mm256_storeu_pd(p, a); }
+  static inline Packet Set(double a) { return _mm256_set1_pd(a); }
+  static inline Packet Add(Packet a, Packet b) { return _mm256_add_pd(a, b); }
+  static inline Packet Sub(Packet a, Packet b) { return _mm256_sub_pd(a, b); }
+  static inline Packet Mul(Packet a, Packet b) { return _mm256_mul_pd(a, b); }
+  static inline Packet Div(Packet a, Packet b) { return _mm256_div_pd(a, b); }
+  static inline Packet Sqrt(Packet a) { return _mm256_sqrt_pd(a); }
+  static inline Packet Min(Packet a, Packet b) { return _mm256_min_pd(a, b); }
+  static inline Packet Max(Packet a, Packet b) { return _mm256_max_pd(a, b); }
+  static inline Packet Abs(Packet a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  static inline Packet CopySign(Packet magnitude, Packet sign) 
+    { return _mm256_or_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), magnitude), _mm256_and_pd(_mm256_set1_pd(-0.0), sign)); }
+  static inline Packet Round(Packet a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static inline Mask Greater(Packet a, Packet b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static inline Mask Less(Packet a, Packet b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static inline Packet Select(Mask m, Packet a, Packet b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+#include "quaternionBatchKernels.h"
+
+// each routine processes the quaternions from i on, 4 at a time, and advances i past them;
+// the upper register halves are cleared at the end, or the (non-VEX) SSE code that runs afterwards, 
+// e.g., in libm, is several times slower
+
+static void Slerp(int & i, int count, const double * t, int tStride,
+  const double * const q0[4], const double * const q1[4], double * const q[4])
+{
+  SlerpLoop<AVXOps>(i, count, t, tStride, q0, q1, q);
+  _mm256_zeroupper();
+}
+
+static void ComputeSlerpArc(int & i, int count, const double * const q0[4], const double * const q1[4], double * const arc[9])
+{
+  ComputeSlerpArcLoop<AVXOps>(i, count, q0, q1, arc);
+  _mm256_zeroupper();
+}
+
+static void EvaluateSlerpArc(int & i, int count, const double * t, int tStride, const double * const arc[9], double * const q[4])
+{
+  EvaluateSlerpArcLoop<AVXOps>(i, count, t, tStride, arc, q);
+  _mm256_zeroupper();
+}
+
+static void EulerToQuaternion(int & i, int count, const double * const angles[3], double * const q[4])
+{
+  EulerToQuaternionLoop<AVXOps>(i, count, angles, q);
+  _mm256_zeroupper();
+}
+
+static void QuaternionToEuler(int & i, int count, const double * const q[4], double * const angles[3])
+{
+  QuaternionToEulerLoop<AVXOps>(i, count, q, angles);
+  _mm256_zeroupper();
+}
+
+static void EulerToRotationMatrix(int & i, int count, const double * const angles[3], double * const R[9])
+{
+  EulerToRotationMatrixLoop<AVXOps>(i, count, angles, R);
+  _mm256_zeroupper();
+}
+
+static void RotationAngle(int & i, int count, const double * const q0[4], const double * const q1[4], double * angles)
+{
+  RotationAngleLoop<AVXOps>(i, count, q0, q1, angles);
+  _mm256_zeroupper();
+}
+}
+
+#ifdef __clang__
+  #pragma clang attribute pop
+#else
+  #pragma GCC pop_options
+#endif
+
+// 1 if the AVX2 kernels can be used; the CPU is queried once
+static int UseAVX2()
+{
+#if defined(__AVX2__) && defined(__FMA__)
+  return 1;
+#else
+  static const int useAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return useAVX2;
+#endif
+}
+
+#endif
+
+using namespace DefaultKernels;
+
+void SlerpBatch(int count, const double * t, int tStride,
+  const double * const q0[4], const double * const q1[4], double * const q[4])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::Slerp(i, count, t, tStride, q0, q1, q);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  SlerpLoop<SSE2Ops>(i, count, t, tStride, q0, q1, q);
+#endif
+  SlerpLoop<ScalarOps>(i, count, t, tStride, q0, q1, q);
+}
+
+void ComputeSlerpArcBatch(int count, const double * const q0[4], const double * const q1[4], double * const arc[9])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::ComputeSlerpArc(i, count, q0, q1, arc);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  ComputeSlerpArcLoop<SSE2Ops>(i, count, q0, q1, arc);
+#endif
+  ComputeSlerpArcLoop<ScalarOps>(i, count, q0, q1, arc);
+}
+
+void EvaluateSlerpArcBatch(int count, const double * t, int tStride, const double * const arc[9], double * const q[4])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::EvaluateSlerpArc(i, count, t, tStride, arc, q);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  EvaluateSlerpArcLoop<SSE2Ops>(i, count, t, tStride, arc, q);
+#endif
+  EvaluateSlerpArcLoop<ScalarOps>(i, count, t, tStride, arc, q);
+}
+
+void EulerToQuaternionBatch(int count, const double * const angles[3], double * const q[4])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::EulerToQuaternion(i, count, angles, q);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  EulerToQuaternionLoop<SSE2Ops>(i, count, angles, q);
+#endif
+  EulerToQuaternionLoop<ScalarOps>(i, count, angles, q);
+}
+
+void QuaternionToEulerBatch(int count, const double * const q[4], double * const angles[3])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::QuaternionToEuler(i, count, q, angles);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  QuaternionToEulerLoop<SSE2Ops>(i, count, q, angles);
+#endif
+  QuaternionToEulerLoop<ScalarOps>(i, count, q, angles);
+}
+
+void EulerToRotationMatrixBatch(int count, const double * const angles[3], double * const R[9])
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::EulerToRotationMatrix(i, count, angles, R);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  EulerToRotationMatrixLoop<SSE2Ops>(i, count, angles, R);
+#endif
+  EulerToRotationMatrixLoop<ScalarOps>(i, count, angles, R);
+}
+
+void DeCasteljauQuaternionBatch(int count, const double * t, int tStride,
+  const double * const p0[4], const double * const p1[4], const double * const p2[4], const double * const p3[4], double * const q[4])
+{
+  // intermediate points Q0, Q1, Q2, R0, R1 of the construction, for a block of quaternions at a time
+  const int blockSize = 64;
+  double buffer[5][4][blockSize];
+  double * Q0[4], * Q1[4], * Q2[4], * R0[4], * R1[4];
+  for(int c=0; c<4; c++)
+  {
+    Q0[c] = buffer[0][c];
+    Q1[c] = buffer[1][c];
+    Q2[c] = buffer[2][c];
+    R0[c] = buffer[3][c];
+    R1[c] = buffer[4][c];
+  }
+
+  for(int start=0; start<count; start+=blockSize)
+  {
+    int blockCount = (count - start < blockSize) ? count - start : blockSize;
+    const double * tBlock = t + start * tStride;
+    const double * P0[4], * P1[4], * P2[4], * P3[4];
+    double * result[4];
+    for(int c=0; c<4; c++)
+    {
+      P0[c] = p0[c] + start;
+      P1[c] = p1[c] + start;
+      P2[c] = p2[c] + start;
+      P3[c] = p3[c] + start;
+      result[c] = q[c] + start;
+    }
+
+    SlerpBatch(blockCount, tBlock, tStride, P0, P1, Q0);
+    SlerpBatch(blockCount, tBlock, tStride, P1, P2, Q1);
+    SlerpBatch(blockCount, tBlock, tStride, P2, P3, Q2);
+    SlerpBatch(blockCount, tBlock, tStride, Q0, Q1, R0);
+    SlerpBatch(blockCount, tBlock, tStride, Q1, Q2, R1);
+    SlerpBatch(blockCount, tBlock, tStride, R0, R1, result);
+  }
+}
+
+void RotationAngleBatch(int count, const double * const q0[4], const double * const q1[4], double * angles)
+{
+  int i = 0;
+#ifdef QUATERNION_BATCH_AVX2
+  if (UseAVX2())
+    AVX2Kernels::RotationAngle(i, count, q0, q1, angles);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  RotationAngleLoop<SSE2Ops>(i, count, q0, q1, angles);
+#endif
+  RotationAngleLoop<ScalarOps>(i, count, q0, q1, angles);
+}
@@ -0,0 +1,77 @@
+/*
+quaternionBatch.h
+
+Quaternion operations on many quaternions at once (for example, the rotations
+of all bones of a frame, or of all frames of a channel).
+
+The quaternions are stored in structure-of-arrays layout: a set of quaternions
+is given by four pointers to the arrays of its s, x, y and z components:
+  const double * q[4] = { s, x, y, z };
+  quaternion i = (q[0][i], q[1][i], q[2][i], q[3][i])
+
+The routines process 4 (AVX2) or 2 (SSE2) quaternions per instruction, with a scalar loop
+for the remaining quaternions. With gcc and clang on x86, the AVX2 (and FMA) version is
+always compiled, and used if the CPU supports it (it is checked once, at the first call);
+it is about 2x faster than Interpolator::Slerp, the SSE2 version about as fast as Slerp.
+The trigonometric functions are evaluated with polynomial / rational approximations;
+the results agree with Interpolator::Slerp to about 1e-13 (use "benchmark slerp" to 
+measure the error and the speed). DeCasteljauQuaternion can differ by up to about 1e-5
+for nearly identical control points, because Slerp negates its arguments in place,
+which can switch a later Slerp between its spherical and its linear branch.
+*/
+
+#ifndef _QUATERNIONBATCH_H_
+#define _QUATERNIONBATCH_H_
+
+// q[i] = Slerp(t[i * tStride], q0[i], q1[i]), for i = 0, ..., count-1
+// Same result as Interpolator::Slerp: the inputs are normalized (the input arrays are not modified),
+// q1 is negated if that gives the shorter arc, nearly identical quaternions are interpolated linearly,
+// and the result is normalized.
+// tStride = 0 uses the same t for all quaternions. q may be the same arrays as q0 or q1.
+void SlerpBatch(int count, const double * t, int tStride,
+  const double * const q0[4], const double * const q1[4], double * const q[4]);
+
+// q[i] = DeCasteljauQuaternion(t[i * tStride], p0[i], p1[i], p2[i], p3[i]), for i = 0, ..., count-1
+// (the cubic Bezier spline with control points p0, p1, p2, p3, evaluated with the DeCasteljau construction)
+void DeCasteljauQuaternionBatch(int count, const double * t, int tStride,
+  const double * const p0[4], const double * const p1[4], const double * const p2[4], const double * const p3[4], double * const q[4]);
+
+// Slerp arcs: Slerp(t, q0, q1) prepared for the evaluation at many t; the evaluation needs no inverse trigonometric 
+// functions, and does not normalize the inputs again. An arc consists of 9 arrays (see GetSlerpArcArrays):
+// arc[0..3] = normalized q0, arc[4..7] = unit direction of the arc, arc[8] = angle of the arc.
+void ComputeSlerpArcBatch(int count, const double * const q0[4], const double * const q1[4], double * const arc[9]);
+// q[i] = Slerp(t[i * tStride], q0[i], q1[i]), for i = 0, ..., count-1 (same result as SlerpBatch)
+void EvaluateSlerpArcBatch(int count, const double * t, int tStride, const double * const arc[9], double * const q[4]);
+
+// Euler angles <-> quaternions, for count rotations
+// The angles are given in degrees, in the XYZ order of Interpolator (R = Rz * Ry * Rx), as three arrays angles[0..2] of x, y and z angles.
+// The results are the same as those of Interpolator::Euler2Quaternion and Quaternion2Euler (up to round-off), including 
+// the sign of the quaternion and the angles chosen at gimbal lock; the sign may differ only where two components of the 
+// quaternion have the same absolute value (which happens at gimbal lock). The input and output arrays must not overlap.
+void EulerToQuaternionBatch(int count, const double * const angles[3], double * const q[4]);
+void QuaternionToEulerBatch(int count, const double * const q[4], double * const angles[3]);
+
+// R[3 * r + c][i] = entry (r, c) of the rotation matrix Rz * Ry * Rx of the Euler angles i (in degrees, as above), 
+// for i = 0, ..., count-1; the same matrix as Interpolator::Euler2Rotation (up to round-off)
+void EulerToRotationMatrixBatch(int count, const double * const angles[3], double * const R[9]);
+
+// angles[i] = angle (in degrees, 0..180) of the rotation from q0[i] to q1[i] (the geodesic distance of the rotations),
+// for unit quaternions; q0[i] and -q0[i] give the same angle
+void RotationAngleBatch(int count, const double * const q0[4], const double * const q1[4], double * angles);
+
+// sets q[0..3] to the component arrays of count quaternions stored consecutively at data (all s, then all x, ...)
+inline void GetQuaternionArrays(double * data, int count, double * q[4])
+{
+  for(int i=0; i<4; i++)
+    q[i] = data + i * count;
+}
+
+// sets arc[0..8] to the arrays of count Slerp arcs stored consecutively at data
+inline void GetSlerpArcArrays(double * data, int count, double * arc[9])
+{
+  for(int i=0; i<9; i++)
+    arc[i] = data + i * count;
+}
+
+#endif
+
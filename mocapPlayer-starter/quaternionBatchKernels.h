@@ -0,0 +1,383 @@
+/*
+quaternionBatchKernels.h
+
+The kernels of the batched quaternion operations (see quaternionBatch.h), written once for 
+a "packet" of Ops::width doubles; Ops provides the packet operations (see quaternionBatch.cpp).
+Internal to quaternionBatch.cpp, which includes this file twice: once for the default instruction 
+set, and once for AVX2 and FMA (hence no include guard).
+*/
+
+// atan(x) for x on [0,1]: rational approximation on [0,0.66] (Cephes), and atan(x) = pi/4 + atan((x-1)/(x+1)) above; relative error about 1e-16
+template<class Ops>
+static inline typename Ops::Packet Atan(typename Ops::Packet x)
+{
+  typedef typename Ops::Packet Packet;
+  typename Ops::Mask reduce = Ops::Greater(x, Ops::Set(0.66));
+  Packet y = Ops::Select(reduce, Ops::Div(Ops::Sub(x, Ops::Set(1.0)), Ops::Add(x, Ops::Set(1.0))), x);
+  Packet z = Ops::Mul(y, y);
+
+  Packet p = Ops::Set(-8.750608600031904122785e-1);
+  p = Ops::Add(Ops::Mul(p, z), Ops::Set(-1.615753718733365076637e1));
+  p = Ops::Add(Ops::Mul(p, z), Ops::Set(-7.500855792314704667340e1));
+  p = Ops::Add(Ops::Mul(p, z), Ops::Set(-1.228866684490136173410e2));
+  p = Ops::Add(Ops::Mul(p, z), Ops::Set(-6.485021904942025371773e1));
+
+  Packet q = Ops::Add(z, Ops::Set(2.485846490142306297962e1));
+  q = Ops::Add(Ops::Mul(q, z), Ops::Set(1.650270098316988542046e2));
+  q = Ops::Add(Ops::Mul(q, z), Ops::Set(4.328810604912902668951e2));
+  q = Ops::Add(Ops::Mul(q, z), Ops::Set(4.853903996359136964868e2));
+  q = Ops::Add(Ops::Mul(q, z), Ops::Set(1.945506571482613964425e2));
+
+  Packet r = Ops::Add(y, Ops::Mul(y, Ops::Div(Ops::Mul(z, p), q)));
+  return Ops::Add(r, Ops::Select(reduce, Ops::Set(0.78539816339744830962), Ops::Set(0.0)));
+}
+
+// atan2(y, x), using the symmetries of atan to reduce the argument to [0,1]
+template<class Ops>
+static inline typename Ops::Packet Atan2(typename Ops::Packet y, typename Ops::Packet x)
+{
+  typedef typename Ops::Packet Packet;
+  Packet absX = Ops::Abs(x);
+  Packet absY = Ops::Abs(y);
+  Packet maxXY = Ops::Max(absX, absY);
+  // atan2(0,0) = 0 (the division gives NaN in that case)
+  Packet ratio = Ops::Select(Ops::Greater(maxXY, Ops::Set(0.0)), Ops::Div(Ops::Min(absX, absY), maxXY), Ops::Set(0.0));
+  Packet r = Atan<Ops>(ratio);
+  r = Ops::Select(Ops::Greater(absY, absX), Ops::Sub(Ops::Set(M_PI / 2), r), r);
+  r = Ops::Select(Ops::Less(x, Ops::Set(0.0)), Ops::Sub(Ops::Set(M_PI), r), r);
+  return Ops::CopySign(r, y);
+}
+
+// sin(x) and cos(x) for any x: the argument is reduced to r on [-pi,pi], the Taylor series
+// are evaluated at r/2 (on [-pi/2,pi/2], truncation error < 1e-15), and the double-angle formulas give sin(r), cos(r)
+// (absolute error about 1e-15 for |x| <= 2 pi)
+template<class Ops>
+static inline void SinCos(typename Ops::Packet x, typename Ops::Packet * sinX, typename Ops::Packet * cosX)
+{
+  typedef typename Ops::Packet Packet;
+  // 2 pi = twoPiHigh + twoPiLow (more bits for the reduction of large arguments)
+  const double twoPiHigh = 6.283185307179586, twoPiLow = 2.4492935982947064e-16;
+  Packet k = Ops::Round(Ops::Mul(x, Ops::Set(1.0 / twoPiHigh)));
+  Packet r = Ops::Sub(Ops::Sub(x, Ops::Mul(k, Ops::Set(twoPiHigh))), Ops::Mul(k, Ops::Set(twoPiLow)));
+
+  Packet h = Ops::Mul(r, Ops::Set(0.5));
+  Packet h2 = Ops::Mul(h, h);
+
+  // sin(h) = h (1 - h^2/3! + h^4/5! - ... - h^18/19!)
+  Packet s = Ops::Set(-1.0 / 121645100408832000.0);
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(1.0 / 355687428096000.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(-1.0 / 1307674368000.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(1.0 / 6227020800.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(-1.0 / 39916800.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(1.0 / 362880.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(-1.0 / 5040.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(1.0 / 120.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(-1.0 / 6.0));
+  s = Ops::Add(Ops::Mul(s, h2), Ops::Set(1.0));
+  s = Ops::Mul(s, h);
+
+  // cos(h) = 1 - h^2/2! + h^4/4! - ... - h^18/18! + h^20/20!
+  Packet c = Ops::Set(1.0 / 2432902008176640000.0);
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(-1.0 / 6402373705728000.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(1.0 / 20922789888000.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(-1.0 / 87178291200.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(1.0 / 479001600.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(-1.0 / 3628800.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(1.0 / 40320.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(-1.0 / 720.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(1.0 / 24.0));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(-0.5));
+  c = Ops::Add(Ops::Mul(c, h2), Ops::Set(1.0));
+
+  *sinX = Ops::Mul(Ops::Set(2.0), Ops::Mul(s, c));
+  *cosX = Ops::Mul(Ops::Sub(c, s), Ops::Add(c, s));
+}
+
+template<class Ops>
+static inline void Normalize(typename Ops::Packet q[4])
+{
+  typedef typename Ops::Packet Packet;
+  Packet norm2 = Ops::Mul(q[0], q[0]);
+  for(int c=1; c<4; c++)
+    norm2 = Ops::Add(norm2, Ops::Mul(q[c], q[c]));
+  Packet invNorm = Ops::Div(Ops::Set(1.0), Ops::Sqrt(norm2));
+  for(int c=0; c<4; c++)
+    q[c] = Ops::Mul(q[c], invNorm);
+}
+
+// the arc of Slerp(t, a, b), for unit quaternions a and b (b is modified): direction receives the unit quaternion orthogonal 
+// to a in the direction of b, and angle the angle of the arc, so that Slerp(t, a, b) = a cos(t angle) + direction sin(t angle);
+// if a and b are nearly identical, the quaternions are interpolated linearly: direction = b and angle = 0 
+template<class Ops>
+static inline void ComputeArc(const typename Ops::Packet a[4], typename Ops::Packet b[4], typename Ops::Packet direction[4], typename Ops::Packet * angle)
+{
+  typedef typename Ops::Packet Packet;
+  typedef typename Ops::Mask Mask;
+  const double threshold = 0.9995;
+
+  Packet dot = Ops::Mul(a[0], b[0]);
+  for(int c=1; c<4; c++)
+    dot = Ops::Add(dot, Ops::Mul(a[c], b[c]));
+
+  // as in Interpolator::Slerp, the threshold is tested before taking the shorter arc
+  Mask linear = Ops::Greater(dot, Ops::Set(threshold));
+  Packet sign = Ops::Select(Ops::Less(dot, Ops::Set(0.0)), Ops::Set(-1.0), Ops::Set(1.0));
+  dot = Ops::Min(Ops::Mul(dot, sign), Ops::Set(1.0));
+
+  // mid = component of b orthogonal to a (undefined for the lanes that are interpolated linearly)
+  Packet mid[4];
+  Packet midNorm2 = Ops::Set(0.0);
+  for(int c=0; c<4; c++)
+  {
+    b[c] = Ops::Mul(b[c], sign);
+    mid[c] = Ops::Sub(b[c], Ops::Mul(a[c], dot));
+    midNorm2 = Ops::Add(midNorm2, Ops::Mul(mid[c], mid[c]));
+  }
+  Packet midNorm = Ops::Sqrt(midNorm2);
+  Packet invMidNorm = Ops::Div(Ops::Set(1.0), midNorm);
+  for(int c=0; c<4; c++)
+    direction[c] = Ops::Select(linear, b[c], Ops::Mul(mid[c], invMidNorm));
+
+  // acos(dot) = 2 atan(sin / (1 + cos)), accurate also for small angles
+  *angle = Ops::Select(linear, Ops::Set(0.0), Ops::Mul(Ops::Set(2.0), Atan<Ops>(Ops::Div(midNorm, Ops::Add(Ops::Set(1.0), dot)))));
+}
+
+// r = Slerp(t, a, b), given the arc computed by ComputeArc
+template<class Ops>
+static inline void EvaluateArc(const typename Ops::Packet a[4], const typename Ops::Packet direction[4], typename Ops::Packet angle, 
+  typename Ops::Packet t, typename Ops::Packet r[4])
+{
+  typedef typename Ops::Packet Packet;
+  Packet sinAngle, cosAngle;
+  SinCos<Ops>(Ops::Mul(angle, t), &sinAngle, &cosAngle);
+
+  // linear lanes (angle 0): a (1-t) + b t
+  typename Ops::Mask spherical = Ops::Greater(angle, Ops::Set(0.0));
+  Packet weightA = Ops::Select(spherical, cosAngle, Ops::Sub(Ops::Set(1.0), t));
+  Packet weightB = Ops::Select(spherical, sinAngle, t);
+  for(int c=0; c<4; c++)
+    r[c] = Ops::Add(Ops::Mul(a[c], weightA), Ops::Mul(direction[c], weightB));
+  Normalize<Ops>(r);
+}
+
+// slerp of the Ops::width quaternions starting at index i
+template<class Ops>
+static inline void SlerpPacket(typename Ops::Packet t, const double * const q0[4], const double * const q1[4], double * const q[4], int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet a[4], b[4];
+  for(int c=0; c<4; c++)
+  {
+    a[c] = Ops::Load(q0[c] + i);
+    b[c] = Ops::Load(q1[c] + i);
+  }
+  Normalize<Ops>(a);
+  Normalize<Ops>(b);
+
+  Packet direction[4], angle, r[4];
+  ComputeArc<Ops>(a, b, direction, &angle);
+  EvaluateArc<Ops>(a, direction, angle, t, r);
+
+  for(int c=0; c<4; c++)
+    Ops::Store(q[c] + i, r[c]);
+}
+
+// arcs of the Ops::width quaternion pairs starting at index i
+template<class Ops>
+static inline void ComputeSlerpArcPacket(const double * const q0[4], const double * const q1[4], double * const arc[9], int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet a[4], b[4];
+  for(int c=0; c<4; c++)
+  {
+    a[c] = Ops::Load(q0[c] + i);
+    b[c] = Ops::Load(q1[c] + i);
+  }
+  Normalize<Ops>(a);
+  Normalize<Ops>(b);
+
+  Packet direction[4], angle;
+  ComputeArc<Ops>(a, b, direction, &angle);
+
+  for(int c=0; c<4; c++)
+  {
+    Ops::Store(arc[c] + i, a[c]);
+    Ops::Store(arc[4 + c] + i, direction[c]);
+  }
+  Ops::Store(arc[8] + i, angle);
+}
+
+template<class Ops>
+static inline void EvaluateSlerpArcPacket(typename Ops::Packet t, const double * const arc[9], double * const q[4], int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet a[4], direction[4], r[4];
+  for(int c=0; c<4; c++)
+  {
+    a[c] = Ops::Load(arc[c] + i);
+    direction[c] = Ops::Load(arc[4 + c] + i);
+  }
+  EvaluateArc<Ops>(a, direction, Ops::Load(arc[8] + i), t, r);
+
+  for(int c=0; c<4; c++)
+    Ops::Store(q[c] + i, r[c]);
+}
+
+// converts the Ops::width Euler angle triples starting at index i (see EulerToQuaternionBatch)
+template<class Ops>
+static inline void EulerToQuaternionPacket(const double * const angles[3], double * const q[4], int i)
+{
+  typedef typename Ops::Packet Packet;
+  // half angles, in radians
+  Packet sinHalf[3], cosHalf[3];
+  for(int c=0; c<3; c++)
+    SinCos<Ops>(Ops::Mul(Ops::Load(angles[c] + i), Ops::Set(M_PI / 360.0)), &sinHalf[c], &cosHalf[c]);
+
+  // q = qz * qy * qx
+  Packet cxcy = Ops::Mul(cosHalf[0], cosHalf[1]), sxsy = Ops::Mul(sinHalf[0], sinHalf[1]);
+  Packet sxcy = Ops::Mul(sinHalf[0], cosHalf[1]), cxsy = Ops::Mul(cosHalf[0], sinHalf[1]);
+  Packet r[4];
+  r[0] = Ops::Add(Ops::Mul(cxcy, cosHalf[2]), Ops::Mul(sxsy, sinHalf[2]));
+  r[1] = Ops::Sub(Ops::Mul(sxcy, cosHalf[2]), Ops::Mul(cxsy, sinHalf[2]));
+  r[2] = Ops::Add(Ops::Mul(cxsy, cosHalf[2]), Ops::Mul(sxcy, sinHalf[2]));
+  r[3] = Ops::Sub(Ops::Mul(cxcy, sinHalf[2]), Ops::Mul(sxsy, cosHalf[2]));
+
+  // sign, as chosen by Quaternion::Matrix2Quaternion: s >= 0 if the trace 4 s^2 - 1 of the rotation
+  // matrix is non-negative, otherwise the largest of x, y, z (in absolute value) is positive
+  Packet r2[4];
+  for(int c=0; c<4; c++)
+    r2[c] = Ops::Mul(r[c], r[c]);
+  typename Ops::Mask yOverX = Ops::Greater(r2[2], r2[1]);
+  Packet pivot = Ops::Select(yOverX, r[2], r[1]);
+  pivot = Ops::Select(Ops::Greater(r2[3], Ops::Select(yOverX, r2[2], r2[1])), r[3], pivot);
+  Packet trace = Ops::Sub(Ops::Mul(Ops::Set(4.0), r2[0]), Ops::Set(1.0));
+  pivot = Ops::Select(Ops::Less(trace, Ops::Set(0.0)), pivot, r[0]);
+  Packet sign = Ops::Select(Ops::Less(pivot, Ops::Set(0.0)), Ops::Set(-1.0), Ops::Set(1.0));
+
+  for(int c=0; c<4; c++)
+    Ops::Store(q[c] + i, Ops::Mul(r[c], sign));
+}
+
+// converts the Ops::width Euler angle triples starting at index i (see EulerToRotationMatrixBatch)
+template<class Ops>
+static inline void EulerToRotationMatrixPacket(const double * const angles[3], double * const R[9], int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet sinA[3], cosA[3];
+  for(int c=0; c<3; c++)
+    SinCos<Ops>(Ops::Mul(Ops::Load(angles[c] + i), Ops::Set(M_PI / 180.0)), &sinA[c], &cosA[c]);
+
+  // Rz * Ry * Rx
+  Packet sxsy = Ops::Mul(sinA[0], sinA[1]), cxsy = Ops::Mul(cosA[0], sinA[1]);
+  Ops::Store(R[0] + i, Ops::Mul(cosA[1], cosA[2]));
+  Ops::Store(R[1] + i, Ops::Sub(Ops::Mul(sxsy, cosA[2]), Ops::Mul(cosA[0], sinA[2])));
+  Ops::Store(R[2] + i, Ops::Add(Ops::Mul(sinA[0], sinA[2]), Ops::Mul(cxsy, cosA[2])));
+  Ops::Store(R[3] + i, Ops::Mul(cosA[1], sinA[2]));
+  Ops::Store(R[4] + i, Ops::Add(Ops::Mul(cosA[0], cosA[2]), Ops::Mul(sxsy, sinA[2])));
+  Ops::Store(R[5] + i, Ops::Sub(Ops::Mul(cxsy, sinA[2]), Ops::Mul(sinA[0], cosA[2])));
+  Ops::Store(R[6] + i, Ops::Sub(Ops::Set(0.0), sinA[1]));
+  Ops::Store(R[7] + i, Ops::Mul(sinA[0], cosA[1]));
+  Ops::Store(R[8] + i, Ops::Mul(cosA[0], cosA[1]));
+}
+
+// converts the Ops::width quaternions starting at index i (see QuaternionToEulerBatch)
+template<class Ops>
+static inline void QuaternionToEulerPacket(const double * const q[4], double * const angles[3], int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet s = Ops::Load(q[0] + i), x = Ops::Load(q[1] + i), y = Ops::Load(q[2] + i), z = Ops::Load(q[3] + i);
+  Packet one = Ops::Set(1.0), two = Ops::Set(2.0);
+
+  // the entries of the rotation matrix (as in Quaternion::Quaternion2Matrix) that determine the angles
+  Packet R0 = Ops::Sub(Ops::Sub(one, Ops::Mul(two, Ops::Mul(y, y))), Ops::Mul(two, Ops::Mul(z, z)));
+  Packet R3 = Ops::Add(Ops::Mul(two, Ops::Mul(x, y)), Ops::Mul(two, Ops::Mul(s, z)));
+  Packet R4 = Ops::Sub(Ops::Sub(one, Ops::Mul(two, Ops::Mul(x, x))), Ops::Mul(two, Ops::Mul(z, z)));
+  Packet R5 = Ops::Sub(Ops::Mul(two, Ops::Mul(y, z)), Ops::Mul(two, Ops::Mul(s, x)));
+  Packet R6 = Ops::Sub(Ops::Mul(two, Ops::Mul(x, z)), Ops::Mul(two, Ops::Mul(s, y)));
+  Packet R7 = Ops::Add(Ops::Mul(two, Ops::Mul(y, z)), Ops::Mul(two, Ops::Mul(s, x)));
+  Packet R8 = Ops::Sub(Ops::Sub(one, Ops::Mul(two, Ops::Mul(x, x))), Ops::Mul(two, Ops::Mul(y, y)));
+
+  // as in Interpolator::Rotation2Euler, including the gimbal lock case cos(angle y) = 0
+  Packet cy = Ops::Sqrt(Ops::Add(Ops::Mul(R0, R0), Ops::Mul(R3, R3)));
+  typename Ops::Mask regular = Ops::Greater(cy, Ops::Set(16 * DBL_EPSILON));
+  Packet toDegrees = Ops::Set(180 / M_PI);
+  Packet angleX = Ops::Select(regular, Atan2<Ops>(R7, R8), Atan2<Ops>(Ops::Sub(Ops::Set(0.0), R5), R4));
+  Packet angleY = Atan2<Ops>(Ops::Sub(Ops::Set(0.0), R6), cy);
+  Packet angleZ = Ops::Select(regular, Atan2<Ops>(R3, R0), Ops::Set(0.0));
+  Ops::Store(angles[0] + i, Ops::Mul(angleX, toDegrees));
+  Ops::Store(angles[1] + i, Ops::Mul(angleY, toDegrees));
+  Ops::Store(angles[2] + i, Ops::Mul(angleZ, toDegrees));
+}
+
+// angles of the relative rotations of the Ops::width quaternion pairs starting at index i (see RotationAngleBatch)
+template<class Ops>
+static inline void RotationAnglePacket(const double * const q0[4], const double * const q1[4], double * angles, int i)
+{
+  typedef typename Ops::Packet Packet;
+  Packet as = Ops::Load(q0[0] + i), ax = Ops::Load(q0[1] + i), ay = Ops::Load(q0[2] + i), az = Ops::Load(q0[3] + i);
+  Packet bs = Ops::Load(q1[0] + i), bx = Ops::Load(q1[1] + i), by = Ops::Load(q1[2] + i), bz = Ops::Load(q1[3] + i);
+
+  // r = conj(a) b; the angle is 2 atan2(|r_xyz|, |r_s|), which is accurate also for small angles (unlike acos)
+  Packet rs = Ops::Add(Ops::Add(Ops::Mul(as, bs), Ops::Mul(ax, bx)), Ops::Add(Ops::Mul(ay, by), Ops::Mul(az, bz)));
+  Packet rx = Ops::Sub(Ops::Sub(Ops::Mul(as, bx), Ops::Mul(bs, ax)), Ops::Sub(Ops::Mul(ay, bz), Ops::Mul(az, by)));
+  Packet ry = Ops::Sub(Ops::Sub(Ops::Mul(as, by), Ops::Mul(bs, ay)), Ops::Sub(Ops::Mul(az, bx), Ops::Mul(ax, bz)));
+  Packet rz = Ops::Sub(Ops::Sub(Ops::Mul(as, bz), Ops::Mul(bs, az)), Ops::Sub(Ops::Mul(ax, by), Ops::Mul(ay, bx)));
+  Packet v = Ops::Sqrt(Ops::Add(Ops::Add(Ops::Mul(rx, rx), Ops::Mul(ry, ry)), Ops::Mul(rz, rz)));
+  Ops::Store(angles + i, Ops::Mul(Atan2<Ops>(v, Ops::Abs(rs)), Ops::Set(360.0 / M_PI)));
+}
+
+template<class Ops>
+static inline void SlerpLoop(int & i, int count, const double * t, int tStride,
+  const double * const q0[4], const double * const q1[4], double * const q[4])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+  {
+    typename Ops::Packet tPacket = (tStride == 0) ? Ops::Set(t[0]) : Ops::LoadStrided(t + i * tStride, tStride);
+    SlerpPacket<Ops>(tPacket, q0, q1, q, i);
+  }
+}
+
+template<class Ops>
+static inline void EvaluateSlerpArcLoop(int & i, int count, const double * t, int tStride, const double * const arc[9], double * const q[4])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+  {
+    typename Ops::Packet tPacket = (tStride == 0) ? Ops::Set(t[0]) : Ops::LoadStrided(t + i * tStride, tStride);
+    EvaluateSlerpArcPacket<Ops>(tPacket, arc, q, i);
+  }
+}
+
+template<class Ops>
+static inline void ComputeSlerpArcLoop(int & i, int count, const double * const q0[4], const double * const q1[4], double * const arc[9])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+    ComputeSlerpArcPacket<Ops>(q0, q1, arc, i);
+}
+
+template<class Ops>
+static inline void EulerToQuaternionLoop(int & i, int count, const double * const angles[3], double * const q[4])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+    EulerToQuaternionPacket<Ops>(angles, q, i);
+}
+
+template<class Ops>
+static inline void QuaternionToEulerLoop(int & i, int count, const double * const q[4], double * const angles[3])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+    QuaternionToEulerPacket<Ops>(q, angles, i);
+}
+
+template<class Ops>
+static inline void EulerToRotationMatrixLoop(int & i, int count, const double * const angles[3], double * const R[9])
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+    EulerToRotationMatrixPacket<Ops>(angles, R, i);
+}
+
+template<class Ops>
+static inline void RotationAngleLoop(int & i, int count, const double * const q0[4], const double * const q1[4], double * angles)
+{
+  for(; i + (int)Ops::width <= count; i += Ops::width)
+    RotationAnglePacket<Ops>(q0, q1, angles, i);
+}
@@ -16,21 +16,36 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
   #pragma warning(disable : 4996)
 #endif
 
-int Skeleton::numBonesInSkel(Bone bone)
+// breadth-first traversal of the child / sibling pointers; the children of each bone are consecutive
+void Skeleton::buildTopology()
 {
-  Bone * tmp = bone.sibling;
-  int numBones = 0;
-  while (tmp != NULL) 
+  for(int j=0; j<MAX_BONES_IN_ASF_FILE; j++)
   {
-    if (tmp->child != NULL)
-      numBones += numBonesInSkel(*(tmp->child));
-    numBones++; 
-    tmp = tmp->sibling; 
+    m_Parent[j] = -1;
+    m_FirstChild[j] = 0;
+    m_NumChildren[j] = 0;
+  }
+
+  m_NumBones = 0;
+  m_TopologicalOrder[m_NumBones++] = getRootIndex();
+  for(int i=0; i<m_NumBones; i++)
+  {
+    int parent = m_TopologicalOrder[i];
+    m_FirstChild[parent] = m_NumBones;
+    for(Bone * child = m_pBoneList[parent].child; (child != NULL) && (m_NumBones < MAX_BONES_IN_ASF_FILE); child = child->sibling)
+    {
+      m_Parent[child->idx] = parent;
+      m_TopologicalOrder[m_NumBones++] = child->idx;
+      m_NumChildren[parent]++;
+    }
+  }
+
+  m_NumMovableBones = 0;
+  for(int i=0; i<m_NumBones; i++)
+  {
+    if (m_pBoneList[m_TopologicalOrder[i]].dof > 0)
+      m_NumMovableBones++;
   }
-  if (bone.child != NULL)
-    return numBones + 1 + numBonesInSkel(*bone.child);
-  else
-    return numBones + 1;
 }
 
 void Skeleton::removeCR(char * str)
@@ -39,44 +54,55 @@ void Skeleton::removeCR(char * str)
     str[strlen(str) - 1] = 0;    
 }
 
-int Skeleton::movBonesInSkel(Bone bone)
+// FNV-1a
+unsigned int Skeleton::hashName(const char * name, int length)
 {
-  Bone * tmp = bone.sibling;
-  int numBones = 0;
+  unsigned int hash = 2166136261u;
+  for(int i=0; i<length; i++)
+  {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
 
-  if (bone.dof > 0) numBones++;
+void Skeleton::buildNameTable()
+{
+  for(int i=0; i<boneNameHashTableSize; i++)
+    m_BoneNameHashTable[i] = -1;
+  for(int j=0; j<MAX_BONES_IN_ASF_FILE; j++)
+    m_BoneNameLength[j] = 0;
 
-  while (tmp != NULL) 
+  for(int j=0; j<NUM_BONES_IN_ASF_FILE; j++)
   {
-    if (tmp->child != NULL)
-      numBones += movBonesInSkel(*(tmp->child));
-    if (tmp->dof > 0) 
-    numBones++; 
-    tmp = tmp->sibling; 
+    m_BoneNameLength[j] = (int)strlen(m_pBoneList[j].name);
+    unsigned int slot = hashName(m_pBoneList[j].name, m_BoneNameLength[j]) & (boneNameHashTableSize - 1);
+    while (m_BoneNameHashTable[slot] >= 0)
+      slot = (slot + 1) & (boneNameHashTableSize - 1);
+    m_BoneNameHashTable[slot] = j;
   }
-
-  if (bone.child != NULL)
-    return (numBones + movBonesInSkel(*bone.child));
-  else
-    return numBones;
 }
 
 // helper function to convert ASF part name into bone index
-int Skeleton::name2idx(char *name)
+int Skeleton::name2idx(const char * name) const
 {
-  int i=0;
-  while(strcmp(m_pBoneList[i].name, name) != 0 && i++ < NUM_BONES_IN_ASF_FILE);
-  return m_pBoneList[i].idx;
+  return name2idx(name, (int)strlen(name));
 }
 
-char * Skeleton::idx2name(int idx)
+int Skeleton::name2idx(const char * name, int length) const
 {
-  int i=0;
-  while(m_pBoneList[i].idx != idx && i++ < NUM_BONES_IN_ASF_FILE);
-  return m_pBoneList[i].name;
+  unsigned int slot = hashName(name, length) & (boneNameHashTableSize - 1);
+  while (m_BoneNameHashTable[slot] >= 0)
+  {
+    int j = m_BoneNameHashTable[slot];
+    if ((m_BoneNameLength[j] == length) && (memcmp(m_pBoneList[j].name, name, length) == 0))
+      return j;
+    slot = (slot + 1) & (boneNameHashTableSize - 1);
+  }
+  return -1;
 }
 
-int Skeleton::readASFfile(char* asf_filename, double scale)
+int Skeleton::readASFfile(char* asf_filename, double scale, int quiet)
 {
   //open file
   std::ifstream is(asf_filename, std::ios::in);
@@ -181,10 +207,13 @@ int Skeleton::readASFfile(char* asf_filename, double scale)
           end:
             token=strtok(NULL, " ");
         }
-        printf("Bone %d DOF: ",i);
-        for (int x = 0; (x < 7) && (m_pBoneList[i].dofo[x] != 0); x++) 
-	  printf("%d ",m_pBoneList[i].dofo[x]);
-        printf("\n");
+        if (!quiet)
+        {
+          printf("Bone %d DOF: ",i);
+          for (int x = 0; (x < 7) && (m_pBoneList[i].dofo[x] != 0); x++) 
+	    printf("%d ",m_pBoneList[i].dofo[x]);
+          printf("\n");
+        }
       }
     }
 
@@ -194,7 +223,9 @@ int Skeleton::readASFfile(char* asf_filename, double scale)
       MOV_BONES_IN_ASF_FILE -= 1;
     m_pBoneList[i].length = length * scale;
   }
-  printf("READ %d\n",NUM_BONES_IN_ASF_FILE);
+  if (!quiet)
+    printf("READ %d\n",NUM_BONES_IN_ASF_FILE);
+  buildNameTable();
 
   //
   //read and build the hierarchy of the skeleton
@@ -233,10 +264,16 @@ int Skeleton::readASFfile(char* asf_filename, double scale)
       j=0;
       while(part_name != NULL)
       {
+        int boneIndex = name2idx(part_name);
+        if (boneIndex < 0)
+        {
+          printf("Error: bone %s in the hierarchy is not defined.\n", part_name);
+          return -1;
+        }
         if(j==0) 
-          parent=name2idx(part_name);
+          parent=boneIndex;
         else 
-          setChildrenAndSibling(parent, &m_pBoneList[name2idx(part_name)]);
+          setChildrenAndSibling(parent, &m_pBoneList[boneIndex]);
         part_name=strtok(NULL, " ");
         j++;
       }
@@ -250,27 +287,14 @@ int Skeleton::readASFfile(char* asf_filename, double scale)
 
 
 /*
-This recursive function traverces skeleton hierarchy 
-and returns a pointer to the bone with index - bIndex
-ptr should be a pointer to the root node 
-when this function first called
+Returns a pointer to the bone with index bIndex 
+(the index of a bone is its position in the bone list)
 */
-Bone* Skeleton::getBone(Bone *ptr, int bIndex)
+Bone* Skeleton::getBone(int bIndex)
 {
-  static Bone *theptr;
-  if(ptr==NULL) 
+  if ((bIndex < 0) || (bIndex >= NUM_BONES_IN_ASF_FILE))
     return(NULL);
-  else if(ptr->idx == bIndex)
-  {
-    theptr=ptr;
-    return(theptr);
-  }
-  else
-  { 
-    getBone(ptr->child, bIndex);
-    getBone(ptr->sibling, bIndex);
-    return(theptr);
-  }
+  return(&m_pBoneList[bIndex]);
 }
 
 /*
@@ -283,8 +307,8 @@ int Skeleton::setChildrenAndSibling(int parent, Bone *pChild)
 {
   Bone *pParent;  
 
-  //Get pointer to root bone
-  pParent = getBone(m_pRootBone, parent);
+  //Get pointer to the parent bone
+  pParent = getBone(parent);
 
   if(pParent==NULL)
   {
@@ -316,7 +340,7 @@ int Skeleton::setChildrenAndSibling(int parent, Bone *pChild)
 /* 
 Return the pointer to the root bone
 */	
-Bone * Skeleton::getRoot()
+const Bone * Skeleton::getRoot() const
 {
   return(m_pRootBone);
 }
@@ -372,7 +396,6 @@ void Skeleton::compute_rotation_parent_child(Bone *parent, Bone *child)
 // loop through all bones to calculate local coordinate's direction vector and relative orientation  
 void Skeleton::ComputeRotationToParentCoordSystem(Bone *bone)
 {
-  int i;
   double Rx[4][4], Ry[4][4], Rz[4][4], tmp[4][4], tmp2[4][4];
 
   //Compute rot_parent_current for the root 
@@ -391,22 +414,10 @@ void Skeleton::ComputeRotationToParentCoordSystem(Bone *bone)
 
 
   //Compute rot_parent_current for all other bones
-  int numbones = numBonesInSkel(bone[0]);
-  for(i=0; i<numbones; i++) 
+  for(int j=1; j<m_NumBones; j++) 
   {
-    if(bone[i].child != NULL)
-    {
-      compute_rotation_parent_child(&bone[i], bone[i].child);
-
-      // compute parent child siblings...
-      Bone * tmp = NULL;
-      if (bone[i].child != NULL) tmp = (bone[i].child)->sibling;
-      while (tmp != NULL)
-      {
-        compute_rotation_parent_child(&bone[i], tmp);
-        tmp = tmp->sibling;
-      }
-    }
+    int child = m_TopologicalOrder[j];
+    compute_rotation_parent_child(&bone[m_Parent[child]], &bone[child]);
   }
 }
 
@@ -426,105 +437,79 @@ void Skeleton::RotateBoneDirToLocalCoordSystem()
   }
 }
 
-/******************************************************************************
-Interface functions to set the pose of the skeleton 
-******************************************************************************/
-
-//Initial posture Root at (0,0,0)
-//All bone rotations are set to 0
-void Skeleton::setBasePosture()
-{
-  int i;
-  m_RootPos[0] = m_RootPos[1] = m_RootPos[2] = 0.0;
-
-  for(i=0;i<NUM_BONES_IN_ASF_FILE;i++)
-  {
-    m_pBoneList[i].rx = m_pBoneList[i].ry = m_pBoneList[i].rz = 0.0;
-    m_pBoneList[i].tx = m_pBoneList[i].ty = m_pBoneList[i].tz = 0.0;
-  }
-}
-
 void Skeleton::enableAllRotationalDOFs()
 {
+  if (m_AllRotationalDOFs)
+    return;
+
   for(int j=0;j<NUM_BONES_IN_ASF_FILE;j++)
   {
     if (m_pBoneList[j].dof == 0)
       continue;
 
-    if(!m_pBoneList[j].dofrx) 
-    {
-      m_pBoneList[j].dofrx = 1;
-      m_pBoneList[j].rx = 0.0;
-      m_pBoneList[j].dof++;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof-1] = 1;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof] = 0;
-    }
-
-    if(!m_pBoneList[j].dofry) 
-    {
-      m_pBoneList[j].dofry = 1;
-      m_pBoneList[j].ry = 0.0;
-      m_pBoneList[j].dof++;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof-1] = 2;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof] = 0;
-    }
-
-    if(!m_pBoneList[j].dofrz) 
-    {
-      m_pBoneList[j].dofrz = 1;
-      m_pBoneList[j].rz = 0.0;
-      m_pBoneList[j].dof++;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof-1] = 3;
-      m_pBoneList[j].dofo[m_pBoneList[j].dof] = 0;
-    }
+    // the DOFs of the ASF file, followed by the missing rotational DOFs
+    m_pBoneList[j].dof = getFileDOFOrder(j, 1, m_pBoneList[j].dofo);
+    m_pBoneList[j].dofrx = m_pBoneList[j].dofry = m_pBoneList[j].dofrz = 1;
   }
+  m_AllRotationalDOFs = 1;
+
+  updateActiveBones();
 }
 
-// set the skeleton's pose based on the given posture
-void Skeleton::setPosture(Posture posture) 
+int Skeleton::getFileDOFOrder(int boneIndex, int allRotationalDOFs, int order[8]) const
 {
-  m_RootPos[0] = posture.root_pos.p[0];
-  m_RootPos[1] = posture.root_pos.p[1];
-  m_RootPos[2] = posture.root_pos.p[2];
-
-  for(int j=0;j<NUM_BONES_IN_ASF_FILE;j++)
+  int numDOFs = 0;
+  int hasDOF[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  for(int x = 0; (x < 8) && (m_FileDOFOrder[boneIndex][x] != 0); x++)
   {
-    // if the bone has rotational degree of freedom in x direction
-    if(m_pBoneList[j].dofrx) 
-      m_pBoneList[j].rx = posture.bone_rotation[j].p[0];  
-
-    if(m_pBoneList[j].doftx)
-      m_pBoneList[j].tx = posture.bone_translation[j].p[0];
-
-    // if the bone has rotational degree of freedom in y direction
-    if(m_pBoneList[j].dofry) 
-      m_pBoneList[j].ry = posture.bone_rotation[j].p[1];    
+    order[numDOFs++] = m_FileDOFOrder[boneIndex][x];
+    hasDOF[m_FileDOFOrder[boneIndex][x]] = 1;
+  }
 
-    if(m_pBoneList[j].dofty)
-      m_pBoneList[j].ty = posture.bone_translation[j].p[1];
+  // bones without DOFs stay without DOFs
+  if (allRotationalDOFs && (numDOFs > 0))
+  {
+    for(int axis = 1; axis <= 3; axis++)
+      if (!hasDOF[axis] && (numDOFs < 8))
+        order[numDOFs++] = axis;
+  }
 
-    // if the bone has rotational degree of freedom in z direction
-    if(m_pBoneList[j].dofrz) 
-      m_pBoneList[j].rz = posture.bone_rotation[j].p[2];  
+  if (numDOFs < 8)
+    order[numDOFs] = 0;
+  return numDOFs;
+}
 
-    if(m_pBoneList[j].doftz)
-      m_pBoneList[j].tz= posture.bone_translation[j].p[2];
+void Skeleton::updateActiveBones()
+{
+  m_NumActiveBones = 0;
+  for(int j=0; j<MAX_BONES_IN_ASF_FILE; j++)
+  {
+    m_RotationalDOFMask[j] = 0;
+    if ((j >= NUM_BONES_IN_ASF_FILE) || (m_pBoneList[j].dof == 0))
+      continue;
 
-    if(m_pBoneList[j].doftl)
-      m_pBoneList[j].tl = posture.bone_length[j].p[0];
+    m_ActiveBones[m_NumActiveBones++] = j;
+    if (m_pBoneList[j].dofrx)
+      m_RotationalDOFMask[j] |= DOF_RX;
+    if (m_pBoneList[j].dofry)
+      m_RotationalDOFMask[j] |= DOF_RY;
+    if (m_pBoneList[j].dofrz)
+      m_RotationalDOFMask[j] |= DOF_RZ;
   }
 }
 
 //Set the aspect ratio of each bone 
-void Skeleton::set_bone_shape(Bone *bone)
+void Skeleton::set_bone_shape(Bone *bone, int quiet)
 {
   int root = Skeleton::getRootIndex();
   bone[root].aspx=1;          
   bone[root].aspy=1;
-  printf("READ %d\n",numBonesInSkel(bone[0]));
-  printf("MOV %d\n",movBonesInSkel(bone[0]));
-  int numbones = numBonesInSkel(bone[0]);
-  for(int j=1;j<numbones;j++)
+  if (!quiet)
+  {
+    printf("READ %d\n",m_NumBones);
+    printf("MOV %d\n",m_NumMovableBones);
+  }
+  for(int j=1;j<m_NumBones;j++)
   {
     bone[j].aspx=0.25;   
     bone[j].aspy=0.25;
@@ -532,7 +517,7 @@ void Skeleton::set_bone_shape(Bone *bone)
 }
 
 // Constructor 
-Skeleton::Skeleton(char *asf_filename, double scale)
+Skeleton::Skeleton(char *asf_filename, double scale, int quiet)
 {
   sscanf("root","%s",m_pBoneList[0].name);
   NUM_BONES_IN_ASF_FILE = 1;
@@ -556,14 +541,15 @@ Skeleton::Skeleton(char *asf_filename, double scale)
   m_pBoneList[0].dofrx = m_pBoneList[0].dofry = m_pBoneList[0].dofrz = 1;
   m_pBoneList[0].doftx = m_pBoneList[0].dofty = m_pBoneList[0].doftz = 1;
   m_pBoneList[0].doftl = 0;
-  m_RootPos[0] = m_RootPos[1]=m_RootPos[2]=0;
   //	m_NumDOFs=6;
-  tx = ty = tz = rx = ry = rz = 0.0;
   // build hierarchy and read in each bone's DOF information
-  int code = readASFfile(asf_filename, scale);  
+  int code = readASFfile(asf_filename, scale, quiet);  
   if (code != 0)
     throw 1;
 
+  //flatten the hierarchy (parents, children and topological order of the bones)
+  buildTopology();
+
   //transform the direction vector for each bone from the world coordinate system 
   //to it's local coordinate system
   RotateBoneDirToLocalCoordSystem();
@@ -573,32 +559,72 @@ Skeleton::Skeleton(char *asf_filename, double scale)
   ComputeRotationToParentCoordSystem(m_pRootBone);
 
   //Set the aspect ratio of each bone 
-  set_bone_shape(m_pRootBone);
-}
+  set_bone_shape(m_pRootBone, quiet);
 
-Skeleton::~Skeleton()
-{
+  //keep the DOF order of the ASF file (enableAllRotationalDOFs extends the DOFs of the bones)
+  for(int j = 0; j < MAX_BONES_IN_ASF_FILE; j++)
+  {
+    int numDOFs = (j < NUM_BONES_IN_ASF_FILE) ? m_pBoneList[j].dof : 0;
+    for(int x = 0; x < 8; x++)
+      m_FileDOFOrder[j][x] = (x < numDOFs) ? m_pBoneList[j].dofo[x] : 0;
+  }
+  m_AllRotationalDOFs = 0;
+
+  updateActiveBones();
 }
 
-void Skeleton::GetRootPosGlobal(double rootPosGlobal[3])
+Skeleton::Skeleton(const Skeleton & skeleton)
 {
-  rootPosGlobal[0] = m_RootPos[0];
-  rootPosGlobal[1] = m_RootPos[1];
-  rootPosGlobal[2] = m_RootPos[2];
+  *this = skeleton;
 }
 
-void Skeleton::GetTranslation(double translation[3])
+Skeleton::~Skeleton()
 {
-  translation[0] = tx;
-  translation[1] = ty;
-  translation[2] = tz;
 }
 
-void Skeleton::GetRotationAngle(double rotationAngle[3])
+Skeleton & Skeleton::operator=(const Skeleton & skeleton)
 {
-  rotationAngle[0] = rx;
-  rotationAngle[1] = ry;
-  rotationAngle[2] = rz;
+  if (this == &skeleton)
+    return *this;
+
+  NUM_BONES_IN_ASF_FILE = skeleton.NUM_BONES_IN_ASF_FILE;
+  MOV_BONES_IN_ASF_FILE = skeleton.MOV_BONES_IN_ASF_FILE;
+  m_NumBones = skeleton.m_NumBones;
+  m_NumMovableBones = skeleton.m_NumMovableBones;
+  m_NumActiveBones = skeleton.m_NumActiveBones;
+  for(int i = 0; i < MAX_BONES_IN_ASF_FILE; i++)
+  {
+    m_TopologicalOrder[i] = skeleton.m_TopologicalOrder[i];
+    m_Parent[i] = skeleton.m_Parent[i];
+    m_FirstChild[i] = skeleton.m_FirstChild[i];
+    m_NumChildren[i] = skeleton.m_NumChildren[i];
+    m_ActiveBones[i] = skeleton.m_ActiveBones[i];
+    m_RotationalDOFMask[i] = skeleton.m_RotationalDOFMask[i];
+    m_BoneNameLength[i] = skeleton.m_BoneNameLength[i];
+    for(int x = 0; x < 8; x++)
+      m_FileDOFOrder[i][x] = skeleton.m_FileDOFOrder[i][x];
+  }
+  m_AllRotationalDOFs = skeleton.m_AllRotationalDOFs;
+  for(int i = 0; i < boneNameHashTableSize; i++)
+    m_BoneNameHashTable[i] = skeleton.m_BoneNameHashTable[i];
+
+  // rebase the hierarchy pointers onto this bone list (the bones past NUM_BONES_IN_ASF_FILE are unused)
+  for(int i = 0; i < MAX_BONES_IN_ASF_FILE; i++)
+  {
+    m_pBoneList[i] = skeleton.m_pBoneList[i];
+    if (i >= NUM_BONES_IN_ASF_FILE)
+    {
+      m_pBoneList[i].sibling = m_pBoneList[i].child = NULL;
+      continue;
+    }
+    if (skeleton.m_pBoneList[i].sibling != NULL)
+      m_pBoneList[i].sibling = m_pBoneList + (skeleton.m_pBoneList[i].sibling - skeleton.m_pBoneList);
+    if (skeleton.m_pBoneList[i].child != NULL)
+      m_pBoneList[i].child = m_pBoneList + (skeleton.m_pBoneList[i].child - skeleton.m_pBoneList);
+  }
+  m_pRootBone = m_pBoneList + (skeleton.m_pRootBone - skeleton.m_pBoneList);
+
+  return *this;
 }
 
 
@@ -3,6 +3,13 @@ skeleton.h
 
 Definition of the skeleton. 
 
+The skeleton holds the definition read from the ASF file (hierarchy, axes, DOFs, lengths) and is not
+changed after it is set up: enableAllRotationalDOFs, if the motions need it, is called once, right after
+loading, before the skeleton is shared. From then on it can be shared by any number of threads; its read
+accessors are const, and the classes that only read it (the motion loaders and parsers, SkeletonPose,
+ForwardKinematics, ...) take a const Skeleton *. The pose at a time frame is kept separately, in a
+SkeletonPose (see skeletonPose.h).
+
 Revision 1 - Steve Lin, Jan. 14, 2002
 Revision 2 - Alla and Kiran, Jan 18, 2002
 Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
@@ -14,6 +21,15 @@ Revision 3 - Jernej Barbic and Yili Zhao, Feb, 2012
 
 #include "posture.h"
 
+// rotational degree of freedom masks (see Skeleton::getRotationalDOFMask)
+#define DOF_RX 1
+#define DOF_RY 2
+#define DOF_RZ 4
+// translational degree of freedom masks (see ForwardKinematics)
+#define DOF_TX 8
+#define DOF_TY 16
+#define DOF_TZ 32
+
 // this structure defines the property of each bone segment, including its connection to other bones,
 // DOF (degrees of freedom), relative orientation and distance to the outboard bone 
 struct Bone 
@@ -45,11 +61,6 @@ struct Bone
   // rotation matrix from the local coordinate of this bone to the local coordinate system of it's parent
   double rot_parent_current[4][4];			
 
-  //Rotation angles for this bone at a particular time frame (as read from AMC file) in local coordinate system, 
-  //they are set in the setPosture function before display function is called
-  double rx, ry, rz;
-  double tx,ty,tz;
-  double tl;
   int dofo[8];
 };
 
@@ -59,48 +70,66 @@ class Skeleton
 public: 
   // The scale parameter adjusts the size of the skeleton. The default value is 0.06 (MOCAP_SCALE).
   // This creates a human skeleton of 1.7 m in height (approximately)
-  Skeleton(char *asf_filename, double scale);  
+  // if quiet is 1, the DOFs and the number of bones are not printed (errors still are)
+  Skeleton(char *asf_filename, double scale, int quiet=0);  
+  // copies all bones; the hierarchy (child / sibling pointers) of the copy refers to its own bones
+  Skeleton(const Skeleton & skeleton);
   ~Skeleton();                                
 
+  Skeleton & operator=(const Skeleton & skeleton);
+
   //Get root node's address; for accessing bone data
-  Bone* getRoot();
+  const Bone * getRoot() const;
   static int getRootIndex() { return 0; }
 
-  //Set the skeleton's pose based on the given posture    
-  void setPosture(Posture posture);        
-
-  //Initial posture Root at (0,0,0)
-  //All bone rotations are set to 0
-  void setBasePosture();
-
-  // marks previously unavailable rotational DOFs as available, and sets them to 0
+  // marks previously unavailable rotational DOFs as available (appended to the DOF order of each bone with DOFs,
+  // as in AMC files with :FORCE-ALL-JOINTS-BE-3DOF); calling it again has no effect
+  // call it before the skeleton is shared (it is the only function that modifies a loaded skeleton)
   void enableAllRotationalDOFs();
-
-  int name2idx(char *);
-  char * idx2name(int);
-  void GetRootPosGlobal(double rootPosGlobal[3]);
-  void GetTranslation(double translation[3]);
-  void GetRotationAngle(double rotationAngle[3]);
-  void SetTranslationX(double tx_){tx = tx_;}
-  void SetTranslationY(double ty_){ty = ty_;}
-  void SetTranslationZ(double tz_){tz = tz_;}
-  void SetRotationAngleX(double rx_){rx = rx_;}
-  void SetRotationAngleY(double ry_){ry = ry_;}
-  void SetRotationAngleZ(double rz_){rz = rz_;}
-
-  int numBonesInSkel(Bone bone);
-  int movBonesInSkel(Bone bone);
+  int hasAllRotationalDOFs() const { return m_AllRotationalDOFs; }
+
+  // DOFs of a bone in the order of its values in the lines of AMC files (1-3: rx, ry, rz, 4-6: tx, ty, tz, 7: l, as in
+  // Bone::dofo): the DOFs of the ASF file, followed by the missing rotational DOFs if allRotationalDOFs is non-zero
+  // (:FORCE-ALL-JOINTS-BE-3DOF); independent of enableAllRotationalDOFs. order is terminated by 0 if it has fewer
+  // than 8 entries. Returns the number of DOFs.
+  int getFileDOFOrder(int boneIndex, int allRotationalDOFs, int order[8]) const;
+
+  // bone names: the names are hashed when the skeleton is loaded, so both lookups take constant time
+  // index of the bone with the given name (-1 if there is no such bone)
+  int name2idx(const char * name) const;
+  // the same for a name that is not terminated by 0 (e.g., a token in a file), with the given length
+  int name2idx(const char * name, int length) const;
+  const char * idx2name(int boneIndex) const { return m_pBoneList[boneIndex].name; }
+
+  // number of bones in the hierarchy, and of those with degrees of freedom
+  // (counted once when the skeleton is loaded; enabling DOFs does not change which bones have DOFs)
+  int getNumBones() const { return m_NumBones; }
+  int getNumMovableBones() const { return m_NumMovableBones; }
+
+  // flattened hierarchy, built once when the skeleton is loaded:
+  // the bones in breadth-first order (the root first, each bone after its parent, the children of a bone consecutive)
+  const int * getTopologicalOrder() const { return m_TopologicalOrder; }
+  // parent of a bone (-1 for the root)
+  int getParent(int boneIndex) const { return m_Parent[boneIndex]; }
+  const int * getParents() const { return m_Parent; }
+  // children of a bone, in the order of the hierarchy section of the ASF file
+  int getNumChildren(int boneIndex) const { return m_NumChildren[boneIndex]; }
+  const int * getChildren(int boneIndex) const { return &m_TopologicalOrder[m_FirstChild[boneIndex]]; }
+
+  // bones with at least one degree of freedom (the root, and the bones animated by motions), in increasing index order
+  // the other bones always keep rotation 0, so they can be skipped when processing motions
+  int getNumActiveBones() const { return m_NumActiveBones; }
+  const int * getActiveBones() const { return m_ActiveBones; }
+  // rotational degrees of freedom of a bone, as a combination of DOF_RX, DOF_RY, DOF_RZ
+  int getRotationalDOFMask(int boneIndex) const { return m_RotationalDOFMask[boneIndex]; }
 
 protected:
 
   //parse the skeleton (.ASF) file	
-  int readASFfile(char* asf_filename, double scale);
+  int readASFfile(char* asf_filename, double scale, int quiet=0);
 
-  //This recursive function traverses skeleton hierarchy 
-  //and returns a pointer to the bone with index - bIndex
-  //ptr should be a pointer to the root node 
-  //when this function first called
-  Bone* getBone(Bone *ptr, int bIndex);
+  //Returns a pointer to the bone with index bIndex (NULL if there is no such bone)
+  Bone* getBone(int bIndex);
 
   //This function sets sibling or child for parent bone
   //If parent bone does not have a child, 
@@ -111,15 +140,10 @@ protected:
   //Rotate all bone's direction vector (dir) from global to local coordinate system
   void RotateBoneDirToLocalCoordSystem();
 
-  void set_bone_shape(Bone *bone);
+  void set_bone_shape(Bone *bone, int quiet=0);
   void compute_rotation_parent_child(Bone *parent, Bone *child);
   void ComputeRotationToParentCoordSystem(Bone *bone);
 
-  // root position in world coordinate system
-  double m_RootPos[3];
-  double tx,ty,tz;
-  double rx,ry,rz;
-
   int NUM_BONES_IN_ASF_FILE;
   int MOV_BONES_IN_ASF_FILE;
 
@@ -127,6 +151,31 @@ protected:
   Bone  m_pBoneList[MAX_BONES_IN_ASF_FILE];   // Array with all skeleton bones
 
   void removeCR(char * str); // removes CR at the end of line
+
+  // open-addressing hash table from bone name to bone index (-1 = empty slot); built after the bones are read
+  static const int boneNameHashTableSize = 2 * MAX_BONES_IN_ASF_FILE; // power of 2
+  int m_BoneNameHashTable[boneNameHashTableSize];
+  int m_BoneNameLength[MAX_BONES_IN_ASF_FILE];
+  static unsigned int hashName(const char * name, int length);
+  void buildNameTable();
+
+  // flattened hierarchy (see getTopologicalOrder); built from the child / sibling pointers after the ASF file is read
+  int m_NumBones, m_NumMovableBones;
+  int m_TopologicalOrder[MAX_BONES_IN_ASF_FILE];
+  int m_Parent[MAX_BONES_IN_ASF_FILE];
+  int m_FirstChild[MAX_BONES_IN_ASF_FILE]; // position of the first child in m_TopologicalOrder
+  int m_NumChildren[MAX_BONES_IN_ASF_FILE];
+  void buildTopology();
+
+  // DOF order of each bone as read from the ASF file (see getFileDOFOrder), 0-terminated
+  int m_FileDOFOrder[MAX_BONES_IN_ASF_FILE][8];
+  int m_AllRotationalDOFs;
+
+  // active bones and DOF masks; recomputed whenever the DOFs change
+  int m_NumActiveBones;
+  int m_ActiveBones[MAX_BONES_IN_ASF_FILE];
+  int m_RotationalDOFMask[MAX_BONES_IN_ASF_FILE];
+  void updateActiveBones();
 };
 
 #endif
@@ -0,0 +1,142 @@
+/*
+skeletonPose.cpp
+
+Pose of a skeleton at one time frame.
+*/
+
+#include <stdlib.h>
+#include "skeletonPose.h"
+
+SkeletonPose::SkeletonPose(const Skeleton * pSkeleton)
+{
+  m_pSkeleton = pSkeleton;
+  m_NumBones = pSkeleton->getNumBones();
+  m_pBoneRotation = new double[m_NumBones][3];
+  m_pBoneTranslation = new double[m_NumBones][3];
+  m_pBoneLengthChange = new double[m_NumBones];
+  for(int j=0; j<m_NumBones; j++)
+    m_pBoneLengthChange[j] = 0.0;
+  setBasePosture();
+  tx = ty = tz = rx = ry = rz = 0.0;
+}
+
+SkeletonPose::SkeletonPose(const SkeletonPose & pose)
+{
+  m_NumBones = 0;
+  m_pBoneRotation = NULL;
+  m_pBoneTranslation = NULL;
+  m_pBoneLengthChange = NULL;
+  *this = pose;
+}
+
+SkeletonPose::~SkeletonPose()
+{
+  delete [] m_pBoneRotation;
+  delete [] m_pBoneTranslation;
+  delete [] m_pBoneLengthChange;
+}
+
+SkeletonPose & SkeletonPose::operator=(const SkeletonPose & pose)
+{
+  if (this == &pose)
+    return *this;
+
+  if (m_NumBones != pose.m_NumBones)
+  {
+    delete [] m_pBoneRotation;
+    delete [] m_pBoneTranslation;
+    delete [] m_pBoneLengthChange;
+    m_NumBones = pose.m_NumBones;
+    m_pBoneRotation = new double[m_NumBones][3];
+    m_pBoneTranslation = new double[m_NumBones][3];
+    m_pBoneLengthChange = new double[m_NumBones];
+  }
+  m_pSkeleton = pose.m_pSkeleton;
+
+  for(int j=0; j<m_NumBones; j++)
+  {
+    for(int i=0; i<3; i++)
+    {
+      m_pBoneRotation[j][i] = pose.m_pBoneRotation[j][i];
+      m_pBoneTranslation[j][i] = pose.m_pBoneTranslation[j][i];
+    }
+    m_pBoneLengthChange[j] = pose.m_pBoneLengthChange[j];
+  }
+  for(int i=0; i<3; i++)
+    m_RootPos[i] = pose.m_RootPos[i];
+  tx = pose.tx; ty = pose.ty; tz = pose.tz;
+  rx = pose.rx; ry = pose.ry; rz = pose.rz;
+
+  return *this;
+}
+
+//Initial posture Root at (0,0,0)
+//All bone rotations are set to 0
+void SkeletonPose::setBasePosture()
+{
+  m_RootPos[0] = m_RootPos[1] = m_RootPos[2] = 0.0;
+
+  for(int j=0; j<m_NumBones; j++)
+  {
+    m_pBoneRotation[j][0] = m_pBoneRotation[j][1] = m_pBoneRotation[j][2] = 0.0;
+    m_pBoneTranslation[j][0] = m_pBoneTranslation[j][1] = m_pBoneTranslation[j][2] = 0.0;
+  }
+}
+
+// set the pose based on the given posture
+void SkeletonPose::setPosture(const Posture & posture)
+{
+  m_RootPos[0] = posture.root_pos.p[0];
+  m_RootPos[1] = posture.root_pos.p[1];
+  m_RootPos[2] = posture.root_pos.p[2];
+
+  const Bone * pBoneList = m_pSkeleton->getRoot();
+  int numBones = (posture.GetNumBones() < m_NumBones) ? posture.GetNumBones() : m_NumBones;
+  for(int j=0;j<numBones;j++)
+  {
+    // if the bone has rotational degree of freedom in x direction
+    if(pBoneList[j].dofrx)
+      m_pBoneRotation[j][0] = posture.bone_rotation[j].p[0];
+
+    if(pBoneList[j].doftx)
+      m_pBoneTranslation[j][0] = posture.bone_translation[j].p[0];
+
+    // if the bone has rotational degree of freedom in y direction
+    if(pBoneList[j].dofry)
+      m_pBoneRotation[j][1] = posture.bone_rotation[j].p[1];
+
+    if(pBoneList[j].dofty)
+      m_pBoneTranslation[j][1] = posture.bone_translation[j].p[1];
+
+    // if the bone has rotational degree of freedom in z direction
+    if(pBoneList[j].dofrz)
+      m_pBoneRotation[j][2] = posture.bone_rotation[j].p[2];
+
+    if(pBoneList[j].doftz)
+      m_pBoneTranslation[j][2] = posture.bone_translation[j].p[2];
+
+    if(pBoneList[j].doftl)
+      m_pBoneLengthChange[j] = posture.bone_length[j].p[0];
+  }
+}
+
+void SkeletonPose::GetRootPosGlobal(double rootPosGlobal[3]) const
+{
+  rootPosGlobal[0] = m_RootPos[0];
+  rootPosGlobal[1] = m_RootPos[1];
+  rootPosGlobal[2] = m_RootPos[2];
+}
+
+void SkeletonPose::GetTranslation(double translation[3]) const
+{
+  translation[0] = tx;
+  translation[1] = ty;
+  translation[2] = tz;
+}
+
+void SkeletonPose::GetRotationAngle(double rotationAngle[3]) const
+{
+  rotationAngle[0] = rx;
+  rotationAngle[1] = ry;
+  rotationAngle[2] = rz;
+}
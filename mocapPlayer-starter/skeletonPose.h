@@ -0,0 +1,75 @@
+/*
+skeletonPose.h
+
+Pose of a skeleton: the joint angles, translations and length changes of the bones at one time frame
+(as set from a posture), the root position, and the placement of the whole skeleton in the scene
+(the translation and rotation angles set in the player).
+
+The skeleton itself (hierarchy, axes, DOFs and lengths read from the ASF file) is not modified by a pose,
+so any number of poses, e.g., one per thread or per displayed skeleton, can share one skeleton.
+
+Usage:
+  SkeletonPose pose(pSkeleton);
+  pose.setPosture(*pMotion->GetPosture(frame));
+  const double * rotation = pose.GetBoneRotation(boneIndex); // rx, ry, rz of the bone, in degrees
+*/
+
+#ifndef _SKELETONPOSE_H_
+#define _SKELETONPOSE_H_
+
+#include "skeleton.h"
+#include "posture.h"
+
+class SkeletonPose
+{
+public:
+  // the pose is in the base posture (see setBasePosture), with no translation or rotation in the scene
+  SkeletonPose(const Skeleton * pSkeleton);
+  SkeletonPose(const SkeletonPose & pose);
+  ~SkeletonPose();
+
+  SkeletonPose & operator=(const SkeletonPose & pose);
+
+  const Skeleton * GetSkeleton() const { return m_pSkeleton; }
+
+  //Set the pose based on the given posture (only the DOFs of the bones are taken from the posture)
+  void setPosture(const Posture & posture);
+
+  //Initial posture Root at (0,0,0)
+  //All bone rotations are set to 0
+  void setBasePosture();
+
+  // rotation angles (rx, ry, rz, in degrees) and translation (tx, ty, tz) of a bone in its local coordinate system,
+  // and its length change (tl); the values of DOFs that the bone does not have are 0
+  const double * GetBoneRotation(int boneIndex) const { return m_pBoneRotation[boneIndex]; }
+  const double * GetBoneTranslation(int boneIndex) const { return m_pBoneTranslation[boneIndex]; }
+  double GetBoneLengthChange(int boneIndex) const { return m_pBoneLengthChange[boneIndex]; }
+
+  void GetRootPosGlobal(double rootPosGlobal[3]) const;
+
+  // placement of the skeleton in the scene (applied before the root position)
+  void GetTranslation(double translation[3]) const;
+  void GetRotationAngle(double rotationAngle[3]) const;
+  void SetTranslationX(double tx_){tx = tx_;}
+  void SetTranslationY(double ty_){ty = ty_;}
+  void SetTranslationZ(double tz_){tz = tz_;}
+  void SetRotationAngleX(double rx_){rx = rx_;}
+  void SetRotationAngleY(double ry_){ry = ry_;}
+  void SetRotationAngleZ(double rz_){rz = rz_;}
+
+protected:
+  const Skeleton * m_pSkeleton;
+  int m_NumBones;
+
+  double (*m_pBoneRotation)[3];
+  double (*m_pBoneTranslation)[3];
+  double * m_pBoneLengthChange;
+
+  // root position in world coordinate system
+  double m_RootPos[3];
+  double tx,ty,tz;
+  double rx,ry,rz;
+};
+
+#endif
+
@@ -0,0 +1,101 @@
+/*
+streamingInterpolator.cpp
+
+Interpolation of a motion given frame by frame, in chunks of keyframe segments with bounded memory.
+*/
+
+#include <stdio.h>
+#include "streamingInterpolator.h"
+
+StreamingInterpolator::StreamingInterpolator(const Skeleton * pSkeleton, Interpolator * pInterpolator, int N,
+  const std::function<int(const Posture &)> & output, int segmentsPerChunk)
+{
+  m_pSkeleton = pSkeleton;
+  m_pInterpolator = pInterpolator;
+  m_N = N;
+  m_Output = output;
+  m_SegmentsPerChunk = (segmentsPerChunk < 1) ? 1 : segmentsPerChunk;
+
+  // a full window holds the keyframe before the chunk, the chunk, and the keyframe after the chunk
+  m_pWindow = new Motion((m_SegmentsPerChunk + 2) * (N+1) + 1, pSkeleton);
+  m_pOutputWindow = NULL;
+  m_WindowStart = m_WindowLength = 0;
+  m_NextSegment = 0;
+  m_NumInputFrames = m_NumOutputFrames = 0;
+}
+
+StreamingInterpolator::~StreamingInterpolator()
+{
+  delete m_pWindow;
+  delete m_pOutputWindow;
+}
+
+int StreamingInterpolator::InterpolateWindow(int numFrames)
+{
+  // the window starts at a keyframe; the first frame to output is the start keyframe of m_NextSegment
+  if ((m_pOutputWindow != NULL) && (m_pOutputWindow->GetNumFrames() != m_pWindow->GetNumFrames()))
+  {
+    delete m_pOutputWindow;
+    m_pOutputWindow = NULL;
+  }
+  if (m_pOutputWindow == NULL)
+    m_pOutputWindow = new Motion(m_pWindow->GetNumFrames(), m_pSkeleton);
+  if (m_pInterpolator->Interpolate(m_pWindow, m_pOutputWindow, m_N) != 0)
+    return -1;
+  int firstFrame = m_NextSegment * (m_N+1) - m_WindowStart;
+  if (numFrames < 0)
+    numFrames = m_WindowLength - firstFrame;
+
+  int code = 0;
+  for(int frame=firstFrame; (frame < firstFrame + numFrames) && (code == 0); frame++)
+    code = m_Output(*m_pOutputWindow->GetPosture(frame));
+  m_NumOutputFrames += numFrames;
+  return code;
+}
+
+int StreamingInterpolator::AddFrame(const Posture & posture)
+{
+  *m_pWindow->GetPosture(m_WindowLength) = posture;
+  m_pWindow->PosturesModified();
+  m_WindowLength++;
+  m_NumInputFrames++;
+  if (m_WindowLength < m_pWindow->GetNumFrames())
+    return 0;
+
+  // the window is full, and ends at keyframe L: output the segments up to L-2 (their next keyframe, L, is known)
+  int lastKeyframe = (m_WindowStart + m_WindowLength - 1) / (m_N+1);
+  int endSegment = lastKeyframe - 1;
+  if (InterpolateWindow((endSegment - m_NextSegment) * (m_N+1)) != 0)
+    return -1;
+  m_NextSegment = endSegment;
+
+  // keep the keyframes L-2, L-1, L, and the frames in between
+  int newWindowStart = (lastKeyframe - 2) * (m_N+1);
+  int shift = newWindowStart - m_WindowStart;
+  for(int frame=shift; frame<m_WindowLength; frame++)
+    *m_pWindow->GetPosture(frame - shift) = *m_pWindow->GetPosture(frame);
+  m_pWindow->PosturesModified();
+  m_WindowStart = newWindowStart;
+  m_WindowLength -= shift;
+  return 0;
+}
+
+int StreamingInterpolator::Finish()
+{
+  if (m_WindowLength == 0)
+    return 0;
+
+  // the remaining frames are interpolated in a window of their own length (the end of the motion is now known)
+  Motion * pFullWindow = m_pWindow;
+  m_pWindow = new Motion(m_WindowLength, m_pSkeleton);
+  for(int frame=0; frame<m_WindowLength; frame++)
+    *m_pWindow->GetPosture(frame) = *pFullWindow->GetPosture(frame);
+  m_pWindow->PosturesModified();
+  delete pFullWindow;
+
+  int code = InterpolateWindow(-1);
+  m_WindowStart += m_WindowLength;
+  m_WindowLength = 0;
+  return code;
+}
+
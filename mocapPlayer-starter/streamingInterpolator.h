@@ -0,0 +1,66 @@
+/*
+streamingInterpolator.h
+
+Interpolates a motion that is given frame by frame (for example, read with
+AMCReader from a file that is too large to be loaded), and passes the
+interpolated frames on to an output function as soon as they are known.
+
+Only a window of the input is kept: the keyframe segments are interpolated in
+chunks of segmentsPerChunk segments, with an Interpolator, on a window that also
+contains the keyframe before and the keyframe after the chunk (which the Bezier
+and SQUAD control points need). The memory use is proportional to
+(segmentsPerChunk + 2) * (N + 1) frames, independent of the length of the motion.
+The output is the same as that of Interpolator::Interpolate on the whole motion
+(the segments at the borders of a window are interpolated twice, but only the
+segments in the middle of the window are output).
+
+Usage:
+  StreamingInterpolator stream(pSkeleton, &interpolator, N, [&](const Posture & posture) { return writer.WriteFrame(++frame, posture); });
+  while (reader.ReadFrame(posture, &frameNumber) == 1)
+    if (stream.AddFrame(posture) != 0) ... // output error
+  if (stream.Finish() != 0) ... // output error
+*/
+
+#ifndef _STREAMINGINTERPOLATOR_H_
+#define _STREAMINGINTERPOLATOR_H_
+
+#include <functional>
+#include "interpolator.h"
+
+class StreamingInterpolator
+{
+public:
+  // output is called for each output frame, in order; it returns 0 on success, and -1 on failure
+  // the interpolator (type, angle representation, thread pool) is used for each chunk
+  StreamingInterpolator(const Skeleton * pSkeleton, Interpolator * pInterpolator, int N,
+    const std::function<int(const Posture &)> & output, int segmentsPerChunk=16);
+  ~StreamingInterpolator();
+
+  // adds the next input frame; returns 0 on success, and -1 if the output function failed
+  int AddFrame(const Posture & posture);
+  // interpolates the remaining frames (call after the last input frame); returns 0 on success, and -1 on failure
+  int Finish();
+
+  int GetNumInputFrames() { return m_NumInputFrames; }
+  int GetNumOutputFrames() { return m_NumOutputFrames; }
+
+protected:
+  const Skeleton * m_pSkeleton;
+  Interpolator * m_pInterpolator;
+  int m_N;
+  std::function<int(const Posture &)> m_Output;
+  int m_SegmentsPerChunk;
+
+  Motion * m_pWindow; // the input frames from m_WindowStart on (m_WindowLength of them)
+  Motion * m_pOutputWindow; // the interpolated window (reused; reallocated only if the window length changes)
+  int m_WindowStart, m_WindowLength;
+  int m_NextSegment; // first segment that has not been output
+  int m_NumInputFrames, m_NumOutputFrames;
+
+  // interpolates the window, and outputs its frames from the start of m_NextSegment on
+  // (numFrames frames; all of them if numFrames < 0)
+  int InterpolateWindow(int numFrames);
+};
+
+#endif
+
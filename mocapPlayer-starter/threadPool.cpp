@@ -0,0 +1,184 @@
+/*
+threadPool.cpp
+
+A fixed set of worker threads that execute parallel loops.
+*/
+
+#include <deque>
+#include "threadPool.h"
+
+// set in the pool threads, and in a thread executing a parallel loop (to run nested loops serially)
+static thread_local int insideParallelFor = 0;
+
+struct ThreadPool::TaskQueue
+{
+  std::mutex mutex;
+  std::deque<int> tasks;
+};
+
+ThreadPool::ThreadPool(int numThreads)
+{
+  m_NumThreads = numThreads;
+  if (m_NumThreads <= 0)
+    m_NumThreads = (int)std::thread::hardware_concurrency();
+  if (m_NumThreads <= 0)
+    m_NumThreads = 1;
+
+  m_Generation = 0;
+  m_NumBusyWorkers = 0;
+  m_Stop = 0;
+  m_pTask = NULL;
+  m_NumTasks = 0;
+  m_NextTask = 0;
+  m_pQueues = new TaskQueue[m_NumThreads];
+  m_WorkStealing = 0;
+
+  // the calling thread is one of the threads (thread 0)
+  m_NumWorkers = m_NumThreads - 1;
+  m_pWorkers = new std::thread[m_NumWorkers];
+  for(int i = 0; i < m_NumWorkers; i++)
+    m_pWorkers[i] = std::thread(&ThreadPool::WorkerThread, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Stop = 1;
+  }
+  m_WorkAvailable.notify_all();
+  for(int i = 0; i < m_NumWorkers; i++)
+    m_pWorkers[i].join();
+  delete [] m_pWorkers;
+  delete [] m_pQueues;
+}
+
+void ThreadPool::ExecuteTasks(int threadIndex)
+{
+  if (!m_WorkStealing)
+  {
+    while (1)
+    {
+      int task = m_NextTask.fetch_add(1);
+      if (task >= m_NumTasks)
+        break;
+      (*m_pTask)(task);
+    }
+    return;
+  }
+
+  while (1)
+  {
+    int task = -1;
+
+    // own queue, from the front
+    {
+      TaskQueue & queue = m_pQueues[threadIndex];
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+    }
+
+    // steal from the back of another queue
+    for(int i = 1; (task < 0) && (i < m_NumThreads); i++)
+    {
+      TaskQueue & queue = m_pQueues[(threadIndex + i) % m_NumThreads];
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+    }
+
+    // tasks are never added during a loop, so all queues being empty means that the loop is done
+    if (task < 0)
+      break;
+
+    (*m_pTask)(task);
+  }
+}
+
+void ThreadPool::WorkerThread(int threadIndex)
+{
+  insideParallelFor = 1;
+  int generation = 0;
+  while (1)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      while ((!m_Stop) && (m_Generation == generation))
+        m_WorkAvailable.wait(lock);
+      if (m_Stop)
+        return;
+      generation = m_Generation;
+    }
+
+    ExecuteTasks(threadIndex);
+
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_NumBusyWorkers--;
+      if (m_NumBusyWorkers == 0)
+        m_WorkDone.notify_all();
+    }
+  }
+}
+
+void ThreadPool::ParallelFor(int numTasks, const std::function<void(int)> & task)
+{
+  RunLoop(numTasks, task, 0);
+}
+
+void ThreadPool::ParallelForWorkStealing(int numTasks, const std::function<void(int)> & task)
+{
+  RunLoop(numTasks, task, 1);
+}
+
+void ThreadPool::RunLoop(int numTasks, const std::function<void(int)> & task, int workStealing)
+{
+  if ((m_NumWorkers == 0) || (numTasks <= 1) || insideParallelFor)
+  {
+    for(int i = 0; i < numTasks; i++)
+      task(i);
+    return;
+  }
+
+  std::unique_lock<std::mutex> loopLock(m_LoopMutex);
+
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_pTask = &task;
+    m_NumTasks = numTasks;
+    m_NextTask = 0;
+    m_WorkStealing = workStealing;
+    if (workStealing)
+    {
+      // the workers are not running, so the queues can be filled without locking them
+      for(int i = 0; i < m_NumThreads; i++)
+      {
+        int start = (int)((long)numTasks * i / m_NumThreads);
+        int end = (int)((long)numTasks * (i + 1) / m_NumThreads);
+        m_pQueues[i].tasks.clear();
+        for(int t = start; t < end; t++)
+          m_pQueues[i].tasks.push_back(t);
+      }
+    }
+    m_NumBusyWorkers = m_NumWorkers;
+    m_Generation++;
+  }
+  m_WorkAvailable.notify_all();
+
+  insideParallelFor = 1;
+  ExecuteTasks(0);
+  insideParallelFor = 0;
+
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (m_NumBusyWorkers > 0)
+    m_WorkDone.wait(lock);
+  m_pTask = NULL;
+}
+
@@ -0,0 +1,68 @@
+/*
+threadPool.h
+
+A fixed set of worker threads that execute parallel loops.
+
+Usage:
+  ThreadPool pool(4); // 4 threads (including the calling thread); 0 = one per hardware thread
+  pool.ParallelFor(numTasks, [&](int task) { ... });
+
+ParallelFor returns after all tasks have been executed. The calling thread 
+executes tasks as well. ParallelFor hands out the tasks one by one from a shared 
+counter; ParallelForWorkStealing distributes them over per-thread queues first 
+(better suited to a few long tasks of very different durations, such as whole jobs). When ParallelFor is called from within a task, 
+the inner loop is executed serially by the calling thread.
+*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class ThreadPool
+{
+public:
+  ThreadPool(int numThreads=0);
+  ~ThreadPool();
+
+  int GetNumThreads() { return m_NumThreads; }
+
+  // executes task(0), ..., task(numTasks-1) in parallel, and waits for all of them to finish
+  void ParallelFor(int numTasks, const std::function<void(int)> & task);
+
+  // same as ParallelFor, but the tasks are split into contiguous blocks, one per thread; each thread executes 
+  // its block in order, and when it runs out of tasks, it steals tasks from the end of the other blocks
+  void ParallelForWorkStealing(int numTasks, const std::function<void(int)> & task);
+
+protected:
+  int m_NumThreads;
+  int m_NumWorkers; // m_NumThreads - 1 (the calling thread is also used)
+  std::thread * m_pWorkers;
+
+  std::mutex m_LoopMutex; // one parallel loop at a time
+  std::mutex m_Mutex;
+  std::condition_variable m_WorkAvailable, m_WorkDone;
+  int m_Generation; // incremented for each parallel loop
+  int m_NumBusyWorkers;
+  int m_Stop;
+
+  const std::function<void(int)> * m_pTask;
+  int m_NumTasks;
+  std::atomic<int> m_NextTask;
+
+  // per-thread task queues (used by ParallelForWorkStealing)
+  struct TaskQueue;
+  TaskQueue * m_pQueues;
+  int m_WorkStealing; // whether the current loop takes its tasks from m_pQueues
+
+  void WorkerThread(int threadIndex);
+  void ExecuteTasks(int threadIndex);
+  void RunLoop(int numTasks, const std::function<void(int)> & task, int workStealing);
+};
+
+#endif
+
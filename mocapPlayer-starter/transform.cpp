@@ -51,7 +51,7 @@ void matrix_transform_affine(double m[4][4],
   pt[2] = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
 }
 
-void v3_cross(double a[3], double b[3], double c[3]) 
+void v3_cross(const double a[3], const double b[3], double c[3]) 
 {
   /* cross product of two vectors: c = a x b */
   c[0] = a[1]*b[2]-a[2]*b[1];
@@ -59,13 +59,13 @@ void v3_cross(double a[3], double b[3], double c[3])
   c[2] = a[0]*b[1]-a[1]*b[0];
 }
 
-double v3_dot(double a[3], double b[3])
+double v3_dot(const double a[3], const double b[3])
 {
   return(a[0]*b[0]+a[1]*b[1]+a[2]*b[2]);
 }
 
 
-double v3_mag(double a[3])
+double v3_mag(const double a[3])
 {
   return(sqrt(a[0]*a[0]+a[1]*a[1]+a[2]*a[2])); 
 }
@@ -131,7 +131,7 @@ void vector_rotationXYZ(double *v, double a, double b, double c)
 
 
 //get the angle from vector v1 to vector v2 around the axis
-double GetAngle(double* v1, double* v2, double* axis)
+double GetAngle(const double* v1, const double* v2, const double* axis)
 {
   double dot_prod = v3_dot(v1, v2);
   double r_axis_len = v3_mag(axis);
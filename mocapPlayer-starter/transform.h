@@ -20,9 +20,9 @@ void matrix_print(char *str, double a[4][4]);
 void matrix_transform_affine(double m[4][4], double x, double y, double z, double pt[3]);
 void matrix_mult(double a[][4], double b[][4], double c[][4]);
 
-void v3_cross(double a[3], double b[3], double c[3]);
-double v3_mag(double a[3]);
-double v3_dot(double a[3], double b[3]);
+void v3_cross(const double a[3], const double b[3], double c[3]);
+double v3_mag(const double a[3]);
+double v3_dot(const double a[3], const double b[3]);
 
 //Rotate vector v around axis X by angle a, around axis Y by angle b and around axis Z by angle c
 void vector_rotationXYZ(double *v, double a, double b, double c);
@@ -35,6 +35,6 @@ void rotationY(double r[][4], double a);
 void rotationZ(double r[][4], double a);
 
 //Return the angle between vectors v1 and v2 around the given axis 
-double GetAngle(double* v1, double* v2, double* axis);
+double GetAngle(const double* v1, const double* v2, const double* axis);
 
 #endif